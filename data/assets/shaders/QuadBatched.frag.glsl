@@ -7,13 +7,17 @@ layout(location = 0) in Varyings
   vec2 texCoord;
   flat uint spriteIndex;
   flat uint tint4x8;
+  flat vec2 texCoordMax;
 }fs_in;
 
 layout(location = 0) out vec4 o_color;
 
 void main()
 {
-  vec4 color = textureLod(s_texture, vec3(fs_in.texCoord, fs_in.spriteIndex), 0.0);
+  // keep filtering from reaching the unused part of the layer
+  vec2 halfTexel = 0.5 / vec2(textureSize(s_texture, 0).xy);
+  vec2 texCoord = clamp(fs_in.texCoord, halfTexel, fs_in.texCoordMax - halfTexel);
+  vec4 color = textureLod(s_texture, vec3(texCoord, fs_in.spriteIndex), 0.0);
   color *= unpackUnorm4x8(fs_in.tint4x8);
   o_color = color;
 }
\ No newline at end of file
@@ -4,7 +4,7 @@ struct ObjectUniforms
 {
   mat3x2 transform;
   uint tint4x8;
-  uint _padding;
+  uint textureLayer;
 };
 
 layout(std140, binding = 0) uniform CameraBuffer
@@ -12,13 +12,35 @@ layout(std140, binding = 0) uniform CameraBuffer
   mat4 viewProj;
 }cameraUniforms;
 
+layout(std140, binding = 1) uniform SpriteDrawUniforms
+{
+  uint useDrawOrder;
+};
+
 layout(std430, binding = 0) readonly restrict buffer UniformBuffer
 {
   ObjectUniforms objectUniforms[];
 };
 
-layout(location = 0) out vec2 v_uv;
-layout(location = 1) out flat uint v_tint4x8;
+// instance indices sorted by draw order, only read if useDrawOrder != 0
+layout(std430, binding = 1) readonly restrict buffer DrawOrderBuffer
+{
+  uint drawOrder[];
+};
+
+// fraction of its layer each texture covers
+layout(std430, binding = 2) readonly restrict buffer LayerBuffer
+{
+  vec2 layerUvScale[];
+};
+
+layout(location = 0) out Varyings
+{
+  vec2 texCoord;
+  flat uint spriteIndex;
+  flat uint tint4x8;
+  flat vec2 texCoordMax;
+}vs_out;
 
 // vertices in [0, 1]
 vec2 CreateQuad(in uint vertexID) // triangle fan
@@ -29,11 +51,21 @@ vec2 CreateQuad(in uint vertexID) // triangle fan
 
 void main()
 {
-  v_uv = CreateQuad(gl_VertexID);
-  vec2 aPos = v_uv - 0.5;
+  vec2 uv = CreateQuad(gl_VertexID);
+  vec2 aPos = uv - 0.5;
+
+  uint instance = gl_InstanceID + gl_BaseInstance;
+  if (useDrawOrder != 0)
+  {
+    instance = drawOrder[instance];
+  }
 
-  ObjectUniforms object = objectUniforms[gl_InstanceID + gl_BaseInstance];
-  v_tint4x8 = object.tint4x8;
+  ObjectUniforms object = objectUniforms[instance];
+  vec2 uvScale = layerUvScale[object.textureLayer];
+  vs_out.texCoord = uv * uvScale;
+  vs_out.spriteIndex = object.textureLayer;
+  vs_out.tint4x8 = object.tint4x8;
+  vs_out.texCoordMax = uvScale;
   mat3x2 transform3x2 = object.transform;
   vec2 wPos = transform3x2 * vec3(aPos, 1.0);
 
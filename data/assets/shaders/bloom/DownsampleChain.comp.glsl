@@ -0,0 +1,215 @@
+#version 460 core
+
+// Builds every mip of the bloom chain in one dispatch, using the same 13-tap filter as the old per-mip passes.
+// Each workgroup starts by downsampling one 16x16 tile of the first mip from s_source.
+// A tile of a smaller mip reads up to four texels past the tiles under it, so it depends on a 4x4 block of tiles
+// of the mip above. Whichever workgroup finishes the last of those tiles goes on to build it, so no workgroup waits.
+
+// keep in sync with Renderer.cpp
+#define TILE_SIZE 16
+#define MAX_LEVELS 8
+
+// a workgroup can't have more than 3 leftover jobs per level, plus the 4 it just queued
+#define MAX_PENDING 32
+
+struct Level
+{
+  ivec2 sourceDim;
+  ivec2 targetDim;
+  ivec2 numTiles;
+  uint counterOffset; // where this level's tiles start in counters
+  uint _padding;
+  vec2 uvScale; // targetDim / size of the mip, since the chain may only cover part of each mip
+  vec2 _padding1;
+};
+
+layout(binding = 0) uniform sampler2D s_source;
+
+// the unresolved particle images, added to s_source if addParticles is set
+layout(binding = 1) uniform usampler2D s_particlesR;
+layout(binding = 2) uniform usampler2D s_particlesG;
+layout(binding = 3) uniform usampler2D s_particlesB;
+
+// mips that were written by other workgroups are read with imageLoad, since texture fetches aren't coherent
+layout(binding = 0, rgba16f) coherent uniform image2D i_mips[MAX_LEVELS];
+
+layout(binding = 0, std140) uniform UniformBuffer
+{
+  Level levels[MAX_LEVELS];
+  uint numLevels;
+  float width;
+  vec2 sourceUvScale; // region of s_source that is read / size of s_source
+  uint addParticles;
+}uniforms;
+
+// how many tiles of the level above have finished, for each tile of every level but the first
+layout(std430, binding = 0) coherent restrict buffer CountersBuffer
+{
+  uint counters[];
+};
+
+// xy = offset in source texels, z = weight
+const vec3 TAPS[13] = vec3[](
+  vec3(-2, -2, 1.0 / 32.0),
+  vec3( 2, -2, 1.0 / 32.0),
+  vec3(-2,  2, 1.0 / 32.0),
+  vec3( 2,  2, 1.0 / 32.0),
+  vec3( 0,  2, 2.0 / 32.0),
+  vec3( 0, -2, 2.0 / 32.0),
+  vec3( 2,  0, 2.0 / 32.0),
+  vec3(-2,  0, 2.0 / 32.0),
+  vec3( 0,  0, 4.0 / 32.0),
+  vec3(-1, -1, 4.0 / 32.0),
+  vec3( 1, -1, 4.0 / 32.0),
+  vec3(-1,  1, 4.0 / 32.0),
+  vec3( 1,  1, 4.0 / 32.0)
+);
+
+shared uvec3 s_pending[MAX_PENDING]; // level, tile
+shared uint s_numPending;
+
+// emulates the MIRRORED_REPEAT sampler that s_source uses
+vec3 LoadMirrored(uint level, ivec2 texel, ivec2 dim)
+{
+  texel = mix(texel, -texel - 1, lessThan(texel, ivec2(0)));
+  texel = mix(texel, 2 * dim - texel - 1, greaterThanEqual(texel, dim));
+  return imageLoad(i_mips[level], texel).rgb;
+}
+
+vec3 SampleBilinear(uint level, vec2 uv, ivec2 dim)
+{
+  vec2 pos = uv * vec2(dim) - 0.5;
+  ivec2 base = ivec2(floor(pos));
+  vec2 f = pos - vec2(base);
+  vec3 a = LoadMirrored(level, base, dim);
+  vec3 b = LoadMirrored(level, base + ivec2(1, 0), dim);
+  vec3 c = LoadMirrored(level, base + ivec2(0, 1), dim);
+  vec3 d = LoadMirrored(level, base + ivec2(1, 1), dim);
+  return mix(mix(a, b, f.x), mix(c, d, f.x), f.y);
+}
+
+// resolved like ResolveParticleImage.frag.glsl
+vec3 LoadParticles(ivec2 texel, ivec2 dim)
+{
+  texel = mix(texel, -texel - 1, lessThan(texel, ivec2(0)));
+  texel = min(texel, dim - 1);
+  uvec3 sum = uvec3(texelFetch(s_particlesR, texel, 0).r, texelFetch(s_particlesG, texel, 0).r, texelFetch(s_particlesB, texel, 0).r);
+  return min(vec3(sum) / 256.0, 64000.0);
+}
+
+// integer textures can't be filtered, so this matches what the sampler does to s_source by hand
+vec3 SampleParticles(vec2 uv, ivec2 dim)
+{
+  vec2 pos = uv * vec2(dim) - 0.5;
+  ivec2 base = ivec2(floor(pos));
+  vec2 f = pos - vec2(base);
+  vec3 a = LoadParticles(base, dim);
+  vec3 b = LoadParticles(base + ivec2(1, 0), dim);
+  vec3 c = LoadParticles(base + ivec2(0, 1), dim);
+  vec3 d = LoadParticles(base + ivec2(1, 1), dim);
+  return mix(mix(a, b, f.x), mix(c, d, f.x), f.y);
+}
+
+// the source region ends before the texture does, so it's clamped at its far edge instead of mirrored
+vec3 SampleSource(vec2 uv, vec2 texel)
+{
+  uv = min(uv, 1.0 - 0.5 * texel);
+  vec3 color = textureLod(s_source, uv * uniforms.sourceUvScale, 0).rgb;
+  if (uniforms.addParticles != 0)
+  {
+    color += SampleParticles(uv, uniforms.levels[0].sourceDim);
+  }
+  return color;
+}
+
+vec3 Downsample(uint level, ivec2 gid)
+{
+  Level l = uniforms.levels[level];
+  vec2 texel = 1.0 / vec2(l.sourceDim);
+
+  // center of written pixel
+  vec2 uv = (vec2(gid) + 0.5) / vec2(l.targetDim);
+
+  vec3 filterSum = vec3(0);
+  for (int i = 0; i < 13; i++)
+  {
+    vec2 tapUv = uv + texel * TAPS[i].xy;
+    vec3 tap = level == 0 ? SampleSource(tapUv, texel) : SampleBilinear(level - 1, tapUv, l.sourceDim);
+    filterSum += tap * TAPS[i].z;
+  }
+
+  return filterSum;
+}
+
+// called by one invocation after a tile of level is done
+void FinishTile(uint level, ivec2 tile)
+{
+  Level next = uniforms.levels[level + 1];
+  ivec2 numTiles = uniforms.levels[level].numTiles;
+
+  // tiles of the next level whose dependencies include this tile
+  ivec2 parentMin = max((tile - 1) / 2, ivec2(0));
+  ivec2 parentMax = min((tile + 1) / 2, next.numTiles - 1);
+  for (int y = parentMin.y; y <= parentMax.y; y++)
+  {
+    for (int x = parentMin.x; x <= parentMax.x; x++)
+    {
+      ivec2 parent = ivec2(x, y);
+      ivec2 depsMin = max(parent * 2 - 1, ivec2(0));
+      ivec2 depsMax = min(parent * 2 + 2, numTiles - 1);
+      ivec2 deps = depsMax - depsMin + 1;
+
+      uint counter = next.counterOffset + uint(parent.y * next.numTiles.x + parent.x);
+      if (atomicAdd(counters[counter], 1) + 1 == uint(deps.x * deps.y))
+      {
+        s_pending[s_numPending++] = uvec3(level + 1, parent);
+      }
+    }
+  }
+}
+
+layout(local_size_x = TILE_SIZE, local_size_y = TILE_SIZE) in;
+void main()
+{
+  if (gl_LocalInvocationIndex == 0)
+  {
+    s_pending[0] = uvec3(0, gl_WorkGroupID.xy);
+    s_numPending = 1;
+  }
+
+  while (true)
+  {
+    barrier();
+    uint numPending = s_numPending;
+    if (numPending == 0)
+      break;
+
+    uvec3 job = s_pending[numPending - 1];
+    barrier();
+
+    if (gl_LocalInvocationIndex == 0)
+    {
+      s_numPending = numPending - 1;
+    }
+
+    uint level = job.x;
+    ivec2 tile = ivec2(job.yz);
+    ivec2 gid = tile * TILE_SIZE + ivec2(gl_LocalInvocationID.xy);
+    if (all(lessThan(gid, uniforms.levels[level].targetDim)))
+    {
+      imageStore(i_mips[level], gid, vec4(Downsample(level, gid), 1.0));
+    }
+
+    if (level + 1 >= uniforms.numLevels)
+      continue;
+
+    // make the tile visible to whichever workgroup builds the next level
+    memoryBarrierImage();
+    barrier();
+
+    if (gl_LocalInvocationIndex == 0)
+    {
+      FinishTile(level, tile);
+    }
+  }
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+#version 460 core
+
+// Does what ResolveParticleImage.frag.glsl, Upsample.comp.glsl, TonemapAndDither.comp.glsl and the final blit
+// do in one pass over the window, so the HDR image is never written with particles and bloom,
+// and there is no LDR image.
+
+layout(binding = 0) uniform sampler2D s_sceneColor; // everything but the particles
+layout(binding = 1) uniform usampler2D s_particlesR;
+layout(binding = 2) uniform usampler2D s_particlesG;
+layout(binding = 3) uniform usampler2D s_particlesB;
+layout(binding = 4) uniform sampler2D s_bloom; // first level of the bloom chain
+
+layout(binding = 0, std140) uniform UniformBuffer
+{
+  ivec2 renderDim; // region of the scene and particle images that was rendered
+  ivec2 windowDim;
+  ivec2 bloomDim; // region of s_bloom that the chain covers
+  vec2 bloomUvScale; // bloomDim / size of s_bloom
+  float bloomWidth;
+  float bloomStrength; // 0 if there is no bloom
+}uniforms;
+
+layout(location = 0) out vec4 o_color;
+
+vec3 LoadHdr(ivec2 texel)
+{
+  texel = clamp(texel, ivec2(0), uniforms.renderDim - 1);
+  uvec3 particles = uvec3(texelFetch(s_particlesR, texel, 0).r, texelFetch(s_particlesG, texel, 0).r, texelFetch(s_particlesB, texel, 0).r);
+  return texelFetch(s_sceneColor, texel, 0).rgb + min(vec3(particles) / 256.0, 64000.0);
+}
+
+// bilinear, like the blit that scaled the rendered region to the window. Exact when they're the same size
+vec3 SampleHdr(vec2 uv)
+{
+  vec2 pos = uv * vec2(uniforms.renderDim) - 0.5;
+  ivec2 base = ivec2(floor(pos));
+  vec2 f = pos - vec2(base);
+  vec3 a = LoadHdr(base);
+  vec3 b = LoadHdr(base + ivec2(1, 0));
+  vec3 c = LoadHdr(base + ivec2(0, 1));
+  vec3 d = LoadHdr(base + ivec2(1, 1));
+  return mix(mix(a, b, f.x), mix(c, d, f.x), f.y);
+}
+
+// the same tent as Upsample.comp.glsl
+vec3 SampleBloom(vec2 uv)
+{
+  vec2 texel = 1.0 / vec2(uniforms.bloomDim);
+  vec2 offset = texel * uniforms.bloomWidth;
+  vec2 uvMax = 1.0 - 0.5 * texel;
+  vec2 uvScale = uniforms.bloomUvScale;
+
+  vec3 blurSum = vec3(0);
+  blurSum += textureLod(s_bloom, min(uv + vec2(-1, -1) * offset, uvMax) * uvScale, 0).rgb * 1.0 / 16.0;
+  blurSum += textureLod(s_bloom, min(uv + vec2(0, -1)  * offset, uvMax) * uvScale, 0).rgb * 2.0 / 16.0;
+  blurSum += textureLod(s_bloom, min(uv + vec2(1, -1)  * offset, uvMax) * uvScale, 0).rgb * 1.0 / 16.0;
+  blurSum += textureLod(s_bloom, min(uv + vec2(-1, 0)  * offset, uvMax) * uvScale, 0).rgb * 2.0 / 16.0;
+  blurSum += textureLod(s_bloom, min(uv + vec2(0, 0)   * offset, uvMax) * uvScale, 0).rgb * 4.0 / 16.0;
+  blurSum += textureLod(s_bloom, min(uv + vec2(1, 0)   * offset, uvMax) * uvScale, 0).rgb * 2.0 / 16.0;
+  blurSum += textureLod(s_bloom, min(uv + vec2(-1, 1)  * offset, uvMax) * uvScale, 0).rgb * 1.0 / 16.0;
+  blurSum += textureLod(s_bloom, min(uv + vec2(0, 1)   * offset, uvMax) * uvScale, 0).rgb * 2.0 / 16.0;
+  blurSum += textureLod(s_bloom, min(uv + vec2(1, 1)   * offset, uvMax) * uvScale, 0).rgb * 1.0 / 16.0;
+  return blurSum;
+}
+
+// keep in sync with TonemapAndDither.comp.glsl
+vec3 aces_approx(vec3 v)
+{
+  v *= 0.6f;
+  float a = 2.51f;
+  float b = 0.03f;
+  float c = 2.43f;
+  float d = 0.59f;
+  float e = 0.14f;
+  return clamp((v * (a * v + b)) / (v * (c * v + d) + e), 0.0f, 1.0f);
+}
+
+vec3 linear_to_srgb(vec3 linearColor)
+{
+  bvec3 cutoff = lessThan(linearColor, vec3(0.0031308));
+  vec3 higher = vec3(1.055) * pow(linearColor, vec3(1.0 / 2.4)) - vec3(0.055);
+  vec3 lower = linearColor * vec3(12.92);
+
+  return mix(higher, lower, cutoff);
+}
+
+void main()
+{
+  vec2 uv = gl_FragCoord.xy / vec2(uniforms.windowDim);
+
+  vec3 hdrColor = SampleHdr(uv);
+  if (uniforms.bloomStrength > 0.0)
+  {
+    hdrColor += SampleBloom(uv) * uniforms.bloomStrength;
+  }
+
+  o_color = vec4(linear_to_srgb(aces_approx(hdrColor)), 1.0);
+}
\ No newline at end of file
@@ -5,6 +5,12 @@ layout(binding = 0) uniform sampler2D s_sceneColor;
 
 layout(binding = 0) uniform writeonly restrict image2D i_finalColor;
 
+// the rendered region of both images. It's scaled to the window when it's blitted
+layout(std140, binding = 0) uniform TargetUniforms
+{
+  ivec2 targetDim;
+};
+
 vec3 aces_approx(vec3 v)
 {
   v *= 0.6f;
@@ -36,12 +42,10 @@ layout(local_size_x = 8, local_size_y = 8) in;
 void main()
 {
   ivec2 gid = ivec2(gl_GlobalInvocationID.xy);
-  ivec2 targetDim = imageSize(i_finalColor);
   if (any(greaterThanEqual(gid, targetDim)))
     return;
-  vec2 uv = (vec2(gid) + 0.5) / targetDim;
 
-  vec3 hdrColor = textureLod(s_sceneColor, uv, 0).rgb;
+  vec3 hdrColor = texelFetch(s_sceneColor, gid, 0).rgb;
   vec3 ldrColor = aces_approx(hdrColor);
   vec3 srgbColor = linear_to_srgb(ldrColor);
   //vec3 ditheredColor = apply_dither(srgbColor, uv);
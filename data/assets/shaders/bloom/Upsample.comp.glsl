@@ -12,6 +12,7 @@ layout(binding = 0, std140) uniform UniformBuffer
   float strength;
   float sourceLod;
   float targetLod;
+  vec2 sourceUvScale; // sourceDim / size of the source mip
 }uniforms;
 
 layout(local_size_x = 16, local_size_y = 16) in;
@@ -30,16 +31,22 @@ void main()
   vec4 rgba = texelFetch(s_targetRead, gid, int(uniforms.targetLod));
   //vec4 rgba = textureLod(s_targetRead, uv, 0);
 
+  // the source may only cover part of its mip, so clamp to its far edge and scale into it
+  vec2 offset = texel * uniforms.width;
+  vec2 uvMax = 1.0 - 0.5 * texel;
+  vec2 uvScale = uniforms.sourceUvScale;
+  float lod = uniforms.sourceLod;
+
   vec4 blurSum = vec4(0);
-  blurSum += textureLod(s_source, uv + vec2(-1, -1) * texel * uniforms.width, uniforms.sourceLod) * 1.0 / 16.0;
-  blurSum += textureLod(s_source, uv + vec2(0, -1)  * texel * uniforms.width, uniforms.sourceLod) * 2.0 / 16.0;
-  blurSum += textureLod(s_source, uv + vec2(1, -1)  * texel * uniforms.width, uniforms.sourceLod) * 1.0 / 16.0;
-  blurSum += textureLod(s_source, uv + vec2(-1, 0)  * texel * uniforms.width, uniforms.sourceLod) * 2.0 / 16.0;
-  blurSum += textureLod(s_source, uv + vec2(0, 0)   * texel * uniforms.width, uniforms.sourceLod) * 4.0 / 16.0;
-  blurSum += textureLod(s_source, uv + vec2(1, 0)   * texel * uniforms.width, uniforms.sourceLod) * 2.0 / 16.0;
-  blurSum += textureLod(s_source, uv + vec2(-1, 1)  * texel * uniforms.width, uniforms.sourceLod) * 1.0 / 16.0;
-  blurSum += textureLod(s_source, uv + vec2(0, 1)   * texel * uniforms.width, uniforms.sourceLod) * 2.0 / 16.0;
-  blurSum += textureLod(s_source, uv + vec2(1, 1)   * texel * uniforms.width, uniforms.sourceLod) * 1.0 / 16.0;
+  blurSum += textureLod(s_source, min(uv + vec2(-1, -1) * offset, uvMax) * uvScale, lod) * 1.0 / 16.0;
+  blurSum += textureLod(s_source, min(uv + vec2(0, -1)  * offset, uvMax) * uvScale, lod) * 2.0 / 16.0;
+  blurSum += textureLod(s_source, min(uv + vec2(1, -1)  * offset, uvMax) * uvScale, lod) * 1.0 / 16.0;
+  blurSum += textureLod(s_source, min(uv + vec2(-1, 0)  * offset, uvMax) * uvScale, lod) * 2.0 / 16.0;
+  blurSum += textureLod(s_source, min(uv + vec2(0, 0)   * offset, uvMax) * uvScale, lod) * 4.0 / 16.0;
+  blurSum += textureLod(s_source, min(uv + vec2(1, 0)   * offset, uvMax) * uvScale, lod) * 2.0 / 16.0;
+  blurSum += textureLod(s_source, min(uv + vec2(-1, 1)  * offset, uvMax) * uvScale, lod) * 1.0 / 16.0;
+  blurSum += textureLod(s_source, min(uv + vec2(0, 1)   * offset, uvMax) * uvScale, lod) * 2.0 / 16.0;
+  blurSum += textureLod(s_source, min(uv + vec2(1, 1)   * offset, uvMax) * uvScale, lod) * 1.0 / 16.0;
   rgba += blurSum * uniforms.strength;
 
   imageStore(i_targetWrite, gid, rgba);
@@ -0,0 +1,67 @@
+#version 460 core
+
+// Adds every smaller mip of the bloom chain to the first one in one pass.
+// Each mip gets the same tent filter that the old per-mip upsample passes applied,
+// but sampled directly instead of being blurred into the next mip up first.
+
+// keep in sync with DownsampleChain.comp.glsl
+#define MAX_LEVELS 8
+
+struct Level
+{
+  ivec2 sourceDim;
+  ivec2 targetDim;
+  ivec2 numTiles;
+  uint counterOffset;
+  uint _padding;
+  vec2 uvScale;
+  vec2 _padding1;
+};
+
+layout(binding = 0) uniform sampler2D s_mips;
+layout(binding = 0, rgba16f) restrict uniform image2D i_target;
+
+layout(binding = 0, std140) uniform UniformBuffer
+{
+  Level levels[MAX_LEVELS];
+  uint numLevels;
+  float width;
+  vec2 sourceUvScale;
+}uniforms;
+
+layout(local_size_x = 16, local_size_y = 16) in;
+void main()
+{
+  ivec2 gid = ivec2(gl_GlobalInvocationID.xy);
+  ivec2 targetDim = uniforms.levels[0].targetDim;
+
+  if (any(greaterThanEqual(gid, targetDim)))
+    return;
+
+  // center of written pixel
+  vec2 uv = (vec2(gid) + 0.5) / targetDim;
+
+  vec4 rgba = imageLoad(i_target, gid);
+  for (uint level = 1; level < uniforms.numLevels; level++)
+  {
+    vec2 texel = uniforms.width / vec2(uniforms.levels[level].targetDim);
+    vec2 uvScale = uniforms.levels[level].uvScale;
+    vec2 uvMax = 1.0 - 0.5 / vec2(uniforms.levels[level].targetDim);
+    float lod = float(level);
+
+    // the chain may only cover part of each mip, so clamp to its far edge and scale into it
+    vec4 blurSum = vec4(0);
+    blurSum += textureLod(s_mips, min(uv + vec2(-1, -1) * texel, uvMax) * uvScale, lod) * 1.0 / 16.0;
+    blurSum += textureLod(s_mips, min(uv + vec2(0, -1)  * texel, uvMax) * uvScale, lod) * 2.0 / 16.0;
+    blurSum += textureLod(s_mips, min(uv + vec2(1, -1)  * texel, uvMax) * uvScale, lod) * 1.0 / 16.0;
+    blurSum += textureLod(s_mips, min(uv + vec2(-1, 0)  * texel, uvMax) * uvScale, lod) * 2.0 / 16.0;
+    blurSum += textureLod(s_mips, min(uv + vec2(0, 0)   * texel, uvMax) * uvScale, lod) * 4.0 / 16.0;
+    blurSum += textureLod(s_mips, min(uv + vec2(1, 0)   * texel, uvMax) * uvScale, lod) * 2.0 / 16.0;
+    blurSum += textureLod(s_mips, min(uv + vec2(-1, 1)  * texel, uvMax) * uvScale, lod) * 1.0 / 16.0;
+    blurSum += textureLod(s_mips, min(uv + vec2(0, 1)   * texel, uvMax) * uvScale, lod) * 2.0 / 16.0;
+    blurSum += textureLod(s_mips, min(uv + vec2(1, 1)   * texel, uvMax) * uvScale, lod) * 1.0 / 16.0;
+    rgba += blurSum;
+  }
+
+  imageStore(i_target, gid, rgba);
+}
\ No newline at end of file
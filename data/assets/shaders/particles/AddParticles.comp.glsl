@@ -24,6 +24,13 @@ layout(std430, binding = 2) readonly restrict buffer ParticlesCopyBuffer
   Particle list[];
 }inParticles;
 
+// new particles are appended to the list of live particles that the next update will read
+layout(std430, binding = 3) coherent restrict buffer LiveIndicesBuffer
+{
+  int size;
+  int indices[];
+}liveIndices;
+
 layout(local_size_x = 512, local_size_y = 1, local_size_z = 1) in;
 void main()
 {
@@ -43,4 +50,5 @@ void main()
 
   int particleIndex = tombstones.indices[indexIndex];
   outParticles.list[particleIndex] = inParticles.list[index];
+  liveIndices.indices[atomicAdd(liveIndices.size, 1)] = particleIndex;
 }
\ No newline at end of file
@@ -0,0 +1,66 @@
+#version 460 core
+
+// First pass of the tiled particle splat: counts how many particles land in each screen tile.
+// Each particle remembers its tile and its slot in that tile so ScatterParticles.comp.glsl doesn't need atomics.
+
+// keep in sync with Renderer.cpp
+#define TILE_SIZE 16
+#define OFFSCREEN 0xFFFFFFFFu
+
+struct Particle
+{
+  vec2 position;
+  uvec2 emissive; // packed 16-bit float RGBA
+  uint velocity; // packed 16-bit float XY
+  float lifetime;
+};
+
+layout(std430, binding = 0) readonly restrict buffer ParticlesBuffer
+{
+  Particle list[];
+}particles;
+
+layout(std430, binding = 1) readonly restrict buffer RenderIndicesBuffer
+{
+  int size;
+  int indices[];
+}renderIndices;
+
+layout(std430, binding = 2) restrict buffer TileCountsBuffer
+{
+  uint counts[];
+}tileCounts;
+
+// x = tile, y = slot in tile
+layout(std430, binding = 3) writeonly restrict buffer ParticleKeysBuffer
+{
+  uvec2 keys[];
+}particleKeys;
+
+layout(std140, binding = 0) uniform TargetUniforms
+{
+  ivec2 targetDim;
+  ivec2 numTiles;
+};
+
+layout(local_size_x = 512, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+  uint index = gl_GlobalInvocationID.x;
+  if (index >= renderIndices.size)
+    return;
+
+  Particle particle = particles.list[renderIndices.indices[index]];
+
+  // [-1, 1) -> [0, imageDim)
+  ivec2 uv = ivec2(((particle.position + 1.0) / 2.0) * vec2(targetDim));
+  if (any(greaterThanEqual(uv, targetDim)) || any(lessThan(uv, ivec2(0))))
+  {
+    particleKeys.keys[index] = uvec2(OFFSCREEN, 0);
+    return;
+  }
+
+  ivec2 tileCoord = uv / TILE_SIZE;
+  uint tile = uint(tileCoord.y * numTiles.x + tileCoord.x);
+  particleKeys.keys[index] = uvec2(tile, atomicAdd(tileCounts.counts[tile], 1));
+}
\ No newline at end of file
@@ -0,0 +1,132 @@
+#version 460 core
+
+struct Particle
+{
+  vec2 position;
+  uvec2 emissive; // packed 16-bit float RGBA
+  uint velocity; // packed 16-bit float XY
+  float lifetime;
+};
+
+layout(std430, binding = 0) writeonly restrict buffer ParticlesBuffer
+{
+  Particle list[];
+}outParticles;
+
+layout(std430, binding = 1) coherent restrict buffer TombstonesBuffer
+{
+  int size;
+  int indices[];
+}tombstones;
+
+layout(std430, binding = 2) coherent restrict buffer LiveIndicesBuffer
+{
+  int size;
+  int indices[];
+}liveIndices;
+
+// mirrors ecs::EmitParticles
+struct Emitter
+{
+  vec4 color;
+  vec2 center;
+  float radius;
+  float lifetime;
+  uint count;
+  uint shape;
+  uint seed;
+  uint firstParticle; // the first invocation that belongs to this emitter
+};
+
+layout(std430, binding = 3) readonly restrict buffer EmittersBuffer
+{
+  Emitter emitters[];
+};
+
+layout(std140, binding = 0) uniform Uniforms
+{
+  uint numEmitters;
+  uint numParticles;
+}uniforms;
+
+#define SHAPE_DISK 0
+#define SHAPE_SQUARE 1
+
+vec2 Hammersley(uint i, uint N)
+{
+  return vec2(float(i) / float(N), float(bitfieldReverse(i)) * 2.3283064365386963e-10);
+}
+
+uint Hash(uint x)
+{
+  x ^= x >> 16;
+  x *= 0x7feb352du;
+  x ^= x >> 15;
+  x *= 0x846ca68bu;
+  x ^= x >> 16;
+  return x;
+}
+
+// keep in sync with cpu::ParticleSimulation::Emit
+layout(local_size_x = 512, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+  if (gl_GlobalInvocationID.x >= uniforms.numParticles)
+  {
+    return;
+  }
+
+  // find the last emitter that starts at or before this invocation
+  uint first = 0;
+  uint last = uniforms.numEmitters - 1;
+  while (first < last)
+  {
+    uint middle = (first + last + 1) / 2;
+    if (emitters[middle].firstParticle <= gl_GlobalInvocationID.x)
+    {
+      first = middle;
+    }
+    else
+    {
+      last = middle - 1;
+    }
+  }
+
+  Emitter emitter = emitters[first];
+  uint index = gl_GlobalInvocationID.x - emitter.firstParticle;
+
+  // undo decrement and return if nothing in freelist
+  int indexIndex = atomicAdd(tombstones.size, -1) - 1;
+  if (indexIndex < 0)
+  {
+    atomicAdd(tombstones.size, 1);
+    return;
+  }
+
+  // rotate the point set by the seed, wrapping around to stay in (0, 1]
+  vec2 xi = Hammersley(index + 1, emitter.count);
+  xi += vec2(Hash(emitter.seed), Hash(emitter.seed * 0x9e3779b9u)) * 2.3283064365386963e-10;
+  xi -= vec2(greaterThan(xi, vec2(1.0)));
+
+  vec2 offset;
+  if (emitter.shape == SHAPE_SQUARE)
+  {
+    offset = (xi * 2.0 - 1.0) * emitter.radius;
+  }
+  else
+  {
+    float r = sqrt(xi.x) * emitter.radius;
+    float theta = xi.y * 6.283;
+    offset = vec2(r * cos(theta), r * sin(theta));
+  }
+
+  Particle particle;
+  particle.position = clamp(emitter.center + offset, vec2(-1), vec2(1));
+  particle.emissive = uvec2(packHalf2x16(emitter.color.rg), packHalf2x16(emitter.color.ba));
+  particle.velocity = packHalf2x16(vec2(0));
+  particle.lifetime = emitter.lifetime;
+
+  int particleIndex = tombstones.indices[indexIndex];
+  outParticles.list[particleIndex] = particle;
+  liveIndices.indices[atomicAdd(liveIndices.size, 1)] = particleIndex;
+}
\ No newline at end of file
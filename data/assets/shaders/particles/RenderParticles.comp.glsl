@@ -24,6 +24,12 @@ layout(binding = 0, r32ui) restrict uniform uimage2D i_target_r;
 layout(binding = 1, r32ui) restrict uniform uimage2D i_target_g;
 layout(binding = 2, r32ui) restrict uniform uimage2D i_target_b;
 
+// the region of the images that is rendered to, which is smaller than them when the resolution is scaled down
+layout(std140, binding = 0) uniform TargetUniforms
+{
+  ivec2 targetDim;
+};
+
 layout(local_size_x = 512, local_size_y = 1, local_size_z = 1) in;
 void main()
 {
@@ -34,8 +40,7 @@ void main()
   int indexIndex = renderIndices.indices[index];
   Particle particle = particles.list[indexIndex];
 
-  ivec2 targetDim = imageSize(i_target_r);
-  // [-1, 1) -> [0, imageDim)
+  // [-1, 1) -> [0, targetDim)
   ivec2 uv = ivec2(((particle.position + 1.0) / 2.0) * vec2(targetDim));
   if (any(greaterThanEqual(uv, targetDim)) || any(lessThan(uv, ivec2(0))))
     return;
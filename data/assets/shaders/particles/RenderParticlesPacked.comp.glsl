@@ -0,0 +1,62 @@
+#version 460 core
+#extension GL_ARB_gpu_shader_int64 : require
+#extension GL_NV_shader_atomic_int64 : require
+
+// Same as RenderParticles.comp.glsl, but all three channels are accumulated with a single 64-bit atomic.
+// Each channel gets 21 bits of 11.5 fixed point, so a pixel holds up to 65535 before it overflows.
+// The resolve clamps at 64000 anyway, so only pixels that are already blown out can overflow.
+
+struct Particle
+{
+  vec2 position;
+  uvec2 emissive; // packed 16-bit float RGBA
+  uint velocity; // packed 16-bit float XY
+  float lifetime;
+};
+
+layout(std430, binding = 0) readonly restrict buffer ParticlesBuffer
+{
+  Particle list[];
+}particles;
+
+layout(std430, binding = 1) readonly restrict buffer RenderIndicesBuffer
+{
+  int size;
+  int indices[];
+}renderIndices;
+
+layout(std430, binding = 2) restrict buffer TargetBuffer
+{
+  uint64_t pixels[];
+}target;
+
+layout(std140, binding = 0) uniform TargetUniforms
+{
+  ivec2 targetDim;
+};
+
+const float CHANNEL_SCALE = 32.0;
+const uint CHANNEL_MAX = (1u << 21) - 1u;
+
+layout(local_size_x = 512, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+  uint index = gl_GlobalInvocationID.x;
+  if (index >= renderIndices.size)
+    return;
+
+  int indexIndex = renderIndices.indices[index];
+  Particle particle = particles.list[indexIndex];
+
+  // [-1, 1) -> [0, imageDim)
+  ivec2 uv = ivec2(((particle.position + 1.0) / 2.0) * vec2(targetDim));
+  if (any(greaterThanEqual(uv, targetDim)) || any(lessThan(uv, ivec2(0))))
+    return;
+  
+  vec4 color = vec4(unpackHalf2x16(particle.emissive.x), unpackHalf2x16(particle.emissive.y));
+  color.b *= color.w;
+  if (particle.lifetime < 1.0) color *= particle.lifetime;
+  uvec3 colorQuantized = min(uvec3(color.rgb * CHANNEL_SCALE + 0.5), uvec3(CHANNEL_MAX));
+  uint64_t packed = uint64_t(colorQuantized.r) | (uint64_t(colorQuantized.g) << 21) | (uint64_t(colorQuantized.b) << 42);
+  atomicAdd(target.pixels[uv.y * targetDim.x + uv.x], packed);
+}
\ No newline at end of file
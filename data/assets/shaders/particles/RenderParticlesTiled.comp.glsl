@@ -0,0 +1,91 @@
+#version 460 core
+
+// Splats the particles of one tile into shared memory, then writes the whole tile out once.
+// Every pixel is written, so the targets don't need to be cleared beforehand.
+
+// keep in sync with Renderer.cpp
+#define TILE_SIZE 16
+
+struct Particle
+{
+  vec2 position;
+  uvec2 emissive; // packed 16-bit float RGBA
+  uint velocity; // packed 16-bit float XY
+  float lifetime;
+};
+
+layout(std430, binding = 0) readonly restrict buffer ParticlesBuffer
+{
+  Particle list[];
+}particles;
+
+layout(std430, binding = 1) readonly restrict buffer TileCountsBuffer
+{
+  uint counts[];
+}tileCounts;
+
+layout(std430, binding = 2) readonly restrict buffer TileOffsetsBuffer
+{
+  uint offsets[];
+}tileOffsets;
+
+layout(std430, binding = 3) readonly restrict buffer SortedIndicesBuffer
+{
+  int indices[];
+}sortedIndices;
+
+layout(std140, binding = 0) uniform TargetUniforms
+{
+  ivec2 targetDim;
+  ivec2 numTiles;
+};
+
+layout(binding = 0, r32ui) writeonly restrict uniform uimage2D i_target_r;
+layout(binding = 1, r32ui) writeonly restrict uniform uimage2D i_target_g;
+layout(binding = 2, r32ui) writeonly restrict uniform uimage2D i_target_b;
+
+shared uint s_r[TILE_SIZE * TILE_SIZE];
+shared uint s_g[TILE_SIZE * TILE_SIZE];
+shared uint s_b[TILE_SIZE * TILE_SIZE];
+
+layout(local_size_x = TILE_SIZE, local_size_y = TILE_SIZE, local_size_z = 1) in;
+void main()
+{
+  const uint localIndex = gl_LocalInvocationIndex;
+  s_r[localIndex] = 0;
+  s_g[localIndex] = 0;
+  s_b[localIndex] = 0;
+  barrier();
+
+  const uint tile = gl_WorkGroupID.y * uint(numTiles.x) + gl_WorkGroupID.x;
+  const uint first = tileOffsets.offsets[tile];
+  const uint count = tileCounts.counts[tile];
+  const ivec2 tileOrigin = ivec2(gl_WorkGroupID.xy) * TILE_SIZE;
+
+  for (uint i = localIndex; i < count; i += TILE_SIZE * TILE_SIZE)
+  {
+    Particle particle = particles.list[sortedIndices.indices[first + i]];
+
+    // must match BinParticles.comp.glsl exactly so the particle lands in this tile
+    ivec2 uv = ivec2(((particle.position + 1.0) / 2.0) * vec2(targetDim));
+    ivec2 local = uv - tileOrigin;
+    uint slot = uint(local.y * TILE_SIZE + local.x);
+
+    vec4 color = vec4(unpackHalf2x16(particle.emissive.x), unpackHalf2x16(particle.emissive.y));
+    color.b *= color.w;
+    if (particle.lifetime < 1.0) color *= particle.lifetime;
+    uvec4 colorQuantized = uvec4(color * 256.0 + 0.5);
+    atomicAdd(s_r[slot], colorQuantized.r);
+    atomicAdd(s_g[slot], colorQuantized.g);
+    atomicAdd(s_b[slot], colorQuantized.b);
+  }
+  barrier();
+
+  ivec2 pixel = tileOrigin + ivec2(gl_LocalInvocationID.xy);
+  if (all(lessThan(pixel, targetDim)))
+  {
+    imageStore(i_target_r, pixel, uvec4(s_r[localIndex]));
+    imageStore(i_target_g, pixel, uvec4(s_g[localIndex]));
+    imageStore(i_target_b, pixel, uvec4(s_b[localIndex]));
+  }
+}
\ No newline at end of file
@@ -1,7 +1,5 @@
 #version 460 core
 
-layout(location = 0) in vec2 v_uv;
-
 layout(binding = 0) uniform usampler2D s_target_r;
 layout(binding = 1) uniform usampler2D s_target_g;
 layout(binding = 2) uniform usampler2D s_target_b;
@@ -10,10 +8,12 @@ layout(location = 0) out vec4 o_color;
 
 void main()
 {
+  // the viewport may only cover part of the images, so they can't be sampled with normalized coordinates
+  ivec2 coord = ivec2(gl_FragCoord.xy);
   o_color = vec4(
-    min(float(texture(s_target_r, v_uv).r) / 256.0, 64000),
-    min(float(texture(s_target_g, v_uv).r) / 256.0, 64000),
-    min(float(texture(s_target_b, v_uv).r) / 256.0, 64000),
+    min(float(texelFetch(s_target_r, coord, 0).r) / 256.0, 64000),
+    min(float(texelFetch(s_target_g, coord, 0).r) / 256.0, 64000),
+    min(float(texelFetch(s_target_b, coord, 0).r) / 256.0, 64000),
     1.0
   );
 }
\ No newline at end of file
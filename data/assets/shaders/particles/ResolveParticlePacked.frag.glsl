@@ -0,0 +1,31 @@
+#version 460 core
+
+// Resolves the target of RenderParticlesPacked.comp.glsl. Each pixel is read as two 32-bit halves,
+// so this doesn't need 64-bit integer support.
+
+layout(std430, binding = 0) readonly restrict buffer TargetBuffer
+{
+  uvec2 pixels[];
+}target;
+
+layout(std140, binding = 0) uniform TargetUniforms
+{
+  ivec2 targetDim;
+};
+
+layout(location = 0) out vec4 o_color;
+
+const float CHANNEL_SCALE = 32.0;
+const uint CHANNEL_MASK = (1u << 21) - 1u;
+
+void main()
+{
+  ivec2 coord = ivec2(gl_FragCoord.xy);
+  uvec2 pixel = target.pixels[coord.y * targetDim.x + coord.x];
+  uvec3 color = uvec3(
+    pixel.x & CHANNEL_MASK,
+    ((pixel.x >> 21) | (pixel.y << 11)) & CHANNEL_MASK,
+    (pixel.y >> 10) & CHANNEL_MASK
+  );
+  o_color = vec4(min(vec3(color) / CHANNEL_SCALE, vec3(64000)), 1.0);
+}
\ No newline at end of file
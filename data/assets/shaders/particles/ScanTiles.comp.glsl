@@ -0,0 +1,62 @@
+#version 460 core
+
+// Turns tile counts into the offset of each tile's first particle (exclusive prefix sum).
+// Dispatched as a single workgroup. Each invocation scans a contiguous run of tiles.
+
+#define WORKGROUP_SIZE 1024
+
+layout(std430, binding = 0) readonly restrict buffer TileCountsBuffer
+{
+  uint counts[];
+}tileCounts;
+
+layout(std430, binding = 1) writeonly restrict buffer TileOffsetsBuffer
+{
+  uint offsets[];
+}tileOffsets;
+
+layout(std140, binding = 0) uniform TargetUniforms
+{
+  ivec2 targetDim;
+  ivec2 numTiles;
+};
+
+shared uint s_scan[WORKGROUP_SIZE];
+
+layout(local_size_x = WORKGROUP_SIZE, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+  const uint localIndex = gl_LocalInvocationIndex;
+  const uint totalTiles = uint(numTiles.x * numTiles.y);
+  const uint tilesPerInvocation = (totalTiles + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE;
+  const uint begin = min(localIndex * tilesPerInvocation, totalTiles);
+  const uint end = min(begin + tilesPerInvocation, totalTiles);
+
+  uint sum = 0;
+  for (uint i = begin; i < end; i++)
+  {
+    sum += tileCounts.counts[i];
+  }
+
+  s_scan[localIndex] = sum;
+  barrier();
+
+  for (uint stride = 1; stride < WORKGROUP_SIZE; stride <<= 1)
+  {
+    uint value = s_scan[localIndex];
+    if (localIndex >= stride)
+    {
+      value += s_scan[localIndex - stride];
+    }
+    barrier();
+    s_scan[localIndex] = value;
+    barrier();
+  }
+
+  uint offset = s_scan[localIndex] - sum;
+  for (uint i = begin; i < end; i++)
+  {
+    tileOffsets.offsets[i] = offset;
+    offset += tileCounts.counts[i];
+  }
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#version 460 core
+
+// Writes each particle's index to its slot in the tile-sorted list.
+
+#define OFFSCREEN 0xFFFFFFFFu
+
+layout(std430, binding = 1) readonly restrict buffer RenderIndicesBuffer
+{
+  int size;
+  int indices[];
+}renderIndices;
+
+layout(std430, binding = 2) readonly restrict buffer TileOffsetsBuffer
+{
+  uint offsets[];
+}tileOffsets;
+
+layout(std430, binding = 3) readonly restrict buffer ParticleKeysBuffer
+{
+  uvec2 keys[];
+}particleKeys;
+
+layout(std430, binding = 4) writeonly restrict buffer SortedIndicesBuffer
+{
+  int indices[];
+}sortedIndices;
+
+layout(local_size_x = 512, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+  uint index = gl_GlobalInvocationID.x;
+  if (index >= renderIndices.size)
+    return;
+
+  uvec2 key = particleKeys.keys[index];
+  if (key.x == OFFSCREEN)
+    return;
+
+  sortedIndices.indices[tileOffsets.offsets[key.x] + key.y] = renderIndices.indices[index];
+}
\ No newline at end of file
@@ -8,10 +8,23 @@ struct Particle
   float lifetime;
 };
 
-struct Box
+// keep in sync with ParticleSystem.cpp
+#define WALL_GRID_SIZE 16
+#define MAX_SUBSTEPS 16
+#define MAX_SHARED_WALL_INDICES 1024
+#define MAX_SHARED_WALL_BOUNDS 1024
+
+// a range of WallBinsBuffer.wallIndices
+struct WallTile
 {
-  vec2 position;
-  vec2 scale;
+  uint offset;
+  uint count;
+};
+
+struct WallBounds
+{
+  vec2 boundsMin;
+  vec2 boundsMax;
 };
 
 layout(std430, binding = 0) restrict buffer ParticlesBuffer
@@ -19,52 +32,158 @@ layout(std430, binding = 0) restrict buffer ParticlesBuffer
   Particle list[];
 }particles;
 
-layout(std430, binding = 1) coherent restrict buffer TombstonesBuffer
+layout(std430, binding = 1) restrict buffer TombstonesBuffer
 {
-  coherent int size;
+  int size;
   int indices[];
 }tombstones;
 
-layout(std430, binding = 2) coherent restrict buffer RenderIndicesBuffer
+// indices of particles that were alive before this update
+layout(std430, binding = 2) readonly restrict buffer LiveIndicesInBuffer
+{
+  int size;
+  int indices[];
+}liveIn;
+
+// indices of particles that are still alive after this update (also used for rendering)
+layout(std430, binding = 3) restrict buffer LiveIndicesOutBuffer
 {
-  coherent int size;
+  int size;
   int indices[];
-}renderIndices;
+}liveOut;
 
-layout(std430, binding = 3) readonly restrict buffer WallBuffer
+// walls binned into a grid over [-1, 1], where walls are referenced by every tile they overlap during any substep
+layout(std430, binding = 4) readonly restrict buffer WallBinsBuffer
 {
-  Box list[];
-}walls;
+  WallTile tiles[WALL_GRID_SIZE * WALL_GRID_SIZE];
+  uint wallIndices[];
+}wallBins;
+
+// bounds of every wall in every substep, indexed by substep * numWalls + wall
+layout(std430, binding = 5) readonly restrict buffer WallBoundsBuffer
+{
+  WallBounds list[];
+}wallBounds;
 
 layout(std140, binding = 0) uniform Uniforms
 {
-  float dt;
   float magnetism;
-  vec2 cursorPosition;
   float friction;
   float accelerationConstant; // 0 = use dynamic acceleration
   float accelerationMinDistance;
+  uint numSubsteps;
+  uint numWalls;
+  vec4 substeps[MAX_SUBSTEPS]; // xy = cursor position, z = dt
 }uniforms;
 
-layout(local_size_x = 512, local_size_y = 1, local_size_z = 1) in;
-void main()
+#define WORKGROUP_SIZE 512
+
+// alive count in the low 16 bits, died count in the high 16 bits
+#define STATUS_ALIVE 1u
+#define STATUS_DIED (1u << 16)
+shared uint s_scan[WORKGROUP_SIZE];
+shared int s_aliveBase;
+shared int s_diedBase;
+
+// particles in a workgroup can be anywhere, so every tile is staged
+shared WallTile s_wallTiles[WALL_GRID_SIZE * WALL_GRID_SIZE];
+shared uint s_wallIndices[MAX_SHARED_WALL_INDICES];
+shared WallBounds s_wallBounds[MAX_SHARED_WALL_BOUNDS];
+
+// positions outside the grid use the closest tile
+uint WallTileIndex(vec2 position)
+{
+  ivec2 tile = clamp(ivec2(floor((position + 1.0) * (WALL_GRID_SIZE / 2.0))), ivec2(0), ivec2(WALL_GRID_SIZE - 1));
+  return tile.y * WALL_GRID_SIZE + tile.x;
+}
+
+void LoadWalls()
 {
-  int index = int(gl_GlobalInvocationID.x);
-  
-  if (index >= particles.list.length())
+  for (uint i = gl_LocalInvocationIndex; i < WALL_GRID_SIZE * WALL_GRID_SIZE; i += WORKGROUP_SIZE)
   {
-    return;
+    s_wallTiles[i] = wallBins.tiles[i];
   }
 
-  Particle particle = particles.list[index];
+  // anything that doesn't fit is read from global memory
+  const uint numSharedIndices = min(uint(wallBins.wallIndices.length()), MAX_SHARED_WALL_INDICES);
+  for (uint i = gl_LocalInvocationIndex; i < numSharedIndices; i += WORKGROUP_SIZE)
+  {
+    s_wallIndices[i] = wallBins.wallIndices[i];
+  }
+
+  const uint numSharedBounds = min(uniforms.numSubsteps * uniforms.numWalls, MAX_SHARED_WALL_BOUNDS);
+  for (uint i = gl_LocalInvocationIndex; i < numSharedBounds; i += WORKGROUP_SIZE)
+  {
+    s_wallBounds[i] = wallBounds.list[i];
+  }
+
+  barrier();
+}
+
+uint GetWallIndex(uint i)
+{
+  return i < MAX_SHARED_WALL_INDICES ? s_wallIndices[i] : wallBins.wallIndices[i];
+}
+
+WallBounds GetWallBounds(uint substep, uint wall)
+{
+  const uint i = substep * uniforms.numWalls + wall;
+  return i < MAX_SHARED_WALL_BOUNDS ? s_wallBounds[i] : wallBounds.list[i];
+}
+
+// Compacts the indices of particles that are alive or just died into liveOut and tombstones.
+// A workgroup-wide prefix sum gives each particle its slot, so only one atomic per list is needed per workgroup.
+void WriteIndex(int index, uint status)
+{
+  const uint localIndex = gl_LocalInvocationIndex;
+  s_scan[localIndex] = status;
+  barrier();
+
+  for (uint stride = 1; stride < WORKGROUP_SIZE; stride <<= 1)
+  {
+    uint value = s_scan[localIndex];
+    if (localIndex >= stride)
+    {
+      value += s_scan[localIndex - stride];
+    }
+    barrier();
+    s_scan[localIndex] = value;
+    barrier();
+  }
+
+  const uint inclusive = s_scan[localIndex];
+  const uint exclusive = inclusive - status;
+  if (localIndex == WORKGROUP_SIZE - 1)
+  {
+    s_aliveBase = atomicAdd(liveOut.size, int(inclusive & 0xFFFF));
+    s_diedBase = atomicAdd(tombstones.size, int(inclusive >> 16));
+  }
+  barrier();
+
+  if (status == STATUS_ALIVE)
+  {
+    liveOut.indices[s_aliveBase + int(exclusive & 0xFFFF)] = index;
+  }
+  else if (status == STATUS_DIED)
+  {
+    tombstones.indices[s_diedBase + int(exclusive >> 16)] = index;
+  }
+}
+
+// Advances the particle by one substep.
+void Step(inout Particle particle, uint substep, WallTile tile)
+{
+  const float dt = uniforms.substeps[substep].z;
+  const vec2 cursorPosition = uniforms.substeps[substep].xy;
+
   // https://gamedev.stackexchange.com/a/109046
-  vec2 velocity = unpackHalf2x16(particle.velocity) * (1.0 / (1.0 + (uniforms.dt * uniforms.friction)));
-  float accelMagnitude = uniforms.magnetism / max(uniforms.accelerationMinDistance, distance(uniforms.cursorPosition, particle.position));
+  vec2 velocity = unpackHalf2x16(particle.velocity) * (1.0 / (1.0 + (dt * uniforms.friction)));
+  float accelMagnitude = uniforms.magnetism / max(uniforms.accelerationMinDistance, distance(cursorPosition, particle.position));
   if (uniforms.accelerationConstant != 0)
   {
     accelMagnitude = uniforms.accelerationConstant;
   }
-  vec2 acceleration = accelMagnitude * normalize(uniforms.cursorPosition - particle.position);
+  vec2 acceleration = accelMagnitude * normalize(cursorPosition - particle.position);
 
   // visualize velocity
   //particle.emissive.x = packHalf2x16(abs(velocity) * .2);
@@ -83,18 +202,16 @@ void main()
 
   if (particle.lifetime > 0.0)
   {
-    velocity += acceleration * uniforms.dt;
+    velocity += acceleration * dt;
 
-    // test the particle against each wall
-    for (int i = 0; i < walls.list.length(); i++)
+    // test the particle against each wall in its tile
+    for (uint i = tile.offset; i < tile.offset + tile.count; i++)
     {
-      Box box = walls.list[i];
+      const WallBounds wall = GetWallBounds(substep, GetWallIndex(i));
       const vec2 ppos = particle.position;
-      const vec2 bpos = box.position;
-      const vec2 bscl = box.scale / 2;
       
-      if (ppos.x > bpos.x - bscl.x && ppos.y > bpos.y - bscl.y &&
-          ppos.x < bpos.x + bscl.x && ppos.y < bpos.y + bscl.y)
+      if (ppos.x > wall.boundsMin.x && ppos.y > wall.boundsMin.y &&
+          ppos.x < wall.boundsMax.x && ppos.y < wall.boundsMax.y)
       {
         particle.emissive.x = packHalf2x16(vec2(40.0, .4));
         particle.emissive.y = packHalf2x16(vec2(.4, .0));
@@ -104,7 +221,7 @@ void main()
         if (particle.lifetime > 1)
         {
           particle.lifetime = 1;
-          particle.position += velocity * uniforms.dt * 3.0;
+          particle.position += velocity * dt * 3.0;
           velocity = -velocity * 1.5;
           //if (index % 8 == 0) velocity *= -1;
         }
@@ -112,21 +229,43 @@ void main()
       }
     }
 
-    particle.position += velocity * uniforms.dt;
+    particle.position += velocity * dt;
     particle.velocity = packHalf2x16(velocity);
-    particle.lifetime -= uniforms.dt;
+    particle.lifetime -= dt;
+  }
+}
 
-    if (particle.lifetime <= 0.0)
-    {
-      // particle just died
-      tombstones.indices[atomicAdd(tombstones.size, 1)] = index;
-    }
-    else
-    {
-      // particle is alive, so we will render it (add its index to drawIndices)
-      renderIndices.indices[atomicAdd(renderIndices.size, 1)] = index;
-    }
+// Returns true if the particle is still alive after every substep.
+bool UpdateParticle(int index)
+{
+  // the particle stays in registers for all substeps, so it's only read and written once per frame
+  Particle particle = particles.list[index];
+  for (uint substep = 0; substep < uniforms.numSubsteps && particle.lifetime > 0.0; substep++)
+  {
+    Step(particle, substep, s_wallTiles[WallTileIndex(particle.position)]);
   }
 
   particles.list[index] = particle;
+  return particle.lifetime > 0.0;
+}
+
+layout(local_size_x = WORKGROUP_SIZE, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+  // only live particles are visited
+  const int liveIndex = int(gl_GlobalInvocationID.x);
+  int index = -1;
+  uint status = 0;
+
+  // every invocation must reach the barriers in LoadWalls and WriteIndex, so out-of-range ones can't return early
+  LoadWalls();
+
+  if (liveIndex < liveIn.size)
+  {
+    index = liveIn.indices[liveIndex];
+    status = UpdateParticle(index) ? STATUS_ALIVE : STATUS_DIED;
+  }
+
+  // particles that just died go back to the freelist, the rest are rendered and updated next tick
+  WriteIndex(index, status);
 }
\ No newline at end of file
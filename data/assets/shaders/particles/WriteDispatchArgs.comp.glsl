@@ -0,0 +1,26 @@
+#version 460 core
+
+// must match local_size_x of the shader being dispatched
+#define TARGET_WORKGROUP_SIZE 512
+
+layout(std430, binding = 0) readonly restrict buffer IndicesBuffer
+{
+  int size;
+  int indices[];
+}indices;
+
+// glDispatchComputeIndirect arguments
+layout(std430, binding = 1) writeonly restrict buffer DispatchArgsBuffer
+{
+  uint numGroupsX;
+  uint numGroupsY;
+  uint numGroupsZ;
+}args;
+
+layout(local_size_x = 1, local_size_y = 1, local_size_z = 1) in;
+void main()
+{
+  args.numGroupsX = (uint(max(indices.size, 0)) + TARGET_WORKGROUP_SIZE - 1) / TARGET_WORKGROUP_SIZE;
+  args.numGroupsY = 1;
+  args.numGroupsZ = 1;
+}
@@ -1,13 +1,20 @@
 #include "Application.h"
 #include "Renderer.h"
+#include "FramePacer.h"
+#include "JobSystem.h"
 #include "Input.h"
+#include "GAssert.h"
 #include "utils/EventBus.h"
 #include "utils/Timer.h"
 #include "ecs/Scene.h"
+#include "ecs/SystemScheduler.h"
 #include "ecs/systems/core/LifetimeSystem.h"
 #include "ecs/systems/game/ParticleSystem.h"
+#include "ecs/systems/game/WallSystem.h"
 #include "ecs/systems/RenderingSystem.h"
 #include "ecs/systems/DebugSystem.h"
+#include "cpu/ParticleSplatter.h"
+#include "cpu/PostProcess.h"
 #include <Fwog/Texture.h>
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
@@ -19,15 +26,20 @@
 #include <string>
 #include <queue>
 #include <functional>
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+#include <cstdio>
 
 #include "ecs/Entity.h"
 #include "ecs/components/core/Sprite.h"
 #include "ecs/components/core/Transform.h"
 #include "ecs/components/DebugDraw.h"
-#include "ecs/events/AddParticles.h"
+#include "ecs/events/EmitParticles.h"
 #include <glm/packing.hpp>
-#include <glm/integer.hpp>
 #include <stb_image.h>
+#include <stb_image_write.h>
 
 struct Milestone
 {
@@ -76,40 +88,17 @@ struct MilestoneTracker
   std::queue<Milestone> _milestones;
 };
 
-glm::vec2 Hammersley(uint32_t i, uint32_t N)
-{
-  return glm::vec2(
-    float(i) / float(N),
-    float(glm::bitfieldReverse(i)) * 2.3283064365386963e-10
-  );
-}
-
 void MakeParticles(EventBus* eventBus, uint32_t count, glm::vec2 position, float scaleColor, glm::vec4 baseColor = { 0.1f, 0.4f, 0.1f, 1.0f })
 {
-  std::vector<ecs::Particle> particles;
-  for (uint32_t i = 0; i < count; i++)
-  {
-    auto xi = Hammersley(i + 1, count);
-    float r = xi.x * 0.5f;
-    float theta = xi.y * 6.283f;
-    r *= .125;
-    r = sqrtf(r);
-
-    glm::vec2 pos = position + glm::vec2(r * cos(theta), r * sin(theta));
-    pos = glm::clamp(pos, glm::vec2(-1), glm::vec2(1));
-    glm::vec4 em = baseColor;
-    em = em * scaleColor;
-    ecs::Particle particle
+  eventBus->Enqueue(ecs::EmitParticles
     {
-      .position = pos,
-      .emissive = { glm::packHalf2x16({ em.r, em.g }), glm::packHalf2x16({ em.b, em.a }) },
-      .velocity = glm::packHalf2x16({ 0, 0 }),
-      .lifetime = 9999
-    };
-    particles.push_back(particle);
-  }
-
-  eventBus->Publish(ecs::AddParticles{ .particles = std::move(particles) });
+      .shape = ecs::EmitterShape::DISK,
+      .count = count,
+      .center = position,
+      .radius = 0.25f,
+      .color = baseColor * scaleColor,
+      .lifetime = 9999,
+    });
 }
 
 void MakeStaticWall(ecs::Scene* scene, glm::vec2 position, glm::vec2 scale)
@@ -144,6 +133,24 @@ void MakeMovingWall(ecs::Scene* scene, glm::vec2 posA, glm::vec2 posB, double pe
   move.posB = posB;
 }
 
+// how many particles the buffer needs to hold for a game started with startParticles
+uint32_t MaxParticlesFor(int startParticles)
+{
+  G_ASSERT(startParticles > 0 && startParticles <= HeadlessOptions::MAX_START_PARTICLES);
+  const auto maxParticles = uint64_t(startParticles) << 13;
+  G_ASSERT(maxParticles <= UINT32_MAX);
+  return static_cast<uint32_t>(maxParticles);
+}
+
+// Later milestones double the particles that are alive, but only if the count is valid: if it's known to be 0 nothing
+// is emitted, so the game over check after the milestone still gets a valid count. If the count is unknown, e.g. a
+// readback hasn't completed since the last spawn, the first milestone's burst is used instead of a stale count
+uint32_t MilestoneBurst(ecs::ParticleSystem* particleSystem, int startParticles)
+{
+  const auto stats = particleSystem->GetStats();
+  return stats.valid ? stats.numParticles : static_cast<uint32_t>(startParticles);
+}
+
 std::queue<Milestone> CreateDefaultMilestones(int startParticles, 
                                               EventBus* eventBus, 
                                               ecs::Scene* scene, 
@@ -167,7 +174,7 @@ std::queue<Milestone> CreateDefaultMilestones(int startParticles,
       .time = interval,
       .spawnMilestone = [=]
       {
-        MakeParticles(eventBus, particleSystem->GetNumParticles(), { particleSystem->cursorX, particleSystem->cursorY}, 75);
+        MakeParticles(eventBus, MilestoneBurst(particleSystem, startParticles), { particleSystem->cursorX, particleSystem->cursorY}, 75);
 
         MakeStaticWall(scene, { 0, -1 }, { 2.1, .03 });
       }
@@ -178,7 +185,7 @@ std::queue<Milestone> CreateDefaultMilestones(int startParticles,
       .time = interval,
       .spawnMilestone = [=]
       {
-        MakeParticles(eventBus, particleSystem->GetNumParticles(), { particleSystem->cursorX, particleSystem->cursorY}, 50);
+        MakeParticles(eventBus, MilestoneBurst(particleSystem, startParticles), { particleSystem->cursorX, particleSystem->cursorY}, 50);
 
         MakeStaticWall(scene, { 0, 1 }, { 2.1, .03 });
       }
@@ -189,7 +196,7 @@ std::queue<Milestone> CreateDefaultMilestones(int startParticles,
       .time = interval,
       .spawnMilestone = [=]
       {
-        MakeParticles(eventBus, particleSystem->GetNumParticles(), { particleSystem->cursorX, particleSystem->cursorY}, 25, { .4, .2, .1, 0 });
+        MakeParticles(eventBus, MilestoneBurst(particleSystem, startParticles), { particleSystem->cursorX, particleSystem->cursorY}, 25, { .4, .2, .1, 0 });
 
         MakeMovingWall(scene, { -1.5, 0 }, { 1.5, 0 }, 10, { .25, .25 });
       }
@@ -200,7 +207,7 @@ std::queue<Milestone> CreateDefaultMilestones(int startParticles,
       .time = interval,
       .spawnMilestone = [=]
       {
-        MakeParticles(eventBus, particleSystem->GetNumParticles(), { particleSystem->cursorX, particleSystem->cursorY}, 12, { .4, .2, .1, 0 });
+        MakeParticles(eventBus, MilestoneBurst(particleSystem, startParticles), { particleSystem->cursorX, particleSystem->cursorY}, 12, { .4, .2, .1, 0 });
 
         MakeMovingWall(scene, { 0, -1.5 }, { 0, 1.5 }, 10, { .25, .25 });
       }
@@ -211,7 +218,7 @@ std::queue<Milestone> CreateDefaultMilestones(int startParticles,
       .time = interval,
       .spawnMilestone = [=]
       {
-        MakeParticles(eventBus, particleSystem->GetNumParticles(), { particleSystem->cursorX, particleSystem->cursorY}, 10, { .4, .2, .1, 0 });
+        MakeParticles(eventBus, MilestoneBurst(particleSystem, startParticles), { particleSystem->cursorX, particleSystem->cursorY}, 10, { .4, .2, .1, 0 });
 
         MakeStaticWall(scene, { -1, 0 }, { .03, 2.1 });
         MakeStaticWall(scene, { 1, 0 }, { .03, 2.1});
@@ -223,7 +230,7 @@ std::queue<Milestone> CreateDefaultMilestones(int startParticles,
       .time = interval,
       .spawnMilestone = [=]
       {
-        MakeParticles(eventBus, particleSystem->GetNumParticles(), { particleSystem->cursorX, particleSystem->cursorY}, 10, { .1, .2, .4, 0 });
+        MakeParticles(eventBus, MilestoneBurst(particleSystem, startParticles), { particleSystem->cursorX, particleSystem->cursorY}, 10, { .1, .2, .4, 0 });
 
         MakeMovingWall(scene, { -.75, 0 }, { -1.11, 0 }, 10, { .4, 2.1 });
         MakeMovingWall(scene, { 1.11, 0 }, { .75, 0 }, 10, { .4, 2.1 });
@@ -235,7 +242,7 @@ std::queue<Milestone> CreateDefaultMilestones(int startParticles,
       .time = interval,
       .spawnMilestone = [=]
       {
-        MakeParticles(eventBus, particleSystem->GetNumParticles(), { particleSystem->cursorX, particleSystem->cursorY}, 10, { .1, .2, .4, 0 });
+        MakeParticles(eventBus, MilestoneBurst(particleSystem, startParticles), { particleSystem->cursorX, particleSystem->cursorY}, 10, { .1, .2, .4, 0 });
 
         MakeMovingWall(scene, { 0, -.75 }, { 0, -1.11 }, 10, { 2.1, .4 });
         MakeMovingWall(scene, { 0, 1.11 }, { 0, .75 }, 10, { 2.1, .4 });
@@ -247,7 +254,7 @@ std::queue<Milestone> CreateDefaultMilestones(int startParticles,
       .time = interval,
       .spawnMilestone = [=]
       {
-        MakeParticles(eventBus, particleSystem->GetNumParticles(), { particleSystem->cursorX, particleSystem->cursorY}, 10, { .1, .2, .4, 0 });
+        MakeParticles(eventBus, MilestoneBurst(particleSystem, startParticles), { particleSystem->cursorX, particleSystem->cursorY}, 10, { .1, .2, .4, 0 });
 
         MakeMovingWall(scene, { -.25, -.25 }, { .25, -.25 }, 8, { .125, .125 });
         MakeMovingWall(scene, { -.25, -.25 }, { -.25, .25 }, 8, { .125, .125 });
@@ -261,7 +268,7 @@ std::queue<Milestone> CreateDefaultMilestones(int startParticles,
       .time = interval,
       .spawnMilestone = [=]
       {
-        MakeParticles(eventBus, particleSystem->GetNumParticles(), { particleSystem->cursorX, particleSystem->cursorY}, 10, { .5, .1, .5, 0 });
+        MakeParticles(eventBus, MilestoneBurst(particleSystem, startParticles), { particleSystem->cursorX, particleSystem->cursorY}, 10, { .5, .1, .5, 0 });
 
         MakeStaticWall(scene, { 0, 0 }, { .125, .125 });
       }
@@ -272,7 +279,7 @@ std::queue<Milestone> CreateDefaultMilestones(int startParticles,
       .time = interval,
       .spawnMilestone = [=]
       {
-        MakeParticles(eventBus, particleSystem->GetNumParticles(), { particleSystem->cursorX, particleSystem->cursorY}, 5, { .5, .1, .5, 0 });
+        MakeParticles(eventBus, MilestoneBurst(particleSystem, startParticles), { particleSystem->cursorX, particleSystem->cursorY}, 5, { .5, .1, .5, 0 });
 
         MakeMovingWall(scene, { 0, -2 }, { 0, 2 }, 10, { .125, 1 });
       }
@@ -283,7 +290,7 @@ std::queue<Milestone> CreateDefaultMilestones(int startParticles,
       .time = interval,
       .spawnMilestone = [=]
       {
-        MakeParticles(eventBus, particleSystem->GetNumParticles(), { particleSystem->cursorX, particleSystem->cursorY}, 5, { .5, .1, .5, 0 });
+        MakeParticles(eventBus, MilestoneBurst(particleSystem, startParticles), { particleSystem->cursorX, particleSystem->cursorY}, 5, { .5, .1, .5, 0 });
 
         MakeMovingWall(scene, { -1, 0 }, { 2, 0 }, 10, { 1, .125 });
       }
@@ -294,7 +301,7 @@ std::queue<Milestone> CreateDefaultMilestones(int startParticles,
       .time = interval,
       .spawnMilestone = [=]
       {
-        MakeParticles(eventBus, particleSystem->GetNumParticles(), { particleSystem->cursorX, particleSystem->cursorY}, 5, { .2, .2, .2, 0 });
+        MakeParticles(eventBus, MilestoneBurst(particleSystem, startParticles), { particleSystem->cursorX, particleSystem->cursorY}, 5, { .2, .2, .2, 0 });
         scene->Registry().clear();
       } });
 
@@ -310,11 +317,16 @@ std::queue<Milestone> CreateDefaultMilestones(int startParticles,
   return milestones;
 }
 
-Application::Application(std::string title, ecs::Scene* scene, EventBus* eventBus)
+Application::Application(std::string title, ecs::Scene* scene, EventBus* eventBus, bool headless)
   : _title(std::move(title)),
     _scene(scene),
     _eventBus(eventBus)
 {
+  if (headless)
+  {
+    return;
+  }
+
   // init everything
   if (!glfwInit())
   {
@@ -354,7 +366,6 @@ Application::Application(std::string title, ecs::Scene* scene, EventBus* eventBu
   }
 
   glfwMakeContextCurrent(_window);
-  glfwSwapInterval(1);
 
   _input = new input::InputManager(_window, _eventBus);
 }
@@ -362,15 +373,143 @@ Application::Application(std::string title, ecs::Scene* scene, EventBus* eventBu
 Application::~Application()
 {
   delete _input;
-  glfwTerminate();
+  if (_window)
+  {
+    glfwTerminate();
+  }
+}
+
+void Application::RunHeadless(const HeadlessOptions& options)
+{
+  G_ASSERT(options.simulationHz > 0);
+  _simulationTick = 1.0 / options.simulationHz;
+
+  auto jobs = JobSystem();
+  auto particleSystem = ecs::ParticleSystem(_scene, _eventBus, nullptr, &jobs, ecs::ParticleBackend::CPU);
+  particleSystem.Reset(true, MaxParticlesFor(options.startParticles));
+
+  auto milestoneTracker = MilestoneTracker();
+  milestoneTracker.Reset(CreateDefaultMilestones(options.startParticles, _eventBus, _scene, &particleSystem));
+
+  auto wallSystem = ecs::WallSystem(_scene, _eventBus);
+  auto lifetimeSystem = ecs::LifetimeSystem(_scene, _eventBus);
+  auto scheduler = ecs::SystemScheduler(jobs);
+  scheduler.Add("Particles", particleSystem);
+  scheduler.Add("Walls", wallSystem);
+  scheduler.Add("Lifetimes", lifetimeSystem);
+
+  const bool render = options.renderWidth > 0 && options.renderHeight > 0;
+  auto splatter = cpu::ParticleSplatter(&jobs);
+  auto post = cpu::PostProcess();
+  std::vector<glm::vec4> hdrImage(size_t(options.renderWidth) * options.renderHeight);
+  std::vector<uint32_t> ldrImage(hdrImage.size());
+  std::vector<double> splatTimes;
+  std::vector<double> postTimes;
+  uint64_t particlesSplatted = 0;
+
+  std::vector<double> tickTimes;
+  tickTimes.reserve(options.ticks);
+  uint64_t particleUpdates = 0;
+  double gameTime = 0;
+
+  Timer totalTimer;
+  for (uint64_t tick = 0; tick < options.ticks; tick++)
+  {
+    // there is no mouse, so sweep the cursor around so the flock moves and hits walls
+    particleSystem.cursorX = static_cast<float>(0.5 * std::cos(gameTime * 0.5));
+    particleSystem.cursorY = static_cast<float>(0.5 * std::sin(gameTime * 0.5));
+
+    Timer tickTimer;
+    milestoneTracker.Update(_simulationTick);
+    _eventBus->Flush();
+    scheduler.Run(_simulationTick);
+    tickTimes.push_back(tickTimer.Elapsed_ms());
+
+    if (render)
+    {
+      const auto particles = particleSystem.GatherRenderable();
+      Timer splatTimer;
+      splatter.Splat(particles, options.renderWidth, options.renderHeight);
+      splatTimes.push_back(splatTimer.Elapsed_ms());
+      particlesSplatted += particles.size();
+
+      // same bloom as Renderer::DrawParticles
+      Timer postTimer;
+      splatter.Resolve(hdrImage);
+      post.ApplyBloom(hdrImage, options.renderWidth, options.renderHeight, 6, 1.0f / 64.0f, 1.0f);
+      post.Tonemap(hdrImage, options.renderWidth, options.renderHeight, ldrImage);
+      postTimes.push_back(postTimer.Elapsed_ms());
+    }
+
+    particleUpdates += particleSystem.GetStats().numParticles;
+    gameTime += _simulationTick;
+  }
+  const double total_s = totalTimer.Elapsed_s();
+
+  if (tickTimes.empty())
+  {
+    return;
+  }
+
+  std::sort(tickTimes.begin(), tickTimes.end());
+  auto percentile = [&tickTimes](double p)
+  {
+    return tickTimes[std::min(tickTimes.size() - 1, static_cast<size_t>(p * tickTimes.size()))];
+  };
+  const double mean_ms = std::accumulate(tickTimes.begin(), tickTimes.end(), 0.0) / tickTimes.size();
+
+  printf("Simulated %llu ticks at %d Hz (%.1f s of game time) in %.3f s\n",
+    static_cast<unsigned long long>(options.ticks), options.simulationHz, gameTime, total_s);
+  printf("Ticks per second: %.1f\n", options.ticks / total_s);
+  printf("Tick time (ms): min %.3f, mean %.3f, p50 %.3f, p99 %.3f, max %.3f\n",
+    tickTimes.front(), mean_ms, percentile(0.5), percentile(0.99), tickTimes.back());
+  printf("Particle updates per second: %.3g\n", particleUpdates / total_s);
+  printf("Particles alive at exit: %u / %u\n", particleSystem.GetStats().numParticles, particleSystem.MAX_PARTICLES);
+
+  if (render)
+  {
+    const double splat_s = std::accumulate(splatTimes.begin(), splatTimes.end(), 0.0) / 1000.0;
+    std::sort(splatTimes.begin(), splatTimes.end());
+    printf("Splat time at %ux%u (ms): min %.3f, mean %.3f, max %.3f\n",
+      options.renderWidth, options.renderHeight, splatTimes.front(), splat_s * 1000.0 / splatTimes.size(), splatTimes.back());
+    printf("Particles splatted per second: %.3g\n", particlesSplatted / splat_s);
+
+    std::sort(postTimes.begin(), postTimes.end());
+    printf("Resolve, bloom and tonemap time (ms): min %.3f, mean %.3f, max %.3f\n",
+      postTimes.front(), std::accumulate(postTimes.begin(), postTimes.end(), 0.0) / postTimes.size(), postTimes.back());
+
+    if (!options.screenshotPath.empty())
+    {
+      // rows start at the bottom, like GL images
+      stbi_flip_vertically_on_write(1);
+      if (stbi_write_png(options.screenshotPath.c_str(), options.renderWidth, options.renderHeight, 4, ldrImage.data(), options.renderWidth * 4) == 0)
+      {
+        printf("Failed to write %s\n", options.screenshotPath.c_str());
+      }
+    }
+  }
 }
 
 void Application::Run()
 {
+  G_ASSERT_MSG(_window, "Headless applications must use RunHeadless");
+
   auto renderer = Renderer(_window);
+  auto framePacer = FramePacer();
   auto renderingSystem = ecs::RenderingSystem(_scene, _eventBus, _window, &renderer);
   auto debugSystem = ecs::DebugSystem(_scene, _eventBus, _window, &renderer);
-  auto particleSystem = ecs::ParticleSystem(_scene, _eventBus, &renderer);
+  auto jobs = JobSystem();
+  auto particleSystem = ecs::ParticleSystem(_scene, _eventBus, &renderer, &jobs);
+
+  // the particles are flushed once per frame rather than every tick, so only their substep is scheduled
+  auto wallSystem = ecs::WallSystem(_scene, _eventBus);
+  auto lifetimeSystem = ecs::LifetimeSystem(_scene, _eventBus);
+  auto scheduler = ecs::SystemScheduler(jobs);
+  ecs::SystemAccess particleAccess;
+  particleSystem.DeclareAccess(particleAccess);
+  scheduler.Add("Particles", particleAccess, [&particleSystem](double dt) { particleSystem.Substep(dt); });
+  scheduler.Add("Walls", wallSystem);
+  scheduler.Add("Lifetimes", lifetimeSystem);
 
   enum class GameState
   {
@@ -388,6 +527,7 @@ void Application::Run()
   double gameTime = 0;
   bool sandboxMode = false;
   bool screenshotMode = false;
+  bool showProfiler = false;
   GameState gameState = GameState::MENU;
   int startParticles = 1000;
   auto milestoneTracker = MilestoneTracker();
@@ -395,9 +535,11 @@ void Application::Run()
 
   struct Pause {};
   struct ScreenshotMode {};
+  struct ToggleProfiler {};
   struct Speedup : ecs::AxisBindingBase {};
   _input->AddActionBinding<Pause>(input::ActionInput{ .type{ input::Button::KEY_ESCAPE} });
   _input->AddActionBinding<ScreenshotMode>(input::ActionInput{ .type{ input::Button::KEY_F1} });
+  _input->AddActionBinding<ToggleProfiler>(input::ActionInput{ .type{ input::Button::KEY_F2} });
   _input->AddAxisBinding<Speedup>(input::AxisInput{ .type{ input::Button::KEY_SPACE } });
 
   struct Handler
@@ -418,14 +560,21 @@ void Application::Run()
       screenshotMode = !screenshotMode;
     }
 
+    void ToggleProfilerHandler(ToggleProfiler&)
+    {
+      showProfiler = !showProfiler;
+    }
+
     GameState& gameState;
     bool& screenshotMode;
+    bool& showProfiler;
   };
 
-  Handler handler{gameState, screenshotMode};
+  Handler handler{gameState, screenshotMode, showProfiler};
 
   _eventBus->Subscribe(&handler, &Handler::PauseHandler);
   _eventBus->Subscribe(&handler, &Handler::ScreenshotModeHandler);
+  _eventBus->Subscribe(&handler, &Handler::ToggleProfilerHandler);
 
   auto speedupHandler = [&gameSpeed](Speedup&) mutable -> void
   {
@@ -439,8 +588,10 @@ void Application::Run()
   //double inputAccum = 0;
   while (!glfwWindowShouldClose(_window))
   {
+    framePacer.BeginFrame();
     double dt = timer.Elapsed_s();
     timer.Reset();
+    renderer.BeginFrame();
 
     gameSpeed = 1;
 
@@ -476,7 +627,7 @@ void Application::Run()
       {
         gameState = GameState::RUNNING;
         sandboxMode = false;
-        particleSystem.Reset(true, startParticles << 13);
+        particleSystem.Reset(true, MaxParticlesFor(startParticles));
         milestoneTracker.Reset(CreateDefaultMilestones(startParticles, _eventBus, _scene, &particleSystem));
       }
 
@@ -484,7 +635,7 @@ void Application::Run()
       {
         gameState = GameState::RUNNING;
         sandboxMode = true;
-        particleSystem.Reset(true, startParticles << 13);
+        particleSystem.Reset(true, MaxParticlesFor(startParticles));
         milestoneTracker.Reset(CreateDefaultMilestones(startParticles, _eventBus, _scene, &particleSystem));
       }
 
@@ -496,11 +647,49 @@ void Application::Run()
       if (ImGui::TreeNode("Options"))
       {
         ImGui::PushItemWidth(100);
-        ImGui::SliderInt("Initial Particles", &startParticles, 100, 4000);
+        ImGui::SliderInt("Initial Particles", &startParticles, 100, HeadlessOptions::MAX_START_PARTICLES);
         int simHz = static_cast<int>(1.0 / _simulationTick);
         ImGui::SliderInt("Simulation Hz", &simHz, 15, 240);
         _simulationTick = 1.0 / simHz;
         ImGui::Checkbox("Enable bloom", &Renderer::enableBloom);
+        ImGui::Checkbox("Fused present", &Renderer::enableFusedPresent);
+        const char* splatModeNames[] = { "Separate", "Packed 64-bit", "Tiled" };
+        if (ImGui::BeginCombo("Particle splat", splatModeNames[static_cast<int>(Renderer::particleSplatMode)]))
+        {
+          for (int i = 0; i < IM_ARRAYSIZE(splatModeNames); i++)
+          {
+            const auto mode = static_cast<ParticleSplatMode>(i);
+            if (renderer.SupportsParticleSplatMode(mode) && ImGui::Selectable(splatModeNames[i], mode == Renderer::particleSplatMode))
+            {
+              Renderer::particleSplatMode = mode;
+            }
+          }
+          ImGui::EndCombo();
+        }
+        ImGui::Checkbox("Dynamic resolution", &Renderer::enableDynamicResolution);
+        ImGui::SliderFloat("GPU budget (ms)", &Renderer::gpuFrameBudgetMs, 4.0f, 33.3f, "%.1f");
+        ImGui::Text("Render scale: %.0f%%", renderer.RenderScale() * 100.0f);
+
+        auto pacing = framePacer.GetSettings();
+        const char* pacingModeNames[] = { "Vsync", "Uncapped", "Target FPS" };
+        int pacingMode = static_cast<int>(pacing.mode);
+        ImGui::Combo("Frame pacing", &pacingMode, pacingModeNames, IM_ARRAYSIZE(pacingModeNames));
+        pacing.mode = static_cast<FramePacer::Mode>(pacingMode);
+        if (pacing.mode == FramePacer::Mode::TARGET_FPS)
+        {
+          float targetFps = static_cast<float>(pacing.targetFps);
+          ImGui::SliderFloat("Target FPS", &targetFps, 30.0f, 360.0f, "%.0f");
+          pacing.targetFps = targetFps;
+        }
+        int framesInFlight = static_cast<int>(pacing.maxFramesInFlight);
+        ImGui::SliderInt("Frames in flight", &framesInFlight, 1, 3);
+        pacing.maxFramesInFlight = static_cast<uint32_t>(framesInFlight);
+        ImGui::Checkbox("Low latency", &pacing.lowLatency);
+        if (pacing != framePacer.GetSettings())
+        {
+          framePacer.SetSettings(pacing);
+        }
+        ImGui::Text("Input latency: %.1fms", framePacer.GetStats().latencyMs);
 
         ImGui::TreePop();
       }
@@ -510,6 +699,7 @@ void Application::Run()
         ImGui::Text("Cursor: control flock");
         ImGui::Text("Escape: pauses game");
         ImGui::Text("Space: 4x game speed");
+        ImGui::Text("F2: GPU and system profilers");
 
         ImGui::TreePop();
       }
@@ -530,10 +720,18 @@ void Application::Run()
       simulationAccum += dt;
       while (simulationAccum > _simulationTick)
       {
-        // only check particle count each milestone to avoid lag spam
-        if (milestoneTracker.Update(_simulationTick))
+        const bool milestoneReached = milestoneTracker.Update(_simulationTick);
+
+        // spawns from this tick's milestone
+        _eventBus->Flush();
+
+        // only check particle count each milestone
+        if (milestoneReached)
         {
-          if (particleSystem.GetNumParticles() == 0)
+          // the count may be a few frames old, but it's only valid if nothing was spawned since. That holds after a
+          // milestone because MilestoneBurst emits nothing when it sees a valid count of 0
+          auto stats = particleSystem.GetStats();
+          if (stats.valid && stats.numParticles == 0)
           {
             gameState = GameState::END;
           }
@@ -545,11 +743,14 @@ void Application::Run()
         }
 
         gameTime += _simulationTick;
-        particleSystem.Update(_simulationTick);
+        scheduler.Run(_simulationTick);
 
         simulationAccum -= _simulationTick;
         //simulationAccum = 0;
       }
+
+      // all of this frame's ticks are simulated in one pass over the particles
+      particleSystem.Flush();
       break;
     }
     case GameState::PAUSED:
@@ -567,7 +768,7 @@ void Application::Run()
       {
         gameState = GameState::MENU;
         _scene->Registry().clear();
-        particleSystem.Reset(false, startParticles << 13);
+        particleSystem.Reset(false, MaxParticlesFor(startParticles));
       }
 
       ImGui::End();
@@ -579,7 +780,7 @@ void Application::Run()
       ImGui::SetNextWindowSize(ImVec2(300, 200));
       ImGui::Begin("end", nullptr, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoDecoration);
 
-      auto survived = particleSystem.GetNumParticles();
+      auto survived = particleSystem.GetStats().numParticles;
       if (survived == 0)
       {
         ImGui::Text("Your flock has died.");
@@ -620,7 +821,7 @@ void Application::Run()
       ImGui::SetNextWindowSize(ImVec2(400, 170));
       ImGui::Begin("sandbox", nullptr, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoDecoration);
 
-      ImGui::Text("Framerate: %.0fHz", 1.0 / dt);
+      ImGui::Text("Framerate: %.0fHz, input latency: %.1fms", 1.0 / dt, framePacer.GetStats().latencyMs);
       ImGui::SliderFloat("Magnetism", &particleSystem.magnetism, 0, 5.0f);
       ImGui::SliderFloat("Friction", &particleSystem.friction, 0, 1.0f);
       ImGui::SliderFloat("Accel. constant", &particleSystem.accelerationConstant, 0, 5);
@@ -632,13 +833,13 @@ void Application::Run()
 
       if (ImGui::Button("Double Particles"))
       {
-        MakeParticles(_eventBus, particleSystem.GetNumParticles(), { particleSystem.cursorX, particleSystem.cursorY }, 10, { .4, .2, .1, 0 });
+        MakeParticles(_eventBus, particleSystem.GetStats().numParticles, { particleSystem.cursorX, particleSystem.cursorY }, 10, { .4, .2, .1, 0 });
       }
       ImGui::SameLine();
       if (ImGui::Button("Reset"))
       {
         _scene->Registry().clear();
-        particleSystem.Reset(false, startParticles << 13);
+        particleSystem.Reset(false, MaxParticlesFor(startParticles));
         milestoneTracker.Reset(CreateDefaultMilestones(startParticles, _eventBus, _scene, &particleSystem));
       }
       ImGui::SameLine();
@@ -653,18 +854,29 @@ void Application::Run()
       ImGui::End();
     }
     
+    // anything the UI queued this frame, so it isn't held while paused or carried into a reset game
+    _eventBus->Flush();
+
     renderingSystem.Update(dt);
     particleSystem.Draw();
+    renderer.SubmitFrame();
 
     glDisable(GL_FRAMEBUFFER_SRGB);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     if (!screenshotMode)
     {
+      if (showProfiler)
+      {
+        renderer.Profiler().DrawImGui(&showProfiler);
+        scheduler.DrawImGui(&showProfiler);
+      }
       ImGui::Render();
       ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
     }
     ImGui::EndFrame();
 
+    renderer.EndFrame();
     glfwSwapBuffers(_window);
+    framePacer.EndFrame();
   }
 }
\ No newline at end of file
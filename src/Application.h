@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <cstdint>
 
 class EventBus;
 struct GLFWwindow;
@@ -14,10 +15,28 @@ namespace input
   class InputManager;
 }
 
+struct HeadlessOptions
+{
+  // the "Initial Particles" slider's limit. The particle buffer holds startParticles << 13 particles
+  static constexpr int MAX_START_PARTICLES = 4000;
+
+  uint64_t ticks = 3600;
+  int startParticles = 1000;
+  int simulationHz = 60;
+
+  // if not zero, particles are splatted into an image of this size on the CPU after every tick
+  uint32_t renderWidth = 0;
+  uint32_t renderHeight = 0;
+
+  // if not empty, the last rendered frame is written to this PNG
+  std::string screenshotPath;
+};
+
 class Application
 {
 public:
-  Application(std::string title, ecs::Scene* scene, EventBus* eventBus);
+  // A headless application does not create a window or GL context, and can only use RunHeadless.
+  Application(std::string title, ecs::Scene* scene, EventBus* eventBus, bool headless = false);
   ~Application();
 
   Application(const Application&) = delete;
@@ -27,12 +46,16 @@ public:
 
   void Run();
 
+  // Plays the default game for a fixed number of simulation ticks on the CPU particle backend,
+  // as fast as possible, then prints timing stats.
+  void RunHeadless(const HeadlessOptions& options);
+
 private:
 
   std::string _title;
   ecs::Scene* _scene;
   EventBus* _eventBus;
-  GLFWwindow* _window;
-  input::InputManager* _input;
+  GLFWwindow* _window = nullptr;
+  input::InputManager* _input = nullptr;
   double _simulationTick = 1.0 / 60.0;
 };
\ No newline at end of file
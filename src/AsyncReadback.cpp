@@ -0,0 +1,107 @@
+#include "AsyncReadback.h"
+#include "GAssert.h"
+#include <Fwog/Buffer.h>
+#include <glad/gl.h>
+#include <cstring>
+
+namespace
+{
+  bool IsSignaled(void* fence)
+  {
+    const GLenum status = glClientWaitSync(static_cast<GLsync>(fence), 0, 0);
+    return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+  }
+}
+
+AsyncReadback::AsyncReadback(size_t size, uint32_t numSlots)
+  : _size(size),
+    _slots(numSlots),
+    _latest(size)
+{
+  G_ASSERT(size > 0 && numSlots > 0);
+
+  constexpr GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  glCreateBuffers(1, &_buffer);
+  glNamedBufferStorage(_buffer, static_cast<GLsizeiptr>(size * numSlots), nullptr, flags);
+  _mapped = static_cast<const std::byte*>(glMapNamedBufferRange(_buffer, 0, static_cast<GLsizeiptr>(size * numSlots), flags));
+  G_ASSERT(_mapped);
+}
+
+AsyncReadback::~AsyncReadback()
+{
+  Discard();
+  glUnmapNamedBuffer(_buffer);
+  glDeleteBuffers(1, &_buffer);
+}
+
+bool AsyncReadback::Record(const Fwog::Buffer& source, size_t sourceOffset, uint64_t tag)
+{
+  // the ring is full, so the oldest copy must land before its slot can be reused
+  if (_numPending == _slots.size())
+  {
+    Poll();
+    if (_numPending == _slots.size())
+    {
+      return false;
+    }
+  }
+
+  auto& slot = _slots[_head];
+  slot.tag = tag;
+
+  // make shader writes to the source visible to the copy
+  glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+  glCopyNamedBufferSubData(source.Handle(), _buffer, static_cast<GLintptr>(sourceOffset), static_cast<GLintptr>(_head * _size), static_cast<GLsizeiptr>(_size));
+  slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+  _head = (_head + 1) % _slots.size();
+  _numPending++;
+  return true;
+}
+
+std::optional<AsyncReadback::Result> AsyncReadback::Poll()
+{
+  // fences signal in order, so retire from the oldest pending slot until one isn't done
+  const auto numSlots = static_cast<uint32_t>(_slots.size());
+  while (_numPending > 0)
+  {
+    const uint32_t oldest = (_head + numSlots - _numPending) % numSlots;
+    auto& slot = _slots[oldest];
+    if (!IsSignaled(slot.fence))
+    {
+      break;
+    }
+
+    // copy out so the slot can be reused while the result is still held
+    std::memcpy(_latest.data(), _mapped + oldest * _size, _size);
+    _latestTag = slot.tag;
+    _hasLatest = true;
+
+    glDeleteSync(static_cast<GLsync>(slot.fence));
+    slot.fence = nullptr;
+    _numPending--;
+  }
+
+  if (!_hasLatest)
+  {
+    return std::nullopt;
+  }
+
+  return Result{ .data = _latest.data(), .tag = _latestTag };
+}
+
+void AsyncReadback::Discard()
+{
+  for (auto& slot : _slots)
+  {
+    if (slot.fence)
+    {
+      glDeleteSync(static_cast<GLsync>(slot.fence));
+      slot.fence = nullptr;
+    }
+  }
+
+  _head = 0;
+  _numPending = 0;
+  _hasLatest = false;
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace Fwog
+{
+  class Buffer;
+}
+
+// Reads small amounts of GPU buffer data back to the CPU without ever waiting on the GPU.
+// Each Record() copies into the next slot of a persistently mapped ring and puts a fence after it.
+// Results become available a few frames later, once their fence has signaled.
+class AsyncReadback
+{
+public:
+  struct Result
+  {
+    const std::byte* data; // size bytes, valid until the next call to Poll or Discard
+    uint64_t tag;          // whatever was passed to Record, e.g. a frame index
+  };
+
+  AsyncReadback(size_t size, uint32_t numSlots = 3);
+  ~AsyncReadback();
+
+  AsyncReadback(const AsyncReadback&) = delete;
+  AsyncReadback(AsyncReadback&&) = delete;
+  AsyncReadback& operator=(const AsyncReadback&) = delete;
+  AsyncReadback& operator=(AsyncReadback&&) = delete;
+
+  // Copies size bytes starting at sourceOffset.
+  // Returns false and does nothing if every slot is still in flight.
+  bool Record(const Fwog::Buffer& source, size_t sourceOffset, uint64_t tag);
+
+  // Returns the newest completed result, which may be one that was already returned.
+  // Returns nothing if no result has completed since construction or the last Discard.
+  std::optional<Result> Poll();
+
+  // Forgets every result, including ones in flight.
+  void Discard();
+
+private:
+  struct Slot
+  {
+    void* fence = nullptr; // GLsync
+    uint64_t tag = 0;
+  };
+
+  size_t _size;
+  uint32_t _buffer = 0;
+  const std::byte* _mapped = nullptr;
+  std::vector<Slot> _slots;
+  uint32_t _head = 0;      // next slot to record into
+  uint32_t _numPending = 0;
+
+  std::vector<std::byte> _latest;
+  uint64_t _latestTag = 0;
+  bool _hasLatest = false;
+};
\ No newline at end of file
@@ -0,0 +1,74 @@
+#include "DynamicResolution.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+  // the scale moves in steps of this, so noise doesn't change the render size (and its uniforms) every frame
+  constexpr float SCALE_STEP = 1.0f / 32.0f;
+
+  // weight of the newest frame time. Reacts to milestone spikes within a few frames without chasing noise
+  constexpr double FILTER_WEIGHT = 0.25;
+
+  // only scale up with this much headroom, since the cost grows with the square of the scale
+  constexpr double HEADROOM = 0.8;
+
+  constexpr float MAX_STEP_DOWN = 0.125f;
+}
+
+DynamicResolution::DynamicResolution()
+  : DynamicResolution(Settings{})
+{
+}
+
+DynamicResolution::DynamicResolution(const Settings& settings)
+  : _settings(settings),
+    _scale(settings.maxScale)
+{
+}
+
+float DynamicResolution::Update(double gpuFrameMs, double budgetMs)
+{
+  _framesSinceChange++;
+  if (gpuFrameMs <= 0 || budgetMs <= 0)
+  {
+    return _scale;
+  }
+
+  _filteredMs = _filteredMs == 0 ? gpuFrameMs : std::lerp(_filteredMs, gpuFrameMs, FILTER_WEIGHT);
+
+  // measurements from before the last change haven't arrived yet
+  if (_framesSinceChange < _settings.settleFrames)
+  {
+    return _scale;
+  }
+
+  float target = _scale;
+  if (_filteredMs > budgetMs)
+  {
+    // pixel work scales with area, so shrink each axis by the square root of how far over budget the frame is
+    target = _scale * static_cast<float>(std::sqrt(budgetMs / _filteredMs));
+    target = std::max(target, _scale - MAX_STEP_DOWN);
+    target = std::floor(target / SCALE_STEP) * SCALE_STEP;
+  }
+  else if (_filteredMs < budgetMs * HEADROOM)
+  {
+    target = _scale + SCALE_STEP;
+  }
+
+  target = std::clamp(target, _settings.minScale, _settings.maxScale);
+  if (target != _scale)
+  {
+    _scale = target;
+    _framesSinceChange = 0;
+  }
+
+  return _scale;
+}
+
+void DynamicResolution::Reset()
+{
+  _scale = _settings.maxScale;
+  _filteredMs = 0;
+  _framesSinceChange = 0;
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+
+// Picks the fraction of the window's resolution to render at so the measured GPU frame time stays under a budget.
+// Frame times arrive a few frames late, so the scale drops quickly when over budget, but only climbs back slowly
+// and after the last change has had time to show up in the measurements.
+class DynamicResolution
+{
+public:
+  struct Settings
+  {
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    uint32_t settleFrames = 6; // frames to wait after a change before measuring its effect
+  };
+
+  DynamicResolution();
+  explicit DynamicResolution(const Settings& settings);
+
+  // Call once per frame with the last measured GPU frame time, or 0 if there is none yet. Returns the new scale.
+  float Update(double gpuFrameMs, double budgetMs);
+
+  // Jumps back to the highest scale
+  void Reset();
+
+  [[nodiscard]] float Scale() const { return _scale; }
+  [[nodiscard]] double FilteredFrameMs() const { return _filteredMs; }
+
+private:
+  Settings _settings;
+  float _scale;
+  double _filteredMs = 0;
+  uint32_t _framesSinceChange = 0;
+};
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "FramePacer.h"
+#include "GAssert.h"
+#include <glad/gl.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace
+{
+  // sleeps can overshoot by about a scheduler tick, so the end of a wait is spun instead
+  constexpr double SPIN_SECONDS = 0.002;
+
+  constexpr double FILTER_WEIGHT = 0.1;
+
+  void Filter(double& filtered, double value)
+  {
+    filtered = filtered == 0 ? value : std::lerp(filtered, value, FILTER_WEIGHT);
+  }
+}
+
+FramePacer::FramePacer()
+  : FramePacer(Settings{})
+{
+}
+
+FramePacer::FramePacer(const Settings& settings)
+  : _settings(settings)
+{
+  glfwSwapInterval(settings.mode == Mode::VSYNC ? 1 : 0);
+}
+
+FramePacer::~FramePacer()
+{
+  for (const auto& frame : _inFlight)
+  {
+    glDeleteSync(static_cast<GLsync>(frame.fence));
+  }
+}
+
+void FramePacer::SetSettings(const Settings& settings)
+{
+  G_ASSERT(settings.maxFramesInFlight >= 1 && settings.maxFramesInFlight <= 3);
+  G_ASSERT(settings.mode != Mode::TARGET_FPS || settings.targetFps > 0);
+
+  if ((settings.mode == Mode::VSYNC) != (_settings.mode == Mode::VSYNC))
+  {
+    glfwSwapInterval(settings.mode == Mode::VSYNC ? 1 : 0);
+  }
+
+  _settings = settings;
+  _nextFrameTime = 0;
+}
+
+void FramePacer::SleepUntil(double time) const
+{
+  const double remaining = time - Now();
+  if (remaining > SPIN_SECONDS)
+  {
+    std::this_thread::sleep_for(std::chrono::duration<double>(remaining - SPIN_SECONDS));
+  }
+
+  while (Now() < time)
+  {
+  }
+}
+
+void FramePacer::RetireFrames(uint32_t maxFrames)
+{
+  while (!_inFlight.empty())
+  {
+    const auto sync = static_cast<GLsync>(_inFlight.front().fence);
+    const bool mustWait = _inFlight.size() > maxFrames;
+    const GLenum status = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, mustWait ? 1'000'000'000 : 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+    {
+      if (mustWait)
+      {
+        continue;
+      }
+      break;
+    }
+
+    // frames that are only polled are seen finishing up to a frame late, so this is an upper bound
+    Filter(_stats.latencyMs, (Now() - _inFlight.front().inputTime) * 1000.0);
+    glDeleteSync(sync);
+    _inFlight.pop_front();
+  }
+}
+
+void FramePacer::BeginFrame()
+{
+  const double start = Now();
+
+  if (_settings.mode == Mode::TARGET_FPS)
+  {
+    const double period = 1.0 / _settings.targetFps;
+    SleepUntil(_nextFrameTime);
+
+    // don't try to catch up after a hitch, just start counting from this frame
+    _nextFrameTime = std::max(_nextFrameTime + period, Now());
+  }
+
+  const double limited = Now();
+
+  // this frame will be the last one allowed in flight
+  RetireFrames(_settings.maxFramesInFlight - 1);
+
+  _inputTime = Now();
+  Filter(_stats.limiterMs, (limited - start) * 1000.0);
+  Filter(_stats.fenceMs, (_inputTime - limited) * 1000.0);
+  if (_frameStart != 0)
+  {
+    Filter(_stats.frameMs, (start - _frameStart) * 1000.0);
+  }
+  _frameStart = start;
+}
+
+void FramePacer::EndFrame()
+{
+  _inFlight.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), _inputTime });
+  RetireFrames(_settings.lowLatency ? 0 : _settings.maxFramesInFlight);
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#pragma once
+#include "utils/Timer.h"
+#include <cstdint>
+#include <deque>
+
+// Decides when each frame starts. Input should be sampled right after BeginFrame returns, so everything that
+// delays a frame (the frame rate limit and waiting for the GPU to catch up) happens before input is read.
+// Frames are fenced after they're swapped, which limits how far the GPU may fall behind and
+// gives a rough time for when each frame was presented.
+class FramePacer
+{
+public:
+  enum class Mode
+  {
+    VSYNC,
+    UNCAPPED,
+    TARGET_FPS, // vsync off, limited on the CPU
+  };
+
+  struct Settings
+  {
+    Mode mode = Mode::VSYNC;
+    double targetFps = 120;
+    uint32_t maxFramesInFlight = 2; // 1 to 3
+
+    // Waits for each frame to be presented before starting the next one, which costs throughput
+    // since the CPU and GPU no longer overlap
+    bool lowLatency = false;
+
+    bool operator==(const Settings&) const = default;
+  };
+
+  // filtered over the last several frames
+  struct Stats
+  {
+    double frameMs = 0; // from one BeginFrame to the next
+    double limiterMs = 0; // waiting for the frame rate limit
+    double fenceMs = 0; // waiting for earlier frames to finish on the GPU
+    double latencyMs = 0; // from input being sampled to the frame's fence being seen signaled. Doesn't include scanout
+  };
+
+  // sets the swap interval of the current context
+  FramePacer();
+  explicit FramePacer(const Settings& settings);
+  ~FramePacer();
+
+  FramePacer(const FramePacer&) = delete;
+  FramePacer& operator=(const FramePacer&) = delete;
+
+  void SetSettings(const Settings& settings);
+  [[nodiscard]] const Settings& GetSettings() const { return _settings; }
+  [[nodiscard]] const Stats& GetStats() const { return _stats; }
+
+  void BeginFrame();
+
+  // call after swapping buffers
+  void EndFrame();
+
+private:
+  struct InFlightFrame
+  {
+    void* fence; // GLsync
+    double inputTime;
+  };
+
+  double Now() const { return _clock.Elapsed_s(); }
+  void SleepUntil(double time) const;
+
+  // waits until no more than maxFrames are in flight, then forgets any others that have already finished
+  void RetireFrames(uint32_t maxFrames);
+
+  Settings _settings;
+  Stats _stats;
+  Timer _clock;
+  std::deque<InFlightFrame> _inFlight;
+  double _nextFrameTime = 0;
+  double _frameStart = 0;
+  double _inputTime = 0;
+};
\ No newline at end of file
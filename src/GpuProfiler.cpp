@@ -0,0 +1,307 @@
+#include "GpuProfiler.h"
+#include "GAssert.h"
+#include <glad/gl.h>
+#include <imgui.h>
+#include <algorithm>
+#include <numeric>
+#include <fstream>
+#include <limits>
+#include <cmath>
+
+namespace
+{
+  constexpr uint32_t NO_ENTRY = std::numeric_limits<uint32_t>::max();
+  constexpr std::string_view FRAME_SCOPE = "Frame";
+}
+
+GpuProfiler::Zone::Zone(GpuProfiler* profiler, std::string_view name)
+  : _profiler(profiler),
+    _entry(profiler->BeginEntry(name))
+{
+}
+
+GpuProfiler::Zone::~Zone()
+{
+  _profiler->EndEntry(_entry);
+}
+
+GpuProfiler::GpuProfiler(uint32_t framesInFlight)
+  : _frames(framesInFlight)
+{
+  G_ASSERT(framesInFlight > 0);
+}
+
+GpuProfiler::~GpuProfiler()
+{
+  if (!_allQueries.empty())
+  {
+    glDeleteQueries(static_cast<GLsizei>(_allQueries.size()), _allQueries.data());
+  }
+}
+
+void GpuProfiler::BeginFrame()
+{
+  // collect every frame that is done, not only the one about to be reused
+  for (auto& frame : _frames)
+  {
+    if (frame.pending)
+    {
+      TryCollect(frame);
+    }
+  }
+
+  // if the GPU is so far behind that this slot is still in use, skip recording this frame instead of waiting
+  auto& frame = _frames[_frameIndex % _frames.size()];
+  _current = frame.pending ? nullptr : &frame;
+  if (_current)
+  {
+    _current->frameIndex = _frameIndex;
+    _current->entries.clear();
+  }
+
+  _frameEntry = BeginEntry(FRAME_SCOPE);
+}
+
+void GpuProfiler::EndFrame()
+{
+  EndEntry(_frameEntry);
+  if (_current)
+  {
+    _current->pending = true;
+  }
+  _current = nullptr;
+  _frameIndex++;
+}
+
+uint32_t GpuProfiler::BeginEntry(std::string_view name)
+{
+  if (!_current)
+  {
+    return NO_ENTRY;
+  }
+
+  auto entry = Entry{ .scope = GetScopeId(name), .startQuery = AcquireQuery(), .endQuery = 0 };
+  glQueryCounter(entry.startQuery, GL_TIMESTAMP);
+  _current->entries.push_back(entry);
+  return static_cast<uint32_t>(_current->entries.size() - 1);
+}
+
+void GpuProfiler::EndEntry(uint32_t entry)
+{
+  if (!_current || entry == NO_ENTRY)
+  {
+    return;
+  }
+
+  auto& e = _current->entries[entry];
+  e.endQuery = AcquireQuery();
+  glQueryCounter(e.endQuery, GL_TIMESTAMP);
+}
+
+uint32_t GpuProfiler::GetScopeId(std::string_view name)
+{
+  // TODO: use heterogeneous lookup when it's available everywhere
+  auto key = std::string(name);
+  if (auto it = _scopeIds.find(key); it != _scopeIds.end())
+  {
+    return it->second;
+  }
+
+  const auto id = static_cast<uint32_t>(_scopes.size());
+  _scopes.push_back(ScopeHistory{ .name = key });
+  _scopeIds.emplace(std::move(key), id);
+  return id;
+}
+
+uint32_t GpuProfiler::AcquireQuery()
+{
+  if (_freeQueries.empty())
+  {
+    GLuint query{};
+    glCreateQueries(GL_TIMESTAMP, 1, &query);
+    _allQueries.push_back(query);
+    return query;
+  }
+
+  const auto query = _freeQueries.back();
+  _freeQueries.pop_back();
+  return query;
+}
+
+bool GpuProfiler::TryCollect(FrameQueries& frame)
+{
+  // queries complete in order, and the end of the "Frame" scope is the last one
+  if (!frame.entries.empty())
+  {
+    GLint available{};
+    glGetQueryObjectiv(frame.entries.front().endQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+    {
+      return false;
+    }
+  }
+
+  auto record = FrameRecord{ .frameIndex = frame.frameIndex, .scopeMs = std::vector<double>(_scopes.size(), std::nan("")) };
+  for (const auto& entry : frame.entries)
+  {
+    GLuint64 start{};
+    GLuint64 end{};
+    glGetQueryObjectui64v(entry.startQuery, GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(entry.endQuery, GL_QUERY_RESULT, &end);
+    _freeQueries.push_back(entry.startQuery);
+    _freeQueries.push_back(entry.endQuery);
+
+    const double ms = static_cast<double>(end - start) / 1'000'000.0;
+
+    // a scope can run more than once per frame (e.g. for each emitter), so sum them
+    auto& total = record.scopeMs[entry.scope];
+    total = std::isnan(total) ? ms : total + ms;
+  }
+
+  for (uint32_t scope = 0; scope < record.scopeMs.size(); scope++)
+  {
+    const double ms = record.scopeMs[scope];
+    if (std::isnan(ms))
+    {
+      continue;
+    }
+
+    auto& history = _scopes[scope];
+    if (history.samples.size() < HISTORY_SIZE)
+    {
+      history.samples.push_back(ms);
+    }
+    else
+    {
+      history.samples[history.next] = ms;
+    }
+    history.next = (history.next + 1) % HISTORY_SIZE;
+  }
+
+  if (!frame.entries.empty())
+  {
+    _lastFrameMs = record.scopeMs[frame.entries.front().scope];
+  }
+
+  _records.push_back(std::move(record));
+  if (_records.size() > CSV_FRAMES)
+  {
+    _records.pop_front();
+  }
+
+  frame.entries.clear();
+  frame.pending = false;
+  return true;
+}
+
+std::vector<GpuProfiler::ScopeStats> GpuProfiler::GetStats() const
+{
+  std::vector<ScopeStats> stats;
+  std::vector<double> sorted;
+  for (const auto& scope : _scopes)
+  {
+    if (scope.samples.empty())
+    {
+      continue;
+    }
+
+    sorted = scope.samples;
+    std::sort(sorted.begin(), sorted.end());
+    const size_t last = (scope.next + HISTORY_SIZE - 1) % HISTORY_SIZE;
+    stats.push_back(ScopeStats
+      {
+        .name = scope.name,
+        .lastMs = scope.samples[std::min(last, scope.samples.size() - 1)],
+        .minMs = sorted.front(),
+        .avgMs = std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size(),
+        .p99Ms = sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)],
+      });
+  }
+
+  return stats;
+}
+
+double GpuProfiler::GetLastFrameTimeMs() const
+{
+  return _lastFrameMs;
+}
+
+bool GpuProfiler::WriteCsv(const std::string& path) const
+{
+  std::ofstream file(path);
+  if (!file)
+  {
+    return false;
+  }
+
+  file << "frame";
+  for (const auto& scope : _scopes)
+  {
+    file << ',' << scope.name;
+  }
+  file << '\n';
+
+  // scopes that didn't run in a frame are left empty
+  for (const auto& record : _records)
+  {
+    file << record.frameIndex;
+    for (size_t scope = 0; scope < _scopes.size(); scope++)
+    {
+      file << ',';
+      if (scope < record.scopeMs.size() && !std::isnan(record.scopeMs[scope]))
+      {
+        file << record.scopeMs[scope];
+      }
+    }
+    file << '\n';
+  }
+
+  return true;
+}
+
+void GpuProfiler::DrawImGui(bool* open)
+{
+  ImGui::SetNextWindowSize(ImVec2(420, 0), ImGuiCond_FirstUseEver);
+  if (!ImGui::Begin("GPU Profiler", open))
+  {
+    ImGui::End();
+    return;
+  }
+
+  ImGui::Text("Times in ms over the last %zu frames", HISTORY_SIZE);
+  if (ImGui::BeginTable("scopes", 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders))
+  {
+    ImGui::TableSetupColumn("Scope");
+    ImGui::TableSetupColumn("Last");
+    ImGui::TableSetupColumn("Min");
+    ImGui::TableSetupColumn("Avg");
+    ImGui::TableSetupColumn("P99");
+    ImGui::TableHeadersRow();
+
+    for (const auto& scope : GetStats())
+    {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(scope.name.data(), scope.name.data() + scope.name.size());
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", scope.lastMs);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", scope.minMs);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", scope.avgMs);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", scope.p99Ms);
+    }
+
+    ImGui::EndTable();
+  }
+
+  if (ImGui::Button("Export CSV"))
+  {
+    WriteCsv("gpu_profile.csv");
+  }
+  ImGui::SameLine();
+  ImGui::Text("(%zu frames)", _records.size());
+
+  ImGui::End();
+}
\ No newline at end of file
@@ -0,0 +1,120 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+
+// Measures GPU time of named scopes with GL_TIMESTAMP query pairs.
+// Queries are kept in a ring of frames and only read once they are available,
+// so results arrive a few frames late and reading them never stalls.
+class GpuProfiler
+{
+public:
+  // Ends its scope when destroyed.
+  class Zone
+  {
+  public:
+    Zone(GpuProfiler* profiler, std::string_view name);
+    ~Zone();
+
+    Zone(const Zone&) = delete;
+    Zone(Zone&&) = delete;
+    Zone& operator=(const Zone&) = delete;
+    Zone& operator=(Zone&&) = delete;
+
+  private:
+    GpuProfiler* _profiler;
+    uint32_t _entry;
+  };
+
+  struct ScopeStats
+  {
+    std::string_view name;
+    double lastMs;
+    double minMs;
+    double avgMs;
+    double p99Ms;
+  };
+
+  explicit GpuProfiler(uint32_t framesInFlight = 4);
+  ~GpuProfiler();
+
+  GpuProfiler(const GpuProfiler&) = delete;
+  GpuProfiler(GpuProfiler&&) = delete;
+  GpuProfiler& operator=(const GpuProfiler&) = delete;
+  GpuProfiler& operator=(GpuProfiler&&) = delete;
+
+  // Collects results of old frames that have finished and starts timing the whole frame.
+  void BeginFrame();
+  void EndFrame();
+
+  [[nodiscard]] Zone Scope(std::string_view name) { return Zone(this, name); }
+
+  // Rolling stats of every scope seen so far, including "Frame".
+  std::vector<ScopeStats> GetStats() const;
+
+  // GPU time of the last frame whose results are available, or 0 if there is none.
+  double GetLastFrameTimeMs() const;
+
+  // Writes one row per recorded frame, with one column per scope. Returns false if the file couldn't be opened.
+  bool WriteCsv(const std::string& path) const;
+
+  void DrawImGui(bool* open);
+
+private:
+  friend class Zone;
+
+  // how many samples min/avg/p99 are computed from
+  static constexpr size_t HISTORY_SIZE = 256;
+
+  // how many frames are kept for CSV export
+  static constexpr size_t CSV_FRAMES = 4096;
+
+  struct Entry
+  {
+    uint32_t scope;
+    uint32_t startQuery;
+    uint32_t endQuery;
+  };
+
+  struct FrameQueries
+  {
+    uint64_t frameIndex = 0;
+    bool pending = false;
+    std::vector<Entry> entries;
+  };
+
+  struct ScopeHistory
+  {
+    std::string name;
+    std::vector<double> samples; // ring of HISTORY_SIZE
+    size_t next = 0;
+  };
+
+  struct FrameRecord
+  {
+    uint64_t frameIndex;
+    std::vector<double> scopeMs; // indexed by scope, NaN if the scope didn't run
+  };
+
+  uint32_t BeginEntry(std::string_view name);
+  void EndEntry(uint32_t entry);
+  uint32_t GetScopeId(std::string_view name);
+  uint32_t AcquireQuery();
+  bool TryCollect(FrameQueries& frame);
+
+  std::vector<FrameQueries> _frames;
+  FrameQueries* _current = nullptr; // null if this frame isn't recorded
+  uint32_t _frameEntry = 0;
+  uint64_t _frameIndex = 0;
+
+  std::vector<uint32_t> _freeQueries;
+  std::vector<uint32_t> _allQueries;
+
+  std::unordered_map<std::string, uint32_t> _scopeIds;
+  std::vector<ScopeHistory> _scopes;
+  std::deque<FrameRecord> _records;
+  double _lastFrameMs = 0;
+};
\ No newline at end of file
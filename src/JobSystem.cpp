@@ -0,0 +1,171 @@
+#include "JobSystem.h"
+#include "GAssert.h"
+#include <utility>
+
+namespace
+{
+  // which pool the current thread is a worker of, and its queue in that pool
+  thread_local const JobSystem* tPool = nullptr;
+  thread_local uint32_t tQueueIndex = 0;
+}
+
+JobSystem::JobSystem(uint32_t numWorkers)
+{
+  for (uint32_t i = 0; i < numWorkers + 1; i++)
+  {
+    _queues.push_back(std::make_unique<Queue>());
+  }
+
+  _workers.reserve(numWorkers);
+  for (uint32_t i = 0; i < numWorkers; i++)
+  {
+    _workers.emplace_back([this, i] { WorkerMain(i); });
+  }
+}
+
+JobSystem::~JobSystem()
+{
+  {
+    auto lock = std::lock_guard(_sleepMutex);
+    _stop = true;
+  }
+  _wake.notify_all();
+
+  for (auto& worker : _workers)
+  {
+    worker.join();
+  }
+
+  G_ASSERT_MSG(_queuedTasks.load() == 0, "Jobs were submitted without being waited on");
+}
+
+JobSystem::Queue& JobSystem::LocalQueue()
+{
+  return tPool == this ? *_queues[tQueueIndex] : *_queues.back();
+}
+
+void JobSystem::Submit(Counter& counter, Job job)
+{
+  counter._pending.fetch_add(1, std::memory_order_relaxed);
+
+  {
+    auto& queue = LocalQueue();
+    auto lock = std::lock_guard(queue.mutex);
+    queue.tasks.push_back({ std::move(job), &counter });
+  }
+
+  {
+    // the increment is made under the lock so a worker can't check it and go to sleep in between
+    auto lock = std::lock_guard(_sleepMutex);
+    _queuedTasks.fetch_add(1, std::memory_order_release);
+  }
+  _wake.notify_one();
+}
+
+bool JobSystem::TryRun(uint32_t firstQueue)
+{
+  if (_queuedTasks.load(std::memory_order_acquire) == 0)
+  {
+    return false;
+  }
+
+  std::optional<Task> task;
+  const auto numQueues = static_cast<uint32_t>(_queues.size());
+  for (uint32_t i = 0; i < numQueues && !task; i++)
+  {
+    auto& queue = *_queues[(firstQueue + i) % numQueues];
+    auto lock = std::lock_guard(queue.mutex);
+    if (queue.tasks.empty())
+    {
+      continue;
+    }
+
+    // the newest task of our own queue is the most likely to be in cache, the oldest of another is the biggest
+    if (i == 0)
+    {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    }
+    else
+    {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    }
+  }
+
+  if (!task)
+  {
+    return false;
+  }
+
+  _queuedTasks.fetch_sub(1, std::memory_order_relaxed);
+  auto& counter = *task->counter;
+  try
+  {
+    task->job();
+  }
+  catch (...)
+  {
+    if (!counter._failed.test_and_set(std::memory_order_relaxed))
+    {
+      counter._error = std::current_exception();
+    }
+  }
+
+  // the waiter may destroy the counter as soon as it's done, so it must not be touched after this
+  if (counter._pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+  {
+    // a waiter checks the counter under the lock, so taking it means the waiter is either asleep or will see it's done
+    {
+      auto lock = std::lock_guard(_sleepMutex);
+    }
+    _wake.notify_all();
+  }
+  return true;
+}
+
+bool JobSystem::RunOne()
+{
+  return TryRun(tPool == this ? tQueueIndex : static_cast<uint32_t>(_queues.size() - 1));
+}
+
+void JobSystem::Wait(Counter& counter)
+{
+  while (!counter.Done())
+  {
+    if (RunOne())
+    {
+      continue;
+    }
+
+    auto lock = std::unique_lock(_sleepMutex);
+    _wake.wait(lock, [&] { return counter.Done() || _queuedTasks.load(std::memory_order_acquire) > 0; });
+  }
+
+  if (counter._error)
+  {
+    counter._failed.clear();
+    std::rethrow_exception(std::exchange(counter._error, nullptr));
+  }
+}
+
+void JobSystem::WorkerMain(uint32_t index)
+{
+  tPool = this;
+  tQueueIndex = index;
+
+  while (true)
+  {
+    if (TryRun(index))
+    {
+      continue;
+    }
+
+    auto lock = std::unique_lock(_sleepMutex);
+    _wake.wait(lock, [this] { return _stop || _queuedTasks.load(std::memory_order_acquire) > 0; });
+    if (_stop)
+    {
+      return;
+    }
+  }
+}
\ No newline at end of file
@@ -0,0 +1,118 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// A fixed pool of worker threads that each own a queue of jobs. Workers run the newest job of their own queue
+// and steal the oldest job of another queue when theirs is empty. Threads that wait on jobs run queued jobs
+// while they wait, so jobs may wait on other jobs without deadlocking the pool.
+class JobSystem
+{
+public:
+  using Job = std::function<void()>;
+
+  // how many jobs of a group haven't finished, and the first exception one of them threw
+  class Counter
+  {
+  public:
+    [[nodiscard]] bool Done() const { return _pending.load(std::memory_order_acquire) == 0; }
+
+  private:
+    friend class JobSystem;
+    std::atomic<uint32_t> _pending = 0;
+    std::atomic_flag _failed;
+    std::exception_ptr _error; // written once by the job that set _failed, read once the counter is done
+  };
+
+  // with 0 workers, every job runs on the thread that waits for it
+  explicit JobSystem(uint32_t numWorkers = std::max(std::thread::hardware_concurrency(), 1u) - 1);
+  ~JobSystem();
+
+  JobSystem(const JobSystem&) = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
+
+  // counter must outlive the job
+  void Submit(Counter& counter, Job job);
+
+  // Runs queued jobs until counter is done, and sleeps while there are none. Rethrows the first exception
+  // thrown by a job of the counter once all of them are done
+  void Wait(Counter& counter);
+
+  // Runs one queued job on the calling thread. Returns false if there was none
+  bool RunOne();
+
+  // Calls fn(begin, end) for chunks of [0, count) that are at least minChunkSize long, and returns once every chunk is done
+  template<typename Fn>
+  void ParallelFor(size_t count, size_t minChunkSize, Fn&& fn)
+  {
+    if (count == 0)
+    {
+      return;
+    }
+
+    // a few chunks per thread so stealing can even out chunks that take longer
+    const size_t maxChunks = (_workers.size() + 1) * 4;
+    const size_t numChunks = std::clamp<size_t>(count / std::max<size_t>(minChunkSize, 1), 1, maxChunks);
+    const size_t chunkSize = (count + numChunks - 1) / numChunks;
+
+    Counter counter;
+    for (size_t begin = chunkSize; begin < count; begin += chunkSize)
+    {
+      Submit(counter, [&fn, begin, end = std::min(begin + chunkSize, count)] { fn(begin, end); });
+    }
+    // the other chunks refer to fn and counter, so they must finish even if this one throws
+    std::exception_ptr error;
+    try
+    {
+      fn(size_t(0), std::min(chunkSize, count));
+    }
+    catch (...)
+    {
+      error = std::current_exception();
+    }
+    Wait(counter);
+    if (error)
+    {
+      std::rethrow_exception(error);
+    }
+  }
+
+  [[nodiscard]] uint32_t NumWorkers() const { return static_cast<uint32_t>(_workers.size()); }
+
+private:
+  struct Task
+  {
+    Job job;
+    Counter* counter;
+  };
+
+  struct Queue
+  {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  // the queue that jobs submitted from this thread go to
+  Queue& LocalQueue();
+  bool TryRun(uint32_t firstQueue);
+  void WorkerMain(uint32_t index);
+
+  // one per worker, then one shared by every thread outside the pool
+  std::vector<std::unique_ptr<Queue>> _queues;
+  std::vector<std::thread> _workers;
+
+  // workers sleep until there are queued tasks, waiting threads also until their counter is done
+  std::mutex _sleepMutex;
+  std::condition_variable _wake;
+  std::atomic<uint32_t> _queuedTasks = 0;
+  bool _stop = false; // guarded by _sleepMutex
+};
\ No newline at end of file
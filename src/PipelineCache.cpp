@@ -0,0 +1,334 @@
+#include "PipelineCache.h"
+#include "utils/AssetLoader.h"
+#include "utils/Timer.h"
+#include <glad/gl.h>
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace
+{
+  // bump when the file layout changes
+  constexpr uint32_t CACHE_VERSION = 1;
+
+  constexpr const char* STUB_VERTEX = "#version 460 core\nvoid main() { gl_Position = vec4(0); }";
+  constexpr const char* STUB_FRAGMENT = "#version 460 core\nlayout(location = 0) out vec4 o_color;\nvoid main() { o_color = vec4(0); }";
+  constexpr const char* STUB_COMPUTE = "#version 460 core\nlayout(local_size_x = 1) in;\nvoid main() {}";
+
+  struct BinaryHeader
+  {
+    uint32_t version;
+    uint32_t format; // from glGetProgramBinary
+  };
+
+  bool HasExtension(std::string_view name)
+  {
+    GLint numExtensions{};
+    glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+    for (GLint i = 0; i < numExtensions; i++)
+    {
+      if (name == reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i)))
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Lets the driver compile on as many of its own threads as it likes. The entry point is loaded by hand
+  // since the extension may not be in the loader. Returns false if the extension isn't supported
+  bool EnableParallelShaderCompile()
+  {
+    using MaxShaderCompilerThreadsFn = void(GLAPIENTRY*)(GLuint count);
+    const char* entryPoint = nullptr;
+    if (HasExtension("GL_KHR_parallel_shader_compile"))
+    {
+      entryPoint = "glMaxShaderCompilerThreadsKHR";
+    }
+    else if (HasExtension("GL_ARB_parallel_shader_compile"))
+    {
+      entryPoint = "glMaxShaderCompilerThreadsARB";
+    }
+
+    if (entryPoint)
+    {
+      if (auto maxShaderCompilerThreads = reinterpret_cast<MaxShaderCompilerThreadsFn>(glfwGetProcAddress(entryPoint)))
+      {
+        maxShaderCompilerThreads(0xFFFFFFFF);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // FNV-1a
+  uint64_t Hash(uint64_t hash, const void* data, size_t size)
+  {
+    for (size_t i = 0; i < size; i++)
+    {
+      hash ^= static_cast<const uint8_t*>(data)[i];
+      hash *= 0x100000001b3ull;
+    }
+    return hash;
+  }
+
+  std::string ShaderLog(GLuint shader)
+  {
+    GLint length{};
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+    std::string log(std::max(length, 1), '\0');
+    glGetShaderInfoLog(shader, length, nullptr, log.data());
+    return log;
+  }
+
+  std::string ProgramLog(GLuint program)
+  {
+    GLint length{};
+    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+    std::string log(std::max(length, 1), '\0');
+    glGetProgramInfoLog(program, length, nullptr, log.data());
+    return log;
+  }
+}
+
+PipelineCache::PipelineCache(std::string directory)
+  : _directory(std::move(directory)),
+    _stubVertex(Fwog::PipelineStage::VERTEX_SHADER, STUB_VERTEX),
+    _stubFragment(Fwog::PipelineStage::FRAGMENT_SHADER, STUB_FRAGMENT),
+    _stubCompute(Fwog::PipelineStage::COMPUTE_SHADER, STUB_COMPUTE)
+{
+  for (auto name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+  {
+    _driver += reinterpret_cast<const char*>(glGetString(name));
+    _driver += '\n';
+  }
+
+  GLint numFormats{};
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+  _binariesSupported = numFormats > 0;
+  _parallelCompile = EnableParallelShaderCompile();
+}
+
+Fwog::GraphicsPipeline PipelineCache::AddGraphics(std::string_view vertexPath, std::string_view fragmentPath, Fwog::GraphicsPipelineInfo info)
+{
+  info.vertexShader = &_stubVertex;
+  info.fragmentShader = &_stubFragment;
+  auto pipeline = Fwog::CompileGraphicsPipeline(info);
+  _programs.push_back({
+    .handle = static_cast<uint32_t>(pipeline.id),
+    .stages = { MakeStage(GL_VERTEX_SHADER, vertexPath), MakeStage(GL_FRAGMENT_SHADER, fragmentPath) },
+  });
+  return pipeline;
+}
+
+Fwog::ComputePipeline PipelineCache::AddCompute(std::string_view computePath)
+{
+  auto pipeline = Fwog::CompileComputePipeline({ .shader = &_stubCompute });
+  _programs.push_back({
+    .handle = static_cast<uint32_t>(pipeline.id),
+    .stages = { MakeStage(GL_COMPUTE_SHADER, computePath) },
+  });
+  return pipeline;
+}
+
+PipelineCache::Stage PipelineCache::MakeStage(uint32_t type, std::string_view path)
+{
+  // the sources are read in the background while more pipelines are added
+  return { .type = type, .path = std::string(path), .source = AssetLoader::Get().LoadText(path) };
+}
+
+uint64_t PipelineCache::Key(const Program& program, const std::vector<std::string>& sources) const
+{
+  auto hash = Hash(0xcbf29ce484222325ull, &CACHE_VERSION, sizeof(CACHE_VERSION));
+  hash = Hash(hash, _driver.data(), _driver.size());
+  for (size_t i = 0; i < sources.size(); i++)
+  {
+    hash = Hash(hash, &program.stages[i].type, sizeof(program.stages[i].type));
+    hash = Hash(hash, sources[i].data(), sources[i].size() + 1); // with the terminator, so sources can't run together
+  }
+  return hash;
+}
+
+std::string PipelineCache::BinaryPath(uint64_t key) const
+{
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.bin", static_cast<unsigned long long>(key));
+  return _directory + "/" + name;
+}
+
+bool PipelineCache::LoadBinary(const Program& program, uint64_t key) const
+{
+  auto file = std::ifstream(BinaryPath(key), std::ios::binary | std::ios::ate);
+  if (!file)
+  {
+    return false;
+  }
+
+  const auto size = static_cast<size_t>(file.tellg());
+  if (size <= sizeof(BinaryHeader))
+  {
+    return false;
+  }
+
+  BinaryHeader header{};
+  std::vector<char> binary(size - sizeof(BinaryHeader));
+  file.seekg(0);
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+  file.read(binary.data(), binary.size());
+  if (!file || header.version != CACHE_VERSION)
+  {
+    return false;
+  }
+
+  // the driver rejects binaries it can't use, e.g. ones from before an update that kept the version string
+  glProgramBinary(program.handle, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+  GLint linked{};
+  glGetProgramiv(program.handle, GL_LINK_STATUS, &linked);
+  return linked == GL_TRUE;
+}
+
+void PipelineCache::SaveBinary(const Program& program, uint64_t key) const
+{
+  GLint length{};
+  glGetProgramiv(program.handle, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0)
+  {
+    return;
+  }
+
+  BinaryHeader header{ .version = CACHE_VERSION };
+  std::vector<char> binary(length);
+  glGetProgramBinary(program.handle, length, nullptr, &header.format, binary.data());
+
+  // the cache is only an optimization, so failing to write it isn't an error
+  auto error = std::error_code();
+  std::filesystem::create_directories(_directory, error);
+  auto file = std::ofstream(BinaryPath(key), std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(binary.data(), binary.size());
+}
+
+void PipelineCache::Build()
+{
+  Timer timer;
+
+  struct Miss
+  {
+    const Program* program;
+    uint64_t key;
+    std::vector<std::string> sources;
+    std::vector<GLuint> shaders;
+  };
+
+  std::vector<Miss> misses;
+  for (const auto& program : _programs)
+  {
+    std::vector<std::string> sources;
+    for (const auto& stage : program.stages)
+    {
+      sources.push_back(stage.source.get());
+    }
+
+    const auto key = Key(program, sources);
+    if (!_binariesSupported || !LoadBinary(program, key))
+    {
+      misses.push_back({ .program = &program, .key = key, .sources = std::move(sources) });
+    }
+  }
+
+  // Nothing is checked until everything is submitted, since checking a status waits for that compile or link to finish.
+  // The stubs are replaced by the real shaders and the programs are linked again
+  for (auto& miss : misses)
+  {
+    for (size_t i = 0; i < miss.sources.size(); i++)
+    {
+      const auto shader = glCreateShader(miss.program->stages[i].type);
+      const auto* source = miss.sources[i].c_str();
+      glShaderSource(shader, 1, &source, nullptr);
+      glCompileShader(shader);
+      miss.shaders.push_back(shader);
+    }
+  }
+
+  for (auto& miss : misses)
+  {
+    const auto program = miss.program->handle;
+    GLuint attached[4]{};
+    GLsizei numAttached{};
+    glGetAttachedShaders(program, 4, &numAttached, attached);
+    for (GLsizei i = 0; i < numAttached; i++)
+    {
+      glDetachShader(program, attached[i]);
+    }
+
+    for (auto shader : miss.shaders)
+    {
+      glAttachShader(program, shader);
+    }
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+  }
+
+  if (_parallelCompile)
+  {
+    auto isDone = [](const Miss& miss)
+    {
+      GLint done{};
+      glGetProgramiv(miss.program->handle, GL_COMPLETION_STATUS_KHR, &done);
+      return done == GL_TRUE;
+    };
+
+    while (!std::all_of(misses.begin(), misses.end(), isDone))
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  for (auto& miss : misses)
+  {
+    const auto program = miss.program->handle;
+    GLint linked{};
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE)
+    {
+      auto message = std::string("Failed to build a pipeline from");
+      for (size_t i = 0; i < miss.shaders.size(); i++)
+      {
+        message += " " + miss.program->stages[i].path;
+      }
+      message += "\n";
+
+      for (auto shader : miss.shaders)
+      {
+        message += ShaderLog(shader);
+      }
+      message += ProgramLog(program);
+      throw std::runtime_error(message);
+    }
+
+    if (_binariesSupported)
+    {
+      SaveBinary(*miss.program, miss.key);
+    }
+
+    for (auto shader : miss.shaders)
+    {
+      glDetachShader(program, shader);
+      glDeleteShader(shader);
+    }
+  }
+
+  printf("Built %zu pipelines in %.1fms, %zu from the cache\n",
+    _programs.size(), timer.Elapsed_ms(), _programs.size() - misses.size());
+  _programs.clear();
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+#include <Fwog/Pipeline.h>
+#include <Fwog/Shader.h>
+#include <cstdint>
+#include <future>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Builds pipelines from program binaries that an earlier run saved, so a warm start does almost no compiling.
+// Programs without a usable binary are all submitted to the driver before any of them is checked, so it can compile
+// them in parallel, then their binaries are saved. Binaries are keyed by a hash of the sources and the driver strings.
+class PipelineCache
+{
+public:
+  explicit PipelineCache(std::string directory = "shadercache");
+
+  PipelineCache(const PipelineCache&) = delete;
+  PipelineCache& operator=(const PipelineCache&) = delete;
+
+  // The returned pipelines have info's state, but can't be bound until Build is called. info's shaders are ignored
+  [[nodiscard]] Fwog::GraphicsPipeline AddGraphics(std::string_view vertexPath, std::string_view fragmentPath, Fwog::GraphicsPipelineInfo info);
+  [[nodiscard]] Fwog::ComputePipeline AddCompute(std::string_view computePath);
+
+  // Throws std::runtime_error with the info logs if a program fails to compile or link
+  void Build();
+
+private:
+  struct Stage
+  {
+    uint32_t type; // GLenum
+    std::string path;
+    std::shared_future<std::string> source;
+  };
+
+  struct Program
+  {
+    uint32_t handle; // Fwog's pipeline ids are the names of the programs it links
+    std::vector<Stage> stages;
+  };
+
+  Stage MakeStage(uint32_t type, std::string_view path);
+  uint64_t Key(const Program& program, const std::vector<std::string>& sources) const;
+  std::string BinaryPath(uint64_t key) const;
+  bool LoadBinary(const Program& program, uint64_t key) const;
+  void SaveBinary(const Program& program, uint64_t key) const;
+
+  std::string _directory;
+  std::string _driver;
+  bool _binariesSupported;
+  bool _parallelCompile;
+
+  // Fwog only makes pipelines from shaders it compiled, so every pipeline starts from these
+  // and its program is replaced by Build
+  Fwog::Shader _stubVertex;
+  Fwog::Shader _stubFragment;
+  Fwog::Shader _stubCompute;
+
+  std::vector<Program> _programs;
+};
\ No newline at end of file
@@ -0,0 +1,391 @@
+#include "RenderGraph.h"
+#include "GAssert.h"
+#include "GpuProfiler.h"
+#include <Fwog/Texture.h>
+#include <Fwog/Buffer.h>
+#include <glad/gl.h>
+#include <algorithm>
+#include <bit>
+#include <optional>
+#include <utility>
+
+namespace
+{
+  // physical textures that go unused for this many frames are freed
+  constexpr uint32_t MAX_UNUSED_FRAMES = 8;
+
+  // Textures with the same texel size can be viewed as each other, so they can share storage.
+  // 0 means the format can only share storage with itself.
+  uint32_t TexelBits(Fwog::Format format)
+  {
+    switch (format)
+    {
+    case Fwog::Format::R8G8B8A8_UNORM:
+    case Fwog::Format::R8G8B8A8_SRGB:
+    case Fwog::Format::R32_UINT:
+    case Fwog::Format::R32_SINT:
+    case Fwog::Format::R32_FLOAT:
+      return 32;
+    case Fwog::Format::R16G16B16A16_FLOAT:
+    case Fwog::Format::R32G32_UINT:
+    case Fwog::Format::R32G32_FLOAT:
+      return 64;
+    default:
+      return 0;
+    }
+  }
+
+  bool CanShareStorage(const RenderGraph::TextureDesc& a, const RenderGraph::TextureDesc& b)
+  {
+    if (a.extent.width != b.extent.width || a.extent.height != b.extent.height || a.mipLevels != b.mipLevels)
+    {
+      return false;
+    }
+    return a.format == b.format || (TexelBits(a.format) != 0 && TexelBits(a.format) == TexelBits(b.format));
+  }
+
+  // the barriers needed before an access can see incoherent writes
+  GLbitfield GetBarrierBits(RenderGraph::Access access, bool isBuffer)
+  {
+    using Access = RenderGraph::Access;
+    switch (access)
+    {
+    case Access::SAMPLED: return GL_TEXTURE_FETCH_BARRIER_BIT;
+    case Access::STORAGE_READ:
+    case Access::STORAGE_WRITE: return isBuffer ? GL_SHADER_STORAGE_BARRIER_BIT : GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+    case Access::ATTACHMENT: return GL_FRAMEBUFFER_BARRIER_BIT;
+    case Access::INDIRECT: return GL_COMMAND_BARRIER_BIT;
+    case Access::UNIFORM: return GL_UNIFORM_BARRIER_BIT;
+    // blits go through framebuffers
+    case Access::TRANSFER_READ:
+    case Access::TRANSFER_WRITE: return isBuffer ? GL_BUFFER_UPDATE_BARRIER_BIT : GL_TEXTURE_UPDATE_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT;
+    default: G_UNREACHABLE; return GL_ALL_BARRIER_BITS;
+    }
+  }
+}
+
+struct RenderGraph::PhysicalTexture
+{
+  explicit PhysicalTexture(const TextureDesc& desc)
+    : desc(desc),
+      texture(Fwog::CreateTexture2DMip(desc.extent, desc.format, desc.mipLevels, "render graph transient"))
+  {
+  }
+
+  Fwog::Texture& View(Fwog::Format format)
+  {
+    if (format == desc.format)
+    {
+      return texture;
+    }
+
+    for (const auto& [viewFormat, view] : views)
+    {
+      if (viewFormat == format)
+      {
+        return *view;
+      }
+    }
+
+    return *views.emplace_back(format, std::make_unique<Fwog::TextureView>(texture.CreateFormatView(format))).second;
+  }
+
+  TextureDesc desc;
+  Fwog::Texture texture;
+  std::vector<std::pair<Fwog::Format, std::unique_ptr<Fwog::TextureView>>> views;
+
+  // the last pass that uses the current occupant this frame
+  bool isOccupied = false;
+  uint32_t busyUntil = 0;
+  uint32_t unusedFrames = 0;
+};
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Read(TextureHandle texture, Access access)
+{
+  _graph->AddAccess(_pass, texture.index, access, Mode::READ);
+  return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Read(BufferHandle buffer, Access access)
+{
+  _graph->AddAccess(_pass, buffer.index, access, Mode::READ);
+  return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Write(TextureHandle texture, Access access)
+{
+  _graph->AddAccess(_pass, texture.index, access, Mode::WRITE);
+  return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Write(BufferHandle buffer, Access access)
+{
+  _graph->AddAccess(_pass, buffer.index, access, Mode::WRITE);
+  return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Overwrite(TextureHandle texture, Access access)
+{
+  _graph->AddAccess(_pass, texture.index, access, Mode::OVERWRITE);
+  return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Overwrite(BufferHandle buffer, Access access)
+{
+  _graph->AddAccess(_pass, buffer.index, access, Mode::OVERWRITE);
+  return *this;
+}
+
+RenderGraph::RenderGraph(GpuProfiler* profiler)
+  : _profiler(profiler)
+{
+  // the swapchain is always resource 0
+  _resources.push_back({ .isOutput = true, .incoherentWrite = false });
+}
+
+RenderGraph::~RenderGraph() = default;
+
+RenderGraph::TextureHandle RenderGraph::CreateTexture(const TextureDesc& desc)
+{
+  _resources.push_back({ .isTransient = true, .desc = desc });
+  return { static_cast<uint32_t>(_resources.size() - 1) };
+}
+
+RenderGraph::TextureHandle RenderGraph::ImportTexture(Fwog::Texture& texture)
+{
+  for (uint32_t i = 0; i < _resources.size(); i++)
+  {
+    if (_resources[i].texture == &texture)
+    {
+      return { i };
+    }
+  }
+
+  _resources.push_back({ .texture = &texture });
+  return { static_cast<uint32_t>(_resources.size() - 1) };
+}
+
+RenderGraph::BufferHandle RenderGraph::ImportBuffer(const Fwog::Buffer& buffer)
+{
+  for (uint32_t i = 0; i < _resources.size(); i++)
+  {
+    if (_resources[i].buffer == &buffer)
+    {
+      return { i };
+    }
+  }
+
+  _resources.push_back({ .isBuffer = true, .buffer = &buffer });
+  return { static_cast<uint32_t>(_resources.size() - 1) };
+}
+
+void RenderGraph::MarkOutput(TextureHandle texture)
+{
+  _resources[texture.index].isOutput = true;
+}
+
+RenderGraph::PassBuilder RenderGraph::AddPass(std::string_view name, ExecuteFn execute)
+{
+  _passes.push_back({ .name = std::string(name), .execute = std::move(execute) });
+  return PassBuilder(this, static_cast<uint32_t>(_passes.size() - 1));
+}
+
+Fwog::Texture& RenderGraph::GetTexture(TextureHandle texture) const
+{
+  const auto& resource = _resources[texture.index];
+  G_ASSERT_MSG(!resource.isBuffer && resource.texture, "Texture is not allocated. Did the pass declare its access?");
+  return *resource.texture;
+}
+
+const Fwog::Buffer& RenderGraph::GetBuffer(BufferHandle buffer) const
+{
+  const auto& resource = _resources[buffer.index];
+  G_ASSERT(resource.isBuffer);
+  return *resource.buffer;
+}
+
+void RenderGraph::AddAccess(uint32_t pass, uint32_t resource, Access access, Mode mode)
+{
+  G_ASSERT(pass < _passes.size() && resource < _resources.size());
+  _passes[pass].accesses.push_back({ .resource = resource, .access = access, .mode = mode });
+}
+
+void RenderGraph::Cull()
+{
+  // walk backwards from the outputs. A pass is alive if it writes something that a later live pass needs
+  std::vector<bool> needed(_resources.size());
+  for (size_t i = 0; i < _resources.size(); i++)
+  {
+    needed[i] = _resources[i].isOutput;
+  }
+
+  _numCulledPasses = 0;
+  for (auto it = _passes.rbegin(); it != _passes.rend(); ++it)
+  {
+    auto& pass = *it;
+    pass.alive = std::any_of(pass.accesses.begin(), pass.accesses.end(), [&](const ResourceAccess& access)
+      {
+        return access.mode != Mode::READ && needed[access.resource];
+      });
+
+    if (!pass.alive)
+    {
+      _numCulledPasses++;
+      continue;
+    }
+
+    // earlier contents of overwritten resources are dead, unless this pass also reads them
+    for (const auto& access : pass.accesses)
+    {
+      if (access.mode == Mode::OVERWRITE)
+      {
+        needed[access.resource] = false;
+      }
+    }
+
+    for (const auto& access : pass.accesses)
+    {
+      if (access.mode == Mode::READ)
+      {
+        needed[access.resource] = true;
+      }
+    }
+  }
+}
+
+void RenderGraph::AllocateTransients()
+{
+  std::vector<uint32_t> transients;
+  for (uint32_t p = 0; p < _passes.size(); p++)
+  {
+    if (!_passes[p].alive)
+    {
+      continue;
+    }
+
+    for (const auto& access : _passes[p].accesses)
+    {
+      auto& resource = _resources[access.resource];
+      if (resource.isTransient && resource.firstPass == UINT32_MAX)
+      {
+        transients.push_back(access.resource);
+      }
+      resource.firstPass = std::min(resource.firstPass, p);
+      resource.lastPass = std::max(resource.lastPass, p);
+    }
+  }
+
+  for (auto& physical : _physicalTextures)
+  {
+    physical->isOccupied = false;
+  }
+
+  // transients are already sorted by their first pass, so storage can be handed out greedily
+  for (uint32_t index : transients)
+  {
+    auto& resource = _resources[index];
+    auto it = std::find_if(_physicalTextures.begin(), _physicalTextures.end(), [&](const auto& physical)
+      {
+        return CanShareStorage(physical->desc, resource.desc) && (!physical->isOccupied || physical->busyUntil < resource.firstPass);
+      });
+
+    if (it == _physicalTextures.end())
+    {
+      _physicalTextures.push_back(std::make_unique<PhysicalTexture>(resource.desc));
+      it = _physicalTextures.end() - 1;
+    }
+
+    auto& physical = **it;
+    physical.isOccupied = true;
+    physical.busyUntil = resource.lastPass;
+    physical.unusedFrames = 0;
+    resource.texture = &physical.View(resource.desc.format);
+  }
+
+  std::erase_if(_physicalTextures, [](const auto& physical)
+    {
+      return !physical->isOccupied && ++physical->unusedFrames > MAX_UNUSED_FRAMES;
+    });
+}
+
+uint32_t RenderGraph::GetBarriers(const Pass& pass, uint32_t passStamp)
+{
+  // glMemoryBarrier is global, so a bit only needs to be issued if a write since it was last issued needs it
+  GLbitfield barriers = 0;
+  for (const auto& access : pass.accesses)
+  {
+    const auto& resource = _resources[access.resource];
+    if (!resource.incoherentWrite)
+    {
+      continue;
+    }
+
+    for (GLbitfield bits = GetBarrierBits(access.access, resource.isBuffer); bits != 0; bits &= bits - 1)
+    {
+      const auto bit = std::countr_zero(bits);
+      if (_barrierStamps[bit] < resource.writeStamp)
+      {
+        barriers |= 1u << bit;
+      }
+    }
+  }
+
+  for (GLbitfield bits = barriers; bits != 0; bits &= bits - 1)
+  {
+    _barrierStamps[std::countr_zero(bits)] = passStamp;
+  }
+
+  // coherent overwrites make earlier writes irrelevant, but incoherent writes from this pass are only visible to barriers issued after it
+  for (const auto& access : pass.accesses)
+  {
+    if (access.mode == Mode::OVERWRITE && access.access != Access::STORAGE_WRITE)
+    {
+      _resources[access.resource].incoherentWrite = false;
+    }
+  }
+
+  for (const auto& access : pass.accesses)
+  {
+    if (access.access == Access::STORAGE_WRITE)
+    {
+      _resources[access.resource].incoherentWrite = true;
+      _resources[access.resource].writeStamp = passStamp + 1;
+    }
+  }
+
+  return barriers;
+}
+
+void RenderGraph::Execute()
+{
+  Cull();
+  AllocateTransients();
+
+  std::fill(std::begin(_barrierStamps), std::end(_barrierStamps), 0);
+  for (uint32_t p = 0; p < _passes.size(); p++)
+  {
+    const auto& pass = _passes[p];
+    if (!pass.alive)
+    {
+      continue;
+    }
+
+    std::optional<GpuProfiler::Zone> zone;
+    if (_profiler)
+    {
+      zone.emplace(_profiler, pass.name);
+    }
+
+    // barriers issued before pass p get stamp 2p + 2, writes made during it get 2p + 3.
+    // Writes made before the graph executed have stamp 1
+    if (const auto barriers = GetBarriers(pass, 2 * p + 2); barriers != 0)
+    {
+      glMemoryBarrier(barriers);
+    }
+    pass.execute(*this);
+  }
+
+  _passes.clear();
+  _resources.clear();
+  _resources.push_back({ .isOutput = true, .incoherentWrite = false });
+}
\ No newline at end of file
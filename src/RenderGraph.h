@@ -0,0 +1,167 @@
+#pragma once
+#include <Fwog/BasicTypes.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class GpuProfiler;
+
+namespace Fwog
+{
+  class Texture;
+  class Buffer;
+}
+
+// Records the passes of a frame and the resources they access, then runs them in the order they were added.
+// Passes that don't contribute to an output are culled, the memory barriers between passes are derived
+// from their declared accesses, and transient textures whose lifetimes don't overlap share storage.
+class RenderGraph
+{
+public:
+  // how a pass accesses a resource. Determines the barrier that is needed to see incoherent writes from earlier passes
+  enum class Access
+  {
+    SAMPLED,        // texture fetch
+    STORAGE_READ,   // imageLoad or storage buffer read
+    STORAGE_WRITE,  // imageStore, storage buffer write or atomics. Incoherent
+    ATTACHMENT,     // color attachment, including blending
+    INDIRECT,       // indirect dispatch or draw arguments
+    UNIFORM,
+    TRANSFER_READ,  // blit or copy source
+    TRANSFER_WRITE, // clear, blit or copy destination
+  };
+
+  struct TextureDesc
+  {
+    Fwog::Extent2D extent;
+    Fwog::Format format;
+    uint32_t mipLevels = 1;
+  };
+
+  struct TextureHandle
+  {
+    uint32_t index;
+  };
+
+  struct BufferHandle
+  {
+    uint32_t index;
+  };
+
+  using ExecuteFn = std::function<void(const RenderGraph&)>;
+
+  class PassBuilder
+  {
+  public:
+    PassBuilder& Read(TextureHandle texture, Access access);
+    PassBuilder& Read(BufferHandle buffer, Access access);
+
+    // the previous contents are kept, so earlier writers stay alive if this pass does
+    PassBuilder& Write(TextureHandle texture, Access access);
+    PassBuilder& Write(BufferHandle buffer, Access access);
+
+    // the previous contents are discarded
+    PassBuilder& Overwrite(TextureHandle texture, Access access);
+    PassBuilder& Overwrite(BufferHandle buffer, Access access);
+
+  private:
+    friend class RenderGraph;
+    PassBuilder(RenderGraph* graph, uint32_t pass) : _graph(graph), _pass(pass) {}
+
+    RenderGraph* _graph;
+    uint32_t _pass;
+  };
+
+  // every pass is timed in a scope with its name if profiler isn't null
+  explicit RenderGraph(GpuProfiler* profiler = nullptr);
+  ~RenderGraph();
+
+  RenderGraph(const RenderGraph&) = delete;
+  RenderGraph& operator=(const RenderGraph&) = delete;
+
+  // Textures that only live for part of a frame. Their contents are undefined when first accessed.
+  // They may share storage with other transient textures of the same size and texel size.
+  [[nodiscard]] TextureHandle CreateTexture(const TextureDesc& desc);
+
+  // Resources that outlive the frame. Importing a resource again returns the same handle.
+  // Imported resources are assumed to have pending incoherent writes.
+  [[nodiscard]] TextureHandle ImportTexture(Fwog::Texture& texture);
+  [[nodiscard]] BufferHandle ImportBuffer(const Fwog::Buffer& buffer);
+
+  // Writing to this keeps a pass alive
+  [[nodiscard]] TextureHandle Swapchain() const { return { 0 }; }
+
+  // Keeps the passes that write to texture alive even if nothing reads it
+  void MarkOutput(TextureHandle texture);
+
+  // Passes run in the order they were added. Accesses must be declared before Execute is called.
+  PassBuilder AddPass(std::string_view name, ExecuteFn execute);
+
+  // Only valid while the graph is executing
+  [[nodiscard]] Fwog::Texture& GetTexture(TextureHandle texture) const;
+  [[nodiscard]] const Fwog::Buffer& GetBuffer(BufferHandle buffer) const;
+
+  // Runs every pass that isn't culled, then forgets all passes and resources.
+  // Storage for transient textures is kept for the next frame.
+  void Execute();
+
+  [[nodiscard]] uint32_t NumCulledPasses() const { return _numCulledPasses; }
+
+private:
+  enum class Mode
+  {
+    READ,
+    WRITE,
+    OVERWRITE,
+  };
+
+  struct ResourceAccess
+  {
+    uint32_t resource;
+    Access access;
+    Mode mode;
+  };
+
+  struct Pass
+  {
+    std::string name;
+    ExecuteFn execute;
+    std::vector<ResourceAccess> accesses;
+    bool alive = false;
+  };
+
+  struct Resource
+  {
+    bool isBuffer = false;
+    bool isOutput = false;
+    bool isTransient = false;
+    Fwog::Texture* texture = nullptr;
+    const Fwog::Buffer* buffer = nullptr;
+    TextureDesc desc{};
+    uint32_t firstPass = UINT32_MAX;
+    uint32_t lastPass = 0;
+
+    // incoherent writes that happened before the graph executed are assumed
+    bool incoherentWrite = true;
+    uint32_t writeStamp = 1;
+  };
+
+  struct PhysicalTexture;
+
+  void AddAccess(uint32_t pass, uint32_t resource, Access access, Mode mode);
+  void Cull();
+  void AllocateTransients();
+  uint32_t GetBarriers(const Pass& pass, uint32_t passStamp);
+
+  GpuProfiler* _profiler;
+  std::vector<Pass> _passes;
+  std::vector<Resource> _resources;
+  std::vector<std::unique_ptr<PhysicalTexture>> _physicalTextures;
+
+  // when each barrier bit was last issued. Writes with a later stamp aren't visible to that kind of access yet
+  uint32_t _barrierStamps[32]{};
+  uint32_t _numCulledPasses = 0;
+};
\ No newline at end of file
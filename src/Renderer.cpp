@@ -1,20 +1,27 @@
 #include "Renderer.h"
 #include "GAssert.h"
-#include "utils/LoadFile.h"
+#include "GpuProfiler.h"
+#include "TransientUploadAllocator.h"
+#include "DynamicResolution.h"
+#include "PipelineCache.h"
+#include "utils/RadixSort.h"
 #include <Fwog/Rendering.h>
 #include <Fwog/Pipeline.h>
 #include <Fwog/Texture.h>
 #include <Fwog/Buffer.h>
-#include <Fwog/Shader.h>
 #include <glad/gl.h>
 #include <GLFW/glfw3.h>
 #include <stdexcept>
 #include <iostream>
 #include <sstream>
 #include <algorithm>
-#include <execution>
 #include <atomic>
 #include <vector>
+#include <optional>
+#include <functional>
+#include <array>
+#include <string_view>
+#include <utility>
 
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -105,13 +112,60 @@ namespace
   }
 
   constexpr std::uint32_t CIRCLE_SEGMENTS = 50;
+
+  // keep in sync with BinParticles.comp.glsl and RenderParticlesTiled.comp.glsl
+  constexpr uint32_t PARTICLE_TILE_SIZE = 16;
+
+  // keep in sync with DownsampleChain.comp.glsl
+  constexpr uint32_t BLOOM_TILE_SIZE = 16;
+  constexpr uint32_t BLOOM_MAX_LEVELS = 8;
+
+  // every sprite texture gets a layer of one array texture
+  constexpr uint32_t SPRITE_TEXTURE_SIZE = 256;
+  constexpr uint32_t MAX_SPRITE_TEXTURES = 64;
+
+  constexpr uint32_t BLOOM_PASSES = 6;
+  constexpr float BLOOM_STRENGTH = 1.0f / 64.0f;
+  constexpr float BLOOM_WIDTH = 1.0f;
+
+  // the part of an allocated image that is rendered to, in UV space
+  glm::vec2 RegionScale(Fwog::Extent2D used, Fwog::Extent2D allocated)
+  {
+    return glm::vec2(used.width, used.height) / glm::vec2(allocated.width, allocated.height);
+  }
+
+  Fwog::SamplerState MakeBloomSamplerState()
+  {
+    Fwog::SamplerState samplerState;
+    samplerState.minFilter = Fwog::Filter::LINEAR;
+    samplerState.magFilter = Fwog::Filter::LINEAR;
+    samplerState.mipmapFilter = Fwog::Filter::NEAREST;
+    samplerState.addressModeU = Fwog::AddressMode::MIRRORED_REPEAT;
+    samplerState.addressModeV = Fwog::AddressMode::MIRRORED_REPEAT;
+    return samplerState;
+  }
+
+  bool HasExtension(std::string_view name)
+  {
+    GLint numExtensions{};
+    glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+    for (GLint i = 0; i < numExtensions; i++)
+    {
+      if (name == reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i)))
+      {
+        return true;
+      }
+    }
+    return false;
+  }
 }
 
-struct SpriteUniforms
+static_assert(sizeof(SpriteInstance) == 32, "SpriteInstance must match ObjectUniforms in QuadBatched.vert.glsl");
+
+struct SpriteDrawUniforms
 {
-  glm::mat3x2 transform;
-  glm::u8vec4 tint4x8;
-  glm::uint _padding;
+  uint32_t useDrawOrder;
+  uint32_t _padding[3];
 };
 
 struct PrimitiveUniforms
@@ -125,11 +179,36 @@ struct FrameUniforms
   glm::mat4 viewProj;
 };
 
-struct BloomDownsampleUniforms
+struct ParticleTargetUniforms
+{
+  glm::ivec2 targetDim;
+  glm::ivec2 numTiles;
+};
+
+struct BloomLevelUniforms
 {
   glm::ivec2 sourceDim;
   glm::ivec2 targetDim;
-  float sourceLod;
+  glm::ivec2 numTiles;
+  uint32_t counterOffset;
+  uint32_t _padding;
+  glm::vec2 uvScale;
+  glm::vec2 _padding1;
+
+  bool operator==(const BloomLevelUniforms&) const = default;
+};
+
+// parameters of every level of the bloom chain, shared by DownsampleChain.comp.glsl and UpsampleComposite.comp.glsl
+struct BloomChainUniforms
+{
+  BloomLevelUniforms levels[BLOOM_MAX_LEVELS];
+  uint32_t numLevels;
+  float width;
+  glm::vec2 sourceUvScale;
+  uint32_t addParticles;
+  uint32_t _padding[3];
+
+  bool operator==(const BloomChainUniforms&) const = default;
 };
 
 struct BloomUpsampleUniforms
@@ -140,6 +219,21 @@ struct BloomUpsampleUniforms
   float strength;
   float sourceLod;
   float targetLod;
+  glm::vec2 sourceUvScale;
+
+  bool operator==(const BloomUpsampleUniforms&) const = default;
+};
+
+// for ResolveBloomTonemap.frag.glsl
+struct PresentUniforms
+{
+  glm::ivec2 renderDim;
+  glm::ivec2 windowDim;
+  glm::ivec2 bloomDim;
+  glm::vec2 bloomUvScale;
+  float bloomWidth;
+  float bloomStrength;
+  glm::vec2 _padding;
 };
 
 struct Renderer::Resources
@@ -149,12 +243,15 @@ struct Renderer::Resources
   {
     uint32_t width{};
     uint32_t height{};
-    Fwog::Texture output_ldr;
+
+    // Targets are allocated at the window's size, but only this much of them is rendered to.
+    // It's scaled up to the window when the final image is presented
+    Fwog::Extent2D renderExtent{};
     Fwog::Texture output_hdr;
-    Fwog::Texture output_hdr_scratch;
-    Fwog::Texture particle_hdr_r;
-    Fwog::Texture particle_hdr_g;
-    Fwog::Texture particle_hdr_b;
+    std::optional<Fwog::Buffer> particle_hdr_packed; // only exists if packed splatting is supported
+    glm::uvec2 particleTiles{};
+    std::optional<Fwog::Buffer> particleTileCounts;
+    std::optional<Fwog::Buffer> particleTileOffsets;
 
     float AspectRatio()
     {
@@ -166,15 +263,38 @@ struct Renderer::Resources
   Fwog::GraphicsPipeline backgroundPipeline;
   Fwog::GraphicsPipeline spritePipeline;
   Fwog::ComputePipeline particlePipeline;
+  Fwog::ComputePipeline writeDispatchArgsPipeline;
   Fwog::ComputePipeline tonemapPipeline;
   Fwog::GraphicsPipeline particleResolvePipeline;
+  Fwog::GraphicsPipeline resolveBloomTonemapPipeline;
+  Fwog::ComputePipeline particlePackedPipeline;
+  Fwog::GraphicsPipeline particlePackedResolvePipeline;
+  bool supportsPackedSplat = false;
+  Fwog::ComputePipeline particleBinPipeline;
+  Fwog::ComputePipeline particleScanTilesPipeline;
+  Fwog::ComputePipeline particleScatterPipeline;
+  Fwog::ComputePipeline particleTiledPipeline;
+
+  // per-particle scratch for the tiled splat, grown to fit the render index buffer
+  std::optional<Fwog::Buffer> particleKeysBuffer;
+  std::optional<Fwog::Buffer> particleSortedIndicesBuffer;
   Fwog::ComputePipeline bloomDownsampleLowPass;
-  Fwog::ComputePipeline bloomDownsample;
+  Fwog::ComputePipeline bloomDownsampleChain;
+  Fwog::ComputePipeline bloomUpsampleComposite;
   Fwog::ComputePipeline bloomUpsample;
-  Fwog::TypedBuffer<SpriteUniforms> spritesUniformsBuffer;
   Fwog::TypedBuffer<FrameUniforms> frameUniformsBuffer;
-  Fwog::TypedBuffer<BloomDownsampleUniforms> bloomDownsampleUniformBuffer;
+  Fwog::TypedBuffer<ParticleTargetUniforms> particleTargetUniformsBuffer;
+  Fwog::TypedBuffer<BloomChainUniforms> bloomChainUniformBuffer;
   Fwog::TypedBuffer<BloomUpsampleUniforms> bloomUpsampleUniformBuffer;
+  Fwog::Sampler bloomSampler;
+  Fwog::Sampler nearestSampler; // integer textures are incomplete with linear filtering
+  Fwog::Sampler backgroundSampler;
+
+  // bloom parameters only change with the target size and settings, so they're only uploaded when they do
+  std::optional<BloomChainUniforms> bloomChainUniforms;
+  std::optional<BloomUpsampleUniforms> bloomUpsampleUniforms;
+  std::optional<Fwog::Buffer> bloomCountersBuffer;
+  Fwog::Buffer particleDispatchArgsBuffer;
 
   // for drawing debug boxes and circles
   Fwog::GraphicsPipeline primitivePipeline;
@@ -183,6 +303,22 @@ struct Renderer::Resources
     
   // for drawing debug lines
   Fwog::GraphicsPipeline linesPipeline;
+
+  // Debug lines and circles are drawn over the presented image. Present replaces the whole swapchain, so their passes
+  // are only added to the graph when the frame is submitted
+  std::vector<std::function<void()>> swapchainOverlays;
+
+  // created when the first sprite texture is added
+  std::optional<Fwog::Texture> spriteTextures;
+  uint32_t numSpriteTextures = 0;
+  Fwog::TypedBuffer<glm::vec2> spriteUvScaleBuffer;
+  Fwog::Sampler spriteSampler;
+
+  // the open sprite batch
+  std::optional<TransientUploadAllocator::Allocation> spriteInstances;
+  std::vector<int16_t> spriteDrawOrders;
+  std::vector<uint64_t> spriteSortKeys;
+  RadixSorter spriteSorter;
 };
 
 Renderer::Renderer(GLFWwindow* window)
@@ -193,12 +329,9 @@ Renderer::Renderer(GLFWwindow* window)
     throw std::runtime_error("Failed to initialize OpenGL");
   }
 
-  // Hack to make everything not bug out in release mode.
-  // I have hardly a clue as to why enabling synchronous output fixes my bugs.
-  // I guess I have UB somewhere that relies on the NV driver operating in this mode.
+#ifndef NDEBUG
   glEnable(GL_DEBUG_OUTPUT);
   glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
-#ifndef NDEBUG
   glDebugMessageCallback(glErrorCallback, nullptr);
   glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
 #endif
@@ -215,18 +348,19 @@ Renderer::Renderer(GLFWwindow* window)
     {
       .frame = {.width = framebufferWidth,
                 .height = framebufferHeight,
-                .output_ldr = Fwog::CreateTexture2D({framebufferWidth, framebufferHeight}, Fwog::Format::R8G8B8A8_UNORM, "output_ldr"),
-                .output_hdr = Fwog::CreateTexture2DMip({framebufferWidth, framebufferHeight}, Fwog::Format::R16G16B16A16_FLOAT, 8, "output_hdr"),
-                .output_hdr_scratch = Fwog::CreateTexture2DMip({framebufferWidth / 2, framebufferHeight / 2}, Fwog::Format::R16G16B16A16_FLOAT, 8, "output_hdr_scratch"),
-                .particle_hdr_r = Fwog::CreateTexture2D({framebufferWidth, framebufferHeight}, Fwog::Format::R32_UINT),
-                .particle_hdr_g = Fwog::CreateTexture2D({framebufferWidth, framebufferHeight}, Fwog::Format::R32_UINT),
-                .particle_hdr_b = Fwog::CreateTexture2D({framebufferWidth, framebufferHeight}, Fwog::Format::R32_UINT) },
-      .spritesUniformsBuffer = Fwog::TypedBuffer<SpriteUniforms>(1024, Fwog::BufferStorageFlag::DYNAMIC_STORAGE),
+                .output_hdr = Fwog::CreateTexture2DMip({framebufferWidth, framebufferHeight}, Fwog::Format::R16G16B16A16_FLOAT, 8, "output_hdr") },
       .frameUniformsBuffer = Fwog::TypedBuffer<FrameUniforms>(Fwog::BufferStorageFlag::DYNAMIC_STORAGE),
-      .bloomDownsampleUniformBuffer = Fwog::TypedBuffer<BloomDownsampleUniforms>(Fwog::BufferStorageFlag::DYNAMIC_STORAGE),
+      .particleTargetUniformsBuffer = Fwog::TypedBuffer<ParticleTargetUniforms>(Fwog::BufferStorageFlag::DYNAMIC_STORAGE),
+      .bloomChainUniformBuffer = Fwog::TypedBuffer<BloomChainUniforms>(Fwog::BufferStorageFlag::DYNAMIC_STORAGE),
       .bloomUpsampleUniformBuffer = Fwog::TypedBuffer<BloomUpsampleUniforms>(Fwog::BufferStorageFlag::DYNAMIC_STORAGE),
+      .bloomSampler = Fwog::Sampler(MakeBloomSamplerState()),
+      .nearestSampler = Fwog::Sampler(Fwog::SamplerState{ .minFilter = Fwog::Filter::NEAREST, .magFilter = Fwog::Filter::NEAREST }),
+      .backgroundSampler = Fwog::Sampler(Fwog::SamplerState{}),
+      .particleDispatchArgsBuffer = Fwog::Buffer(sizeof(uint32_t) * 3),
       .boxVertexBuffer = Fwog::TypedBuffer<glm::vec2>(MakeBoxVertices()),
       .circleVertexBuffer = Fwog::TypedBuffer<glm::vec2>(MakeCircleVertices(CIRCLE_SEGMENTS)),
+      .spriteUvScaleBuffer = Fwog::TypedBuffer<glm::vec2>(MAX_SPRITE_TEXTURES, Fwog::BufferStorageFlag::DYNAMIC_STORAGE),
+      .spriteSampler = Fwog::Sampler(Fwog::SamplerState{ .minFilter = Fwog::Filter::LINEAR, .magFilter = Fwog::Filter::LINEAR }),
     });
 
   auto view = glm::mat4(1);
@@ -234,18 +368,11 @@ Renderer::Renderer(GLFWwindow* window)
   auto viewproj = proj * view;
   _resources->frameUniformsBuffer.SubDataTyped({ viewproj });
 
-  auto quad_vs = Fwog::Shader(Fwog::PipelineStage::VERTEX_SHADER, LoadFile("assets/shaders/QuadBatched.vert.glsl"));
-  auto bg_vs = Fwog::Shader(Fwog::PipelineStage::VERTEX_SHADER, LoadFile("assets/shaders/FullScreenTri.vert.glsl"));
-  auto tex_fs = Fwog::Shader(Fwog::PipelineStage::FRAGMENT_SHADER, LoadFile("assets/shaders/Texture.frag.glsl"));
-  _resources->spritePipeline = Fwog::CompileGraphicsPipeline({ 
-    .vertexShader = &quad_vs, 
-    .fragmentShader = &tex_fs,
-    .inputAssemblyState = {.topology = Fwog::PrimitiveTopology::TRIANGLE_FAN }
-  });
-  _resources->backgroundPipeline = Fwog::CompileGraphicsPipeline({ .vertexShader = &bg_vs, .fragmentShader = &tex_fs });
-
-  // debug pipelines
-  auto simpleColor_fs = Fwog::Shader(Fwog::PipelineStage::FRAGMENT_SHADER, LoadFile("assets/shaders/SimpleColor.frag.glsl"));
+  // sized for the full resolution so they fit any render scale
+  const auto maxParticleTiles = (glm::uvec2(framebufferWidth, framebufferHeight) + PARTICLE_TILE_SIZE - 1u) / PARTICLE_TILE_SIZE;
+  _resources->frame.particleTileCounts.emplace(sizeof(uint32_t) * maxParticleTiles.x * maxParticleTiles.y);
+  _resources->frame.particleTileOffsets.emplace(sizeof(uint32_t) * maxParticleTiles.x * maxParticleTiles.y);
+  SetRenderScale(1.0f);
 
   auto colorBlend = Fwog::ColorBlendAttachmentState
   {
@@ -254,7 +381,14 @@ Renderer::Renderer(GLFWwindow* window)
     .dstColorBlendFactor = Fwog::BlendFactor::ONE_MINUS_SRC_ALPHA,
   };
 
-  auto lines_vs = Fwog::Shader(Fwog::PipelineStage::VERTEX_SHADER, LoadFile("assets/shaders/LinesBatched.vert.glsl"));
+  auto pipelines = PipelineCache();
+  _resources->spritePipeline = pipelines.AddGraphics("assets/shaders/QuadBatched.vert.glsl", "assets/shaders/QuadBatched.frag.glsl", {
+    .inputAssemblyState = {.topology = Fwog::PrimitiveTopology::TRIANGLE_FAN },
+    .colorBlendState = {.attachments = std::span(&colorBlend, 1) }
+  });
+  _resources->backgroundPipeline = pipelines.AddGraphics("assets/shaders/FullScreenTri.vert.glsl", "assets/shaders/Texture.frag.glsl", {});
+
+  // debug pipelines
   auto linePosDesc = Fwog::VertexInputBindingDescription
   {
     .location = 0,
@@ -271,25 +405,20 @@ Renderer::Renderer(GLFWwindow* window)
   };
   auto lineInputDescs = { linePosDesc, lineColorDesc };
 
-  _resources->linesPipeline = Fwog::CompileGraphicsPipeline({
-    .vertexShader = &lines_vs,
-    .fragmentShader = &simpleColor_fs,
+  _resources->linesPipeline = pipelines.AddGraphics("assets/shaders/LinesBatched.vert.glsl", "assets/shaders/SimpleColor.frag.glsl", {
     .inputAssemblyState = {.topology = Fwog::PrimitiveTopology::LINE_LIST },
     .vertexInputState = { lineInputDescs },
     //.colorBlendState = {.attachments = std::span(&colorBlend, 1) }
   });
 
-  auto primitive_vs = Fwog::Shader(Fwog::PipelineStage::VERTEX_SHADER, LoadFile("assets/shaders/PrimitiveBatched.vert.glsl"));
-  _resources->primitivePipeline = Fwog::CompileGraphicsPipeline({
-    .vertexShader = &primitive_vs,
-    .fragmentShader = &simpleColor_fs,
+  _resources->primitivePipeline = pipelines.AddGraphics("assets/shaders/PrimitiveBatched.vert.glsl", "assets/shaders/SimpleColor.frag.glsl", {
     .inputAssemblyState = {.topology = Fwog::PrimitiveTopology::LINE_STRIP },
     .vertexInputState = { std::span(&linePosDesc, 1) },
     //.colorBlendState = { .attachments = std::span(&colorBlend, 1) }
   });
 
-  auto particle_cs = Fwog::Shader(Fwog::PipelineStage::COMPUTE_SHADER, LoadFile("assets/shaders/particles/RenderParticles.comp.glsl"));
-  _resources->particlePipeline = Fwog::CompileComputePipeline({ .shader = &particle_cs });
+  _resources->particlePipeline = pipelines.AddCompute("assets/shaders/particles/RenderParticles.comp.glsl");
+  _resources->writeDispatchArgsPipeline = pipelines.AddCompute("assets/shaders/particles/WriteDispatchArgs.comp.glsl");
 
   auto colorBlendParticle = Fwog::ColorBlendAttachmentState
   {
@@ -297,24 +426,39 @@ Renderer::Renderer(GLFWwindow* window)
     .srcColorBlendFactor = Fwog::BlendFactor::ONE,
     .dstColorBlendFactor = Fwog::BlendFactor::ONE,
   };
-  auto particle_resolve_fs = Fwog::Shader(Fwog::PipelineStage::FRAGMENT_SHADER, LoadFile("assets/shaders/particles/ResolveParticleImage.frag.glsl"));
-  _resources->particleResolvePipeline = Fwog::CompileGraphicsPipeline({
-    .vertexShader = &bg_vs,
-    .fragmentShader = &particle_resolve_fs,
+  _resources->particleResolvePipeline = pipelines.AddGraphics("assets/shaders/FullScreenTri.vert.glsl", "assets/shaders/particles/ResolveParticleImage.frag.glsl", {
     .colorBlendState = { .attachments = std::span(&colorBlendParticle, 1) }
   });
 
-  auto tonemap_cs = Fwog::Shader(Fwog::PipelineStage::COMPUTE_SHADER, LoadFile("assets/shaders/bloom/TonemapAndDither.comp.glsl"));
-  _resources->tonemapPipeline = Fwog::CompileComputePipeline({ .shader = &tonemap_cs });
-  
-  auto bloom_downsampleLowPass_cs = Fwog::Shader(Fwog::PipelineStage::COMPUTE_SHADER, LoadFile("assets/shaders/bloom/DownsampleLowPass.comp.glsl"));
-  _resources->bloomDownsampleLowPass = Fwog::CompileComputePipeline({ .shader = &bloom_downsampleLowPass_cs });
+  _resources->particleBinPipeline = pipelines.AddCompute("assets/shaders/particles/BinParticles.comp.glsl");
+  _resources->particleScanTilesPipeline = pipelines.AddCompute("assets/shaders/particles/ScanTiles.comp.glsl");
+  _resources->particleScatterPipeline = pipelines.AddCompute("assets/shaders/particles/ScatterParticles.comp.glsl");
+  _resources->particleTiledPipeline = pipelines.AddCompute("assets/shaders/particles/RenderParticlesTiled.comp.glsl");
+
+  // 64-bit buffer atomics aren't core, so keep the three-image path around as a fallback
+  _resources->supportsPackedSplat = HasExtension("GL_NV_shader_atomic_int64") && HasExtension("GL_ARB_gpu_shader_int64");
+  if (_resources->supportsPackedSplat)
+  {
+    _resources->frame.particle_hdr_packed.emplace(sizeof(uint64_t) * framebufferWidth * framebufferHeight);
 
-  auto bloom_downsample_cs = Fwog::Shader(Fwog::PipelineStage::COMPUTE_SHADER, LoadFile("assets/shaders/bloom/Downsample.comp.glsl"));
-  _resources->bloomDownsample = Fwog::CompileComputePipeline({ .shader = &bloom_downsample_cs });
+    _resources->particlePackedPipeline = pipelines.AddCompute("assets/shaders/particles/RenderParticlesPacked.comp.glsl");
+    _resources->particlePackedResolvePipeline = pipelines.AddGraphics("assets/shaders/FullScreenTri.vert.glsl", "assets/shaders/particles/ResolveParticlePacked.frag.glsl", {
+      .colorBlendState = { .attachments = std::span(&colorBlendParticle, 1) }
+    });
+  }
 
-  auto bloom_upsample_cs = Fwog::Shader(Fwog::PipelineStage::COMPUTE_SHADER, LoadFile("assets/shaders/bloom/Upsample.comp.glsl"));
-  _resources->bloomUpsample = Fwog::CompileComputePipeline({ .shader = &bloom_upsample_cs });
+  _resources->resolveBloomTonemapPipeline = pipelines.AddGraphics("assets/shaders/FullScreenTri.vert.glsl", "assets/shaders/bloom/ResolveBloomTonemap.frag.glsl", {});
+  _resources->tonemapPipeline = pipelines.AddCompute("assets/shaders/bloom/TonemapAndDither.comp.glsl");
+  _resources->bloomDownsampleLowPass = pipelines.AddCompute("assets/shaders/bloom/DownsampleLowPass.comp.glsl");
+  _resources->bloomDownsampleChain = pipelines.AddCompute("assets/shaders/bloom/DownsampleChain.comp.glsl");
+  _resources->bloomUpsampleComposite = pipelines.AddCompute("assets/shaders/bloom/UpsampleComposite.comp.glsl");
+  _resources->bloomUpsample = pipelines.AddCompute("assets/shaders/bloom/Upsample.comp.glsl");
+  pipelines.Build();
+
+  _profiler = std::make_unique<GpuProfiler>();
+  _uploads = std::make_unique<TransientUploadAllocator>();
+  _graph = std::make_unique<RenderGraph>(_profiler.get());
+  _dynamicResolution = std::make_unique<DynamicResolution>();
 }
 
 Renderer::~Renderer()
@@ -322,197 +466,366 @@ Renderer::~Renderer()
   delete _resources;
 }
 
-void Renderer::ApplyBloom(const Fwog::Texture& target, uint32_t passes, float strength, float width, const Fwog::Texture& scratchTexture)
+bool Renderer::SupportsParticleSplatMode(ParticleSplatMode mode) const
 {
-  G_ASSERT_MSG(target.Extent().width >> passes > 0 && target.Extent().height >> passes > 0, "Bloom target is too small");
-
-  Fwog::SamplerState samplerState;
-  samplerState.minFilter = Fwog::Filter::LINEAR;
-  samplerState.magFilter = Fwog::Filter::LINEAR;
-  samplerState.mipmapFilter = Fwog::Filter::NEAREST;
-  samplerState.addressModeU = Fwog::AddressMode::MIRRORED_REPEAT;
-  samplerState.addressModeV = Fwog::AddressMode::MIRRORED_REPEAT;
-  auto sampler = Fwog::Sampler(samplerState);
-
-  Fwog::BeginCompute("Bloom");
-  Fwog::Cmd::BindUniformBuffer(0, _resources->bloomDownsampleUniformBuffer, 0, _resources->bloomDownsampleUniformBuffer.Size());
-  const int local_size = 16;
-  for (uint32_t i = 0; i < passes; i++)
+  switch (mode)
   {
-    Fwog::Extent2D sourceDim{};
-    Fwog::Extent2D targetDim = target.Extent() >> (i + 1);
-    float sourceLod{};
+  case ParticleSplatMode::SEPARATE: return true;
+  case ParticleSplatMode::PACKED_INT64: return _resources->supportsPackedSplat;
+  case ParticleSplatMode::TILED: return true;
+  default: return false;
+  }
+}
 
-    const Fwog::Texture* sourceTex = nullptr;
+float Renderer::RenderScale() const
+{
+  return static_cast<float>(_resources->frame.renderExtent.width) / _resources->frame.width;
+}
 
-    // first pass, use downsampling with low-pass filter
-    if (i == 0)
-    {
-      // the low pass filter prevents single pixels/thin lines from being bright
-      //Fwog::Cmd::BindComputePipeline(_resources->bloomDownsampleLowPass);
-      Fwog::Cmd::BindComputePipeline(_resources->bloomDownsample);
+void Renderer::SetRenderScale(float scale)
+{
+  auto& frame = _resources->frame;
 
-      sourceLod = 0;
-      sourceTex = &target;
-      sourceDim = { target.Extent().width, target.Extent().height };
-    }
-    else
-    {
-      Fwog::Cmd::BindComputePipeline(_resources->bloomDownsample);
+  // every level of the bloom chain needs at least one pixel
+  const auto minDim = 1u << BLOOM_MAX_LEVELS;
+  const auto renderExtent = Fwog::Extent2D
+  {
+    std::clamp(static_cast<uint32_t>(frame.width * scale), std::min(minDim, frame.width), frame.width),
+    std::clamp(static_cast<uint32_t>(frame.height * scale), std::min(minDim, frame.height), frame.height),
+  };
 
-      sourceLod = static_cast<float>(i - 1);
-      sourceTex = &scratchTexture;
-      sourceDim = target.Extent() >> i;
-    }
+  if (renderExtent.width == frame.renderExtent.width && renderExtent.height == frame.renderExtent.height)
+  {
+    return;
+  }
+
+  frame.renderExtent = renderExtent;
+  frame.particleTiles = (glm::uvec2(renderExtent.width, renderExtent.height) + PARTICLE_TILE_SIZE - 1u) / PARTICLE_TILE_SIZE;
+  _resources->particleTargetUniformsBuffer.SubDataTyped({ glm::ivec2(renderExtent.width, renderExtent.height), glm::ivec2(frame.particleTiles) });
+}
+
+void Renderer::BeginFrame()
+{
+  _profiler->BeginFrame();
+
+  if (enableDynamicResolution)
+  {
+    SetRenderScale(_dynamicResolution->Update(_profiler->GetLastFrameTimeMs(), gpuFrameBudgetMs));
+  }
+  else
+  {
+    _dynamicResolution->Reset();
+    SetRenderScale(1.0f);
+  }
 
-    Fwog::Cmd::BindSampledImage(0, *sourceTex, sampler);
-    Fwog::Cmd::BindImage(0, scratchTexture, i);
+  // cleared first so anything can draw into it during the frame
+  ClearHDR();
+}
+
+void Renderer::EndFrame()
+{
+  _profiler->EndFrame();
+  _uploads->EndFrame();
+}
+
+
+void Renderer::SubmitFrame()
+{
+  for (const auto& addPass : _resources->swapchainOverlays)
+  {
+    addPass();
+  }
+  _resources->swapchainOverlays.clear();
+
+  _graph->Execute();
+}
+
+void Renderer::BuildBloomChain(RenderGraph::TextureHandle source,
+                               uint32_t passes,
+                               float width,
+                               RenderGraph::TextureHandle scratchTexture,
+                               std::span<const RenderGraph::TextureHandle> particleImages)
+{
+  // the chain only covers the rendered part of the source and of each mip of scratchTexture
+  const Fwog::Extent2D targetDim = _resources->frame.renderExtent;
+  const Fwog::Extent2D allocatedDim = { _resources->frame.width, _resources->frame.height };
+
+  G_ASSERT_MSG(targetDim.width >> passes > 0 && targetDim.height >> passes > 0, "Bloom target is too small");
+  G_ASSERT(passes > 0 && passes <= BLOOM_MAX_LEVELS);
+  G_ASSERT(particleImages.empty() || particleImages.size() == 3);
 
-    BloomDownsampleUniforms uniforms
+  // level i of the chain is mip i of scratchTexture, which is half the size of the level before it
+  BloomChainUniforms chainUniforms
+  {
+    .numLevels = passes,
+    .width = width,
+    .sourceUvScale = RegionScale(targetDim, allocatedDim),
+    .addParticles = !particleImages.empty(),
+  };
+  uint32_t numCounters = 0;
+  for (uint32_t i = 0; i < passes; i++)
+  {
+    Fwog::Extent2D sourceDim = targetDim >> i;
+    Fwog::Extent2D levelDim = targetDim >> (i + 1);
+    Fwog::Extent2D numTiles = (levelDim + BLOOM_TILE_SIZE - 1) / BLOOM_TILE_SIZE;
+    chainUniforms.levels[i] = BloomLevelUniforms
     {
       .sourceDim = { sourceDim.width, sourceDim.height },
-      .targetDim = { targetDim.width, targetDim.height },
-      .sourceLod = sourceLod
+      .targetDim = { levelDim.width, levelDim.height },
+      .numTiles = { numTiles.width, numTiles.height },
+      .counterOffset = numCounters,
+      .uvScale = RegionScale(levelDim, allocatedDim >> (i + 1)),
     };
-    _resources->bloomDownsampleUniformBuffer.SubDataTyped(uniforms);
 
-    Fwog::Cmd::MemoryBarrier(Fwog::MemoryBarrierAccessBit::TEXTURE_FETCH_BIT | Fwog::MemoryBarrierAccessBit::IMAGE_ACCESS_BIT);
-    auto workgroups = (targetDim + local_size - 1) / local_size;
-    Fwog::Cmd::Dispatch(workgroups.width, workgroups.height, 1);
+    // tiles of the first level don't wait for anything
+    if (i > 0)
+    {
+      numCounters += numTiles.width * numTiles.height;
+    }
+  }
+
+  if (_resources->bloomChainUniforms != chainUniforms)
+  {
+    _resources->bloomChainUniformBuffer.SubDataTyped(chainUniforms);
+    _resources->bloomChainUniforms = chainUniforms;
   }
 
-  Fwog::Cmd::BindComputePipeline(_resources->bloomUpsample);
-  Fwog::Cmd::BindUniformBuffer(0, _resources->bloomUpsampleUniformBuffer, 0, _resources->bloomUpsampleUniformBuffer.Size());
-  for (int32_t i = passes - 1; i >= 0; i--)
+  const size_t countersSize = std::max<size_t>(numCounters, 1) * sizeof(uint32_t);
+  if (!_resources->bloomCountersBuffer || _resources->bloomCountersBuffer->Size() < countersSize)
   {
-    Fwog::Extent2D sourceDim = target.Extent() >> (i + 1);
-    Fwog::Extent2D targetDim{};
-    const Fwog::Texture* targetTex = nullptr;
-    float realStrength = 1.0f;
-    uint32_t targetLod{};
+    _resources->bloomCountersBuffer.emplace(countersSize);
+  }
+  auto counters = _graph->ImportBuffer(*_resources->bloomCountersBuffer);
 
-    // final pass
-    if (i == 0)
+  // downsample every level in one dispatch
+  const auto firstLevelTiles = chainUniforms.levels[0].numTiles;
+  auto downsample = _graph->AddPass("Bloom downsample", [this, source, scratchTexture, particleImages = std::vector(particleImages.begin(), particleImages.end()), countersSize, passes, firstLevelTiles](const RenderGraph& graph)
     {
-      realStrength = strength;
-      targetLod = 0;
-      targetTex = &target;
-      targetDim = target.Extent();
-    }
-    else
+      constexpr uint32_t zero = 0;
+      auto& counterBuffer = *_resources->bloomCountersBuffer;
+      counterBuffer.ClearSubData(0, countersSize, Fwog::Format::R32_UINT, Fwog::UploadFormat::R_INTEGER, Fwog::UploadType::UINT, &zero);
+
+      Fwog::BeginCompute("Bloom downsample");
+      Fwog::Cmd::BindComputePipeline(_resources->bloomDownsampleChain);
+      Fwog::Cmd::BindUniformBuffer(0, _resources->bloomChainUniformBuffer, 0, _resources->bloomChainUniformBuffer.Size());
+      Fwog::Cmd::BindStorageBuffer(0, counterBuffer, 0, countersSize);
+      Fwog::Cmd::BindSampledImage(0, graph.GetTexture(source), _resources->bloomSampler);
+      for (uint32_t i = 0; i < particleImages.size(); i++)
+      {
+        Fwog::Cmd::BindSampledImage(1 + i, graph.GetTexture(particleImages[i]), _resources->nearestSampler);
+      }
+      for (uint32_t i = 0; i < passes; i++)
+      {
+        Fwog::Cmd::BindImage(i, graph.GetTexture(scratchTexture), i);
+      }
+      Fwog::Cmd::Dispatch(firstLevelTiles.x, firstLevelTiles.y, 1);
+      Fwog::EndCompute();
+    })
+    .Read(source, RenderGraph::Access::SAMPLED)
+    .Overwrite(scratchTexture, RenderGraph::Access::STORAGE_WRITE)
+    .Overwrite(counters, RenderGraph::Access::TRANSFER_WRITE)
+    .Write(counters, RenderGraph::Access::STORAGE_WRITE);
+  for (auto image : particleImages)
+  {
+    downsample.Read(image, RenderGraph::Access::SAMPLED);
+  }
+
+  // add the smaller levels to the first
+  const Fwog::Extent2D scratchDim = targetDim >> 1;
+  _graph->AddPass("Bloom composite", [this, scratchTexture, scratchDim](const RenderGraph& graph)
     {
-      targetLod = i - 1;
-      targetTex = &scratchTexture;
-      targetDim = target.Extent() >> i;
-    }
+      const auto& scratch = graph.GetTexture(scratchTexture);
+      Fwog::BeginCompute("Bloom composite");
+      Fwog::Cmd::BindComputePipeline(_resources->bloomUpsampleComposite);
+      Fwog::Cmd::BindUniformBuffer(0, _resources->bloomChainUniformBuffer, 0, _resources->bloomChainUniformBuffer.Size());
+      Fwog::Cmd::BindSampledImage(0, scratch, _resources->bloomSampler);
+      Fwog::Cmd::BindImage(0, scratch, 0);
+      auto workgroups = (scratchDim + BLOOM_TILE_SIZE - 1) / BLOOM_TILE_SIZE;
+      Fwog::Cmd::Dispatch(workgroups.width, workgroups.height, 1);
+      Fwog::EndCompute();
+    })
+    .Read(scratchTexture, RenderGraph::Access::SAMPLED)
+    .Write(scratchTexture, RenderGraph::Access::STORAGE_WRITE);
+}
 
-    Fwog::Cmd::BindSampledImage(0, scratchTexture, sampler);
-    Fwog::Cmd::BindSampledImage(1, *targetTex, sampler);
-    Fwog::Cmd::BindImage(0, *targetTex, targetLod);
+void Renderer::ApplyBloom(RenderGraph::TextureHandle target, uint32_t passes, float strength, float width, RenderGraph::TextureHandle scratchTexture)
+{
+  BuildBloomChain(target, passes, width, scratchTexture);
 
-    BloomUpsampleUniforms uniforms
-    {
-      .sourceDim = { sourceDim.width, sourceDim.height },
-      .targetDim = { targetDim.width, targetDim.height },
-      .width = width,
-      .strength = realStrength,
-      .sourceLod = static_cast<float>(i),
-      .targetLod = static_cast<float>(targetLod)
-    };
-    _resources->bloomUpsampleUniformBuffer.SubDataTyped(uniforms);
+  const Fwog::Extent2D targetDim = _resources->frame.renderExtent;
+  const Fwog::Extent2D allocatedDim = { _resources->frame.width, _resources->frame.height };
+  const Fwog::Extent2D scratchDim = targetDim >> 1;
+  BloomUpsampleUniforms upsampleUniforms
+  {
+    .sourceDim = { scratchDim.width, scratchDim.height },
+    .targetDim = { targetDim.width, targetDim.height },
+    .width = width,
+    .strength = strength,
+    .sourceLod = 0,
+    .targetLod = 0,
+    .sourceUvScale = RegionScale(scratchDim, allocatedDim >> 1),
+  };
 
-    auto workgroups = (targetDim + local_size - 1) / local_size;
-    Fwog::Cmd::MemoryBarrier(Fwog::MemoryBarrierAccessBit::TEXTURE_FETCH_BIT | Fwog::MemoryBarrierAccessBit::IMAGE_ACCESS_BIT);
-    Fwog::Cmd::Dispatch(workgroups.width, workgroups.height, 1);
+  if (_resources->bloomUpsampleUniforms != upsampleUniforms)
+  {
+    _resources->bloomUpsampleUniformBuffer.SubDataTyped(upsampleUniforms);
+    _resources->bloomUpsampleUniforms = upsampleUniforms;
   }
-  Fwog::EndCompute();
+
+  // add the first level of the chain to the target
+  _graph->AddPass("Bloom", [this, target, scratchTexture, targetDim](const RenderGraph& graph)
+    {
+      Fwog::BeginCompute("Bloom");
+      Fwog::Cmd::BindComputePipeline(_resources->bloomUpsample);
+      Fwog::Cmd::BindUniformBuffer(0, _resources->bloomUpsampleUniformBuffer, 0, _resources->bloomUpsampleUniformBuffer.Size());
+      Fwog::Cmd::BindSampledImage(0, graph.GetTexture(scratchTexture), _resources->bloomSampler);
+      Fwog::Cmd::BindSampledImage(1, graph.GetTexture(target), _resources->bloomSampler);
+      Fwog::Cmd::BindImage(0, graph.GetTexture(target), 0);
+      auto workgroups = (targetDim + BLOOM_TILE_SIZE - 1) / BLOOM_TILE_SIZE;
+      Fwog::Cmd::Dispatch(workgroups.width, workgroups.height, 1);
+      Fwog::EndCompute();
+    })
+    .Read(scratchTexture, RenderGraph::Access::SAMPLED)
+    .Read(target, RenderGraph::Access::SAMPLED)
+    .Write(target, RenderGraph::Access::STORAGE_WRITE);
 }
 
 void Renderer::DrawBackground(const Fwog::Texture& texture)
 {
   G_ASSERT(texture.CreateInfo().imageType == Fwog::ImageType::TEX_2D);
-  Fwog::BeginSwapchainRendering({ .viewport = {.drawRect = {.offset{}, .extent{_resources->frame.width, _resources->frame.height}}},
-                                  .clearColorOnLoad = true,
-                                  .clearColorValue = {.f = {.3f, .8f, .2f, 1.f}} });
-  Fwog::Cmd::BindGraphicsPipeline(_resources->backgroundPipeline);
-  Fwog::Cmd::BindSampledImage(0, texture, Fwog::Sampler(Fwog::SamplerState{}));
-  Fwog::Cmd::Draw(3, 1, 0, 0);
-  Fwog::EndRendering();
+
+  // like sprite textures, the background is never written on the GPU, so it isn't tracked by the graph
+  _graph->AddPass("Background", [this, &texture](const RenderGraph&)
+    {
+      Fwog::BeginSwapchainRendering({ .viewport = {.drawRect = {.offset{}, .extent{_resources->frame.width, _resources->frame.height}}},
+                                      .clearColorOnLoad = true,
+                                      .clearColorValue = {.f = {.3f, .8f, .2f, 1.f}} });
+      Fwog::Cmd::BindGraphicsPipeline(_resources->backgroundPipeline);
+      Fwog::Cmd::BindSampledImage(0, texture, _resources->backgroundSampler);
+      Fwog::Cmd::Draw(3, 1, 0, 0);
+      Fwog::EndRendering();
+    })
+    .Overwrite(_graph->Swapchain(), RenderGraph::Access::ATTACHMENT);
 }
 
-void Renderer::DrawSprites(std::vector<RenderableSprite> sprites)
+uint32_t Renderer::AddSpriteTexture(const void* pixels, uint32_t width, uint32_t height)
 {
-  if (sprites.empty())
+  G_ASSERT_MSG(width <= SPRITE_TEXTURE_SIZE && height <= SPRITE_TEXTURE_SIZE, "Sprite texture is larger than a layer of the sprite texture array");
+  if (_resources->numSpriteTextures >= MAX_SPRITE_TEXTURES)
   {
-    return;
+    throw std::runtime_error("Too many sprite textures");
   }
 
-  // sort sprites by texture
-  std::sort(std::execution::seq,
-    sprites.begin(),
-    sprites.end(),
-    [](const RenderableSprite& lhs, const RenderableSprite& rhs)
-    {
-      return lhs.texture < rhs.texture;
-    });
+  if (!_resources->spriteTextures)
+  {
+    _resources->spriteTextures.emplace(Fwog::TextureCreateInfo
+      {
+        .imageType = Fwog::ImageType::TEX_2D_ARRAY,
+        .format = Fwog::Format::R8G8B8A8_SRGB,
+        .extent = { SPRITE_TEXTURE_SIZE, SPRITE_TEXTURE_SIZE, 1 },
+        .mipLevels = 1,
+        .arrayLayers = MAX_SPRITE_TEXTURES,
+        .sampleCount = Fwog::SampleCount::SAMPLES_1,
+      }, "sprite textures");
+  }
 
-  std::vector<SpriteUniforms> spritesUniforms;
+  const uint32_t layer = _resources->numSpriteTextures++;
+  _resources->spriteTextures->SubImage({ .dimension = Fwog::UploadDimension::THREE,
+                                         .offset = { 0, 0, layer },
+                                         .size = { width, height, 1 },
+                                         .format = Fwog::UploadFormat::RGBA,
+                                         .type = Fwog::UploadType::UBYTE,
+                                         .pixels = pixels });
+  const auto uvScale = glm::vec2(width, height) / static_cast<float>(SPRITE_TEXTURE_SIZE);
+  _resources->spriteUvScaleBuffer.SubDataTyped(uvScale, layer);
+  return layer;
+}
 
-  spritesUniforms.resize(sprites.size());
-  std::transform(std::execution::seq,
-    sprites.begin(),
-    sprites.end(),
-    spritesUniforms.begin(),
-    [](const RenderableSprite& sprite)
-    {
-      SpriteUniforms spriteUniforms
-      {
-        .transform = sprite.transform,
-        .tint4x8 = sprite.tint
-      };
-      return spriteUniforms;
-    });
+SpriteBatch Renderer::BeginSprites(uint32_t maxSprites)
+{
+  G_ASSERT_MSG(!_resources->spriteInstances, "The previous sprite batch wasn't drawn");
 
-  // geometric expansion so we don't spam buffers
-  if (_resources->spritesUniformsBuffer.Size() < spritesUniforms.size() * sizeof(SpriteUniforms))
+  auto allocation = _uploads->Allocate(sizeof(SpriteInstance) * std::max(maxSprites, 1u));
+  _resources->spriteInstances = allocation;
+  _resources->spriteDrawOrders.resize(maxSprites);
+  return SpriteBatch
   {
-    _resources->spritesUniformsBuffer = Fwog::TypedBuffer<SpriteUniforms>(spritesUniforms.size() * 2, Fwog::BufferStorageFlag::DYNAMIC_STORAGE);
-  }
-
-  _resources->spritesUniformsBuffer.SubData(std::span(spritesUniforms), 0);
+    .instances = std::span(reinterpret_cast<SpriteInstance*>(allocation.data), maxSprites),
+    .drawOrders = _resources->spriteDrawOrders,
+  };
+}
 
-  Fwog::BeginSwapchainRendering({ .viewport = {.drawRect = {.offset{}, .extent{_resources->frame.width, _resources->frame.height} } } });
-  Fwog::Cmd::BindGraphicsPipeline(_resources->spritePipeline);
-  Fwog::Cmd::BindUniformBuffer(0, _resources->frameUniformsBuffer, 0, _resources->frameUniformsBuffer.Size());
-  Fwog::Cmd::BindStorageBuffer(0, _resources->spritesUniformsBuffer, 0, _resources->spritesUniformsBuffer.Size());
+void Renderer::DrawSprites(const SpriteBatch& batch, uint32_t count)
+{
+  G_ASSERT_MSG(_resources->spriteInstances, "Call BeginSprites first");
+  G_ASSERT(count <= batch.instances.size());
 
-  std::size_t firstInstance = 0;
-  for (std::size_t i = 0; i < sprites.size(); i++)
+  const auto instances = *std::exchange(_resources->spriteInstances, std::nullopt);
+  if (count == 0 || !_resources->spriteTextures)
   {
-    const auto& sprite = sprites[i];
+    return;
+  }
 
-    // trigger draw if last sprite or if next sprite has a different texture
-    if (i == sprites.size() - 1 || sprite.texture != sprites[i + 1].texture)
+  // sprites are drawn in instance order unless their orders differ
+  const auto orders = batch.drawOrders.first(count);
+  const auto [minOrder, maxOrder] = std::minmax_element(orders.begin(), orders.end());
+  std::optional<TransientUploadAllocator::Allocation> drawOrder;
+  if (*minOrder != *maxOrder)
+  {
+    // the biased order goes above the instance index, so only those 16 bits need to be sorted
+    auto& keys = _resources->spriteSortKeys;
+    keys.resize(count);
+    for (uint32_t i = 0; i < count; i++)
     {
-      Fwog::Cmd::BindSampledImage(0, *sprite.texture, Fwog::Sampler(Fwog::SamplerState{}));
-      Fwog::Cmd::Draw(4, static_cast<uint32_t>(i + 1 - firstInstance), 0, static_cast<uint32_t>(firstInstance));
+      keys[i] = (static_cast<uint64_t>(orders[i] + 32768) << 32) | i;
+    }
+    _resources->spriteSorter.Sort(keys, 32, 48);
 
-      firstInstance = i + 1;
+    drawOrder = _uploads->Allocate(sizeof(uint32_t) * count);
+    auto* sortedIndices = reinterpret_cast<uint32_t*>(drawOrder->data);
+    for (uint32_t i = 0; i < count; i++)
+    {
+      sortedIndices[i] = static_cast<uint32_t>(keys[i]);
     }
   }
-  Fwog::EndRendering();
+
+  const auto drawUniforms = _uploads->Upload(SpriteDrawUniforms{ .useDrawOrder = drawOrder.has_value() });
+  auto outputHdr = _graph->ImportTexture(_resources->frame.output_hdr);
+
+  // sprite textures are never written on the GPU, so they aren't tracked by the graph
+  _graph->AddPass("Sprites", [this, instances, drawOrder, drawUniforms, count, outputHdr](const RenderGraph& graph)
+    {
+      auto viewport = Fwog::Viewport{ .drawRect = {.offset{}, .extent = _resources->frame.renderExtent} };
+      auto attachment0 = Fwog::RenderAttachment{ .texture = &graph.GetTexture(outputHdr) };
+      Fwog::BeginRendering({ .name = "Sprites", .viewport = &viewport, .colorAttachments = {{attachment0}} });
+      Fwog::Cmd::BindGraphicsPipeline(_resources->spritePipeline);
+      Fwog::Cmd::BindUniformBuffer(0, _resources->frameUniformsBuffer, 0, _resources->frameUniformsBuffer.Size());
+      TransientUploadAllocator::BindUniformBuffer(1, drawUniforms);
+      TransientUploadAllocator::BindStorageBuffer(0, instances);
+      TransientUploadAllocator::BindStorageBuffer(1, drawOrder.value_or(instances)); // something has to be bound
+      Fwog::Cmd::BindStorageBuffer(2, _resources->spriteUvScaleBuffer, 0, _resources->spriteUvScaleBuffer.Size());
+      Fwog::Cmd::BindSampledImage(0, *_resources->spriteTextures, _resources->spriteSampler);
+      Fwog::Cmd::Draw(4, count, 0, 0);
+      Fwog::EndRendering();
+    })
+    .Write(outputHdr, RenderGraph::Access::ATTACHMENT);
 }
 
 void Renderer::ClearHDR()
 {
-  Fwog::ClearColorValue ccv;
-  ccv.f[0] = 0;
-  ccv.f[1] = 0;
-  ccv.f[2] = 0;
-  ccv.f[3] = 0;
-  auto attachment0 = Fwog::RenderAttachment{ .texture = &_resources->frame.output_hdr, .clearValue{.color{ccv}}, .clearOnLoad = true };
-  Fwog::BeginRendering({ .name = "clear", .colorAttachments = {{attachment0}} });
-  Fwog::EndRendering();
+  auto outputHdr = _graph->ImportTexture(_resources->frame.output_hdr);
+  _graph->AddPass("Clear HDR", [outputHdr](const RenderGraph& graph)
+    {
+      Fwog::ClearColorValue ccv;
+      ccv.f[0] = 0;
+      ccv.f[1] = 0;
+      ccv.f[2] = 0;
+      ccv.f[3] = 0;
+      auto attachment0 = Fwog::RenderAttachment{ .texture = &graph.GetTexture(outputHdr), .clearValue{.color{ccv}}, .clearOnLoad = true };
+      Fwog::BeginRendering({ .name = "clear", .colorAttachments = {{attachment0}} });
+      Fwog::EndRendering();
+    })
+    .Overwrite(outputHdr, RenderGraph::Access::ATTACHMENT);
 }
 
 void Renderer::DrawLines(std::span<const ecs::DebugLine> lines)
@@ -522,16 +835,23 @@ void Renderer::DrawLines(std::span<const ecs::DebugLine> lines)
     return;
   }
     
-  // this buffer doesn't need to be created every frame
-  auto vertexBuffer = Fwog::Buffer(lines);
-
-  Fwog::BeginSwapchainRendering({ .viewport = {.drawRect = {.offset{}, .extent{_resources->frame.width, _resources->frame.height}}},
-                                  .clearColorOnLoad = false });
-  Fwog::Cmd::BindGraphicsPipeline(_resources->linesPipeline);
-  Fwog::Cmd::BindUniformBuffer(0, _resources->frameUniformsBuffer, 0, _resources->frameUniformsBuffer.Size());
-  Fwog::Cmd::BindVertexBuffer(0, vertexBuffer, 0, sizeof(ecs::DebugLine) / 2);
-  Fwog::Cmd::Draw(static_cast<uint32_t>(lines.size() * 2), 1, 0, 0);
-  Fwog::EndRendering();
+  const auto vertexUpload = _uploads->Upload(lines);
+  const auto numLines = static_cast<uint32_t>(lines.size());
+
+  _resources->swapchainOverlays.push_back([this, vertexUpload, numLines]
+    {
+      _graph->AddPass("Debug lines", [this, vertexUpload, numLines](const RenderGraph&)
+        {
+          Fwog::BeginSwapchainRendering({ .viewport = {.drawRect = {.offset{}, .extent{_resources->frame.width, _resources->frame.height}}},
+                                          .clearColorOnLoad = false });
+          Fwog::Cmd::BindGraphicsPipeline(_resources->linesPipeline);
+          Fwog::Cmd::BindUniformBuffer(0, _resources->frameUniformsBuffer, 0, _resources->frameUniformsBuffer.Size());
+          TransientUploadAllocator::BindVertexBuffer(0, vertexUpload, sizeof(ecs::DebugLine) / 2);
+          Fwog::Cmd::Draw(numLines * 2, 1, 0, 0);
+          Fwog::EndRendering();
+        })
+        .Write(_graph->Swapchain(), RenderGraph::Access::ATTACHMENT);
+    });
 }
 
 void Renderer::DrawBoxes(std::span<const ecs::DebugBox> boxes)
@@ -552,21 +872,25 @@ void Renderer::DrawBoxes(std::span<const ecs::DebugBox> boxes)
     });
   }
 
-  auto instanceBuffer = Fwog::Buffer(std::span(primitives));
-
-  //Fwog::BeginSwapchainRendering({ .viewport = {.drawRect = {.offset{}, .extent{_resources->frame.width, _resources->frame.height}}},
-  //                                .clearColorOnLoad = false });
+  const auto instanceUpload = _uploads->Upload(std::span(std::as_const(primitives)));
+  const auto numBoxes = static_cast<uint32_t>(boxes.size());
+  auto outputHdr = _graph->ImportTexture(_resources->frame.output_hdr);
 
-  auto attachment0 = Fwog::RenderAttachment{ .texture = &_resources->frame.output_hdr };
-  Fwog::BeginRendering({ .name = "debug boxes", .colorAttachments = {{attachment0}}});
-  {
-    Fwog::Cmd::BindGraphicsPipeline(_resources->primitivePipeline);
-    Fwog::Cmd::BindUniformBuffer(0, _resources->frameUniformsBuffer, 0, _resources->frameUniformsBuffer.Size());
-    Fwog::Cmd::BindStorageBuffer(0, instanceBuffer, 0, instanceBuffer.Size());
-    Fwog::Cmd::BindVertexBuffer(0, _resources->boxVertexBuffer, 0, sizeof(glm::vec2));
-    Fwog::Cmd::Draw(5, static_cast<uint32_t>(boxes.size()), 0, 0);
-  }
-  Fwog::EndRendering();
+  _graph->AddPass("Debug boxes", [this, instanceUpload, numBoxes, outputHdr](const RenderGraph& graph)
+    {
+      auto viewport = Fwog::Viewport{ .drawRect = {.offset{}, .extent = _resources->frame.renderExtent} };
+      auto attachment0 = Fwog::RenderAttachment{ .texture = &graph.GetTexture(outputHdr) };
+      Fwog::BeginRendering({ .name = "debug boxes", .viewport = &viewport, .colorAttachments = {{attachment0}}});
+      {
+        Fwog::Cmd::BindGraphicsPipeline(_resources->primitivePipeline);
+        Fwog::Cmd::BindUniformBuffer(0, _resources->frameUniformsBuffer, 0, _resources->frameUniformsBuffer.Size());
+        TransientUploadAllocator::BindStorageBuffer(0, instanceUpload);
+        Fwog::Cmd::BindVertexBuffer(0, _resources->boxVertexBuffer, 0, sizeof(glm::vec2));
+        Fwog::Cmd::Draw(5, numBoxes, 0, 0);
+      }
+      Fwog::EndRendering();
+    })
+    .Write(outputHdr, RenderGraph::Access::ATTACHMENT);
 }
 
 void Renderer::DrawCircles(std::span<const ecs::DebugCircle> circles)
@@ -587,84 +911,367 @@ void Renderer::DrawCircles(std::span<const ecs::DebugCircle> circles)
       });
   }
 
-  auto instanceBuffer = Fwog::Buffer(std::span(primitives));
+  const auto instanceUpload = _uploads->Upload(std::span(std::as_const(primitives)));
+  const auto numCircles = static_cast<uint32_t>(circles.size());
 
-  Fwog::BeginSwapchainRendering({ .viewport = {.drawRect = {.offset{}, .extent{_resources->frame.width, _resources->frame.height}}},
-                                  .clearColorOnLoad = false });
-  Fwog::Cmd::BindGraphicsPipeline(_resources->primitivePipeline);
-  Fwog::Cmd::BindUniformBuffer(0, _resources->frameUniformsBuffer, 0, _resources->frameUniformsBuffer.Size());
-  Fwog::Cmd::BindStorageBuffer(0, instanceBuffer, 0, instanceBuffer.Size());
-  Fwog::Cmd::BindVertexBuffer(0, _resources->circleVertexBuffer, 0, sizeof(glm::vec2));
-  Fwog::Cmd::Draw(CIRCLE_SEGMENTS + 1, static_cast<uint32_t>(circles.size()), 0, 0);
-  Fwog::EndRendering();
+  _resources->swapchainOverlays.push_back([this, instanceUpload, numCircles]
+    {
+      _graph->AddPass("Debug circles", [this, instanceUpload, numCircles](const RenderGraph&)
+        {
+          Fwog::BeginSwapchainRendering({ .viewport = {.drawRect = {.offset{}, .extent{_resources->frame.width, _resources->frame.height}}},
+                                          .clearColorOnLoad = false });
+          Fwog::Cmd::BindGraphicsPipeline(_resources->primitivePipeline);
+          Fwog::Cmd::BindUniformBuffer(0, _resources->frameUniformsBuffer, 0, _resources->frameUniformsBuffer.Size());
+          TransientUploadAllocator::BindStorageBuffer(0, instanceUpload);
+          Fwog::Cmd::BindVertexBuffer(0, _resources->circleVertexBuffer, 0, sizeof(glm::vec2));
+          Fwog::Cmd::Draw(CIRCLE_SEGMENTS + 1, numCircles, 0, 0);
+          Fwog::EndRendering();
+        })
+        .Write(_graph->Swapchain(), RenderGraph::Access::ATTACHMENT);
+    });
 }
 
-void Renderer::DrawParticles(const Fwog::Buffer& particles, const Fwog::Buffer& renderIndices, uint32_t maxParticles)
+void Renderer::DrawParticles(const Fwog::Buffer& particles, const Fwog::Buffer& renderIndices)
 {
-  Fwog::BeginCompute("Render particles");
+  using Access = RenderGraph::Access;
+  const auto mode = SupportsParticleSplatMode(particleSplatMode) ? particleSplatMode : ParticleSplatMode::SEPARATE;
+  const Fwog::Extent2D frameDim = { _resources->frame.width, _resources->frame.height }; // the render extent may be smaller
+
+  auto particlesBuffer = _graph->ImportBuffer(particles);
+  auto indicesBuffer = _graph->ImportBuffer(renderIndices);
+  auto dispatchArgs = _graph->ImportBuffer(_resources->particleDispatchArgsBuffer);
+  auto outputHdr = _graph->ImportTexture(_resources->frame.output_hdr);
+
+  _graph->AddPass("Write particle dispatch args", [this, &renderIndices](const RenderGraph&)
+    {
+      Fwog::BeginCompute("Write particle dispatch args");
+      Fwog::Cmd::BindComputePipeline(_resources->writeDispatchArgsPipeline);
+      Fwog::Cmd::BindStorageBuffer(0, renderIndices, 0, renderIndices.Size());
+      Fwog::Cmd::BindStorageBuffer(1, _resources->particleDispatchArgsBuffer, 0, _resources->particleDispatchArgsBuffer.Size());
+      Fwog::Cmd::Dispatch(1, 1, 1);
+      Fwog::EndCompute();
+    })
+    .Read(indicesBuffer, Access::STORAGE_READ)
+    .Overwrite(dispatchArgs, Access::STORAGE_WRITE);
+
+  if (mode == ParticleSplatMode::PACKED_INT64)
+  {
+    auto packed = _graph->ImportBuffer(*_resources->frame.particle_hdr_packed);
+
+    _graph->AddPass("Render particles", [this, &particles, &renderIndices](const RenderGraph&)
+      {
+        constexpr uint32_t zero = 0;
+        auto& target = *_resources->frame.particle_hdr_packed;
+        target.ClearSubData(0, target.Size(), Fwog::Format::R32_UINT, Fwog::UploadFormat::R_INTEGER, Fwog::UploadType::UINT, &zero);
+
+        Fwog::BeginCompute("Render particles");
+        Fwog::Cmd::BindComputePipeline(_resources->particlePackedPipeline);
+        Fwog::Cmd::BindStorageBuffer(0, particles, 0, particles.Size());
+        Fwog::Cmd::BindStorageBuffer(1, renderIndices, 0, renderIndices.Size());
+        Fwog::Cmd::BindStorageBuffer(2, target, 0, target.Size());
+        Fwog::Cmd::BindUniformBuffer(0, _resources->particleTargetUniformsBuffer, 0, _resources->particleTargetUniformsBuffer.Size());
+        Fwog::Cmd::DispatchIndirect(_resources->particleDispatchArgsBuffer, 0);
+        Fwog::EndCompute();
+      })
+      .Read(particlesBuffer, Access::STORAGE_READ)
+      .Read(indicesBuffer, Access::STORAGE_READ)
+      .Read(dispatchArgs, Access::INDIRECT)
+      .Overwrite(packed, Access::TRANSFER_WRITE)
+      .Write(packed, Access::STORAGE_WRITE);
+
+    _graph->AddPass("Resolve particles", [this, outputHdr](const RenderGraph& graph)
+      {
+        const auto& target = *_resources->frame.particle_hdr_packed;
+        auto viewport = Fwog::Viewport{ .drawRect = {.offset{}, .extent = _resources->frame.renderExtent} };
+        auto attachment = Fwog::RenderAttachment{ .texture = &graph.GetTexture(outputHdr) };
+        Fwog::BeginRendering({ .name = "Resolve particles", .viewport = &viewport, .colorAttachments = {{ attachment }} });
+        // HACK: if imgui is the only other thing doing graphics this frame,
+        // the pipeline binding will be skipped (due to Fwog not knowing about the outside world)
+        Fwog::Cmd::BindGraphicsPipeline(_resources->backgroundPipeline);
+        Fwog::Cmd::BindGraphicsPipeline(_resources->particlePackedResolvePipeline);
+        Fwog::Cmd::BindStorageBuffer(0, target, 0, target.Size());
+        Fwog::Cmd::BindUniformBuffer(0, _resources->particleTargetUniformsBuffer, 0, _resources->particleTargetUniformsBuffer.Size());
+        Fwog::Cmd::Draw(3, 1, 0, 0);
+        Fwog::EndRendering();
+      })
+      .Read(packed, Access::STORAGE_READ)
+      .Write(outputHdr, Access::ATTACHMENT);
+  }
+  else
   {
-    constexpr uint32_t zero = 0;
-    auto clearInfo = Fwog::TextureClearInfo
+    // only live until they're resolved, so their storage is reused later in the frame
+    const auto particleDesc = RenderGraph::TextureDesc{ .extent = frameDim, .format = Fwog::Format::R32_UINT };
+    auto particleR = _graph->CreateTexture(particleDesc);
+    auto particleG = _graph->CreateTexture(particleDesc);
+    auto particleB = _graph->CreateTexture(particleDesc);
+
+    if (mode == ParticleSplatMode::TILED)
     {
-      .size = _resources->frame.particle_hdr_r.Extent(),
-      .format = Fwog::UploadFormat::R_INTEGER,
-      .type = Fwog::UploadType::UINT,
-      .data = &zero,
-    };
+      // the render index buffer holds a count followed by the indices, so this is slightly more than needed
+      const size_t maxIndices = renderIndices.Size() / sizeof(int32_t);
+      if (!_resources->particleKeysBuffer || _resources->particleKeysBuffer->Size() < maxIndices * sizeof(glm::uvec2))
+      {
+        _resources->particleKeysBuffer.emplace(maxIndices * sizeof(glm::uvec2));
+        _resources->particleSortedIndicesBuffer.emplace(maxIndices * sizeof(int32_t));
+      }
+
+      auto tileCounts = _graph->ImportBuffer(*_resources->frame.particleTileCounts);
+      auto tileOffsets = _graph->ImportBuffer(*_resources->frame.particleTileOffsets);
+      auto keys = _graph->ImportBuffer(*_resources->particleKeysBuffer);
+      auto sortedIndices = _graph->ImportBuffer(*_resources->particleSortedIndicesBuffer);
+
+      // counting sort particles by the tile they land in
+      _graph->AddPass("Bin particles", [this, &particles, &renderIndices](const RenderGraph&)
+        {
+          constexpr uint32_t zero = 0;
+          auto& counts = *_resources->frame.particleTileCounts;
+          const auto& keysBuffer = *_resources->particleKeysBuffer;
+          counts.ClearSubData(0, counts.Size(), Fwog::Format::R32_UINT, Fwog::UploadFormat::R_INTEGER, Fwog::UploadType::UINT, &zero);
+
+          Fwog::BeginCompute("Bin particles");
+          Fwog::Cmd::BindComputePipeline(_resources->particleBinPipeline);
+          Fwog::Cmd::BindUniformBuffer(0, _resources->particleTargetUniformsBuffer, 0, _resources->particleTargetUniformsBuffer.Size());
+          Fwog::Cmd::BindStorageBuffer(0, particles, 0, particles.Size());
+          Fwog::Cmd::BindStorageBuffer(1, renderIndices, 0, renderIndices.Size());
+          Fwog::Cmd::BindStorageBuffer(2, counts, 0, counts.Size());
+          Fwog::Cmd::BindStorageBuffer(3, keysBuffer, 0, keysBuffer.Size());
+          Fwog::Cmd::DispatchIndirect(_resources->particleDispatchArgsBuffer, 0);
+          Fwog::EndCompute();
+        })
+        .Read(particlesBuffer, Access::STORAGE_READ)
+        .Read(indicesBuffer, Access::STORAGE_READ)
+        .Read(dispatchArgs, Access::INDIRECT)
+        .Overwrite(tileCounts, Access::TRANSFER_WRITE)
+        .Write(tileCounts, Access::STORAGE_WRITE)
+        .Overwrite(keys, Access::STORAGE_WRITE);
+
+      _graph->AddPass("Scan tiles", [this](const RenderGraph&)
+        {
+          const auto& counts = *_resources->frame.particleTileCounts;
+          const auto& offsets = *_resources->frame.particleTileOffsets;
+          Fwog::BeginCompute("Scan tiles");
+          Fwog::Cmd::BindComputePipeline(_resources->particleScanTilesPipeline);
+          Fwog::Cmd::BindUniformBuffer(0, _resources->particleTargetUniformsBuffer, 0, _resources->particleTargetUniformsBuffer.Size());
+          Fwog::Cmd::BindStorageBuffer(0, counts, 0, counts.Size());
+          Fwog::Cmd::BindStorageBuffer(1, offsets, 0, offsets.Size());
+          Fwog::Cmd::Dispatch(1, 1, 1);
+          Fwog::EndCompute();
+        })
+        .Read(tileCounts, Access::STORAGE_READ)
+        .Overwrite(tileOffsets, Access::STORAGE_WRITE);
+
+      _graph->AddPass("Scatter particles", [this, &renderIndices](const RenderGraph&)
+        {
+          const auto& offsets = *_resources->frame.particleTileOffsets;
+          const auto& keysBuffer = *_resources->particleKeysBuffer;
+          const auto& sorted = *_resources->particleSortedIndicesBuffer;
+          Fwog::BeginCompute("Scatter particles");
+          Fwog::Cmd::BindComputePipeline(_resources->particleScatterPipeline);
+          Fwog::Cmd::BindUniformBuffer(0, _resources->particleTargetUniformsBuffer, 0, _resources->particleTargetUniformsBuffer.Size());
+          Fwog::Cmd::BindStorageBuffer(1, renderIndices, 0, renderIndices.Size());
+          Fwog::Cmd::BindStorageBuffer(2, offsets, 0, offsets.Size());
+          Fwog::Cmd::BindStorageBuffer(3, keysBuffer, 0, keysBuffer.Size());
+          Fwog::Cmd::BindStorageBuffer(4, sorted, 0, sorted.Size());
+          Fwog::Cmd::DispatchIndirect(_resources->particleDispatchArgsBuffer, 0);
+          Fwog::EndCompute();
+        })
+        .Read(indicesBuffer, Access::STORAGE_READ)
+        .Read(tileOffsets, Access::STORAGE_READ)
+        .Read(keys, Access::STORAGE_READ)
+        .Read(dispatchArgs, Access::INDIRECT)
+        .Overwrite(sortedIndices, Access::STORAGE_WRITE);
+
+      // one workgroup per tile accumulates in shared memory and writes every pixel, so no clear is needed
+      _graph->AddPass("Render particles", [this, &particles, particleR, particleG, particleB](const RenderGraph& graph)
+        {
+          const auto& counts = *_resources->frame.particleTileCounts;
+          const auto& offsets = *_resources->frame.particleTileOffsets;
+          const auto& sorted = *_resources->particleSortedIndicesBuffer;
+          Fwog::BeginCompute("Render particles");
+          Fwog::Cmd::BindComputePipeline(_resources->particleTiledPipeline);
+          Fwog::Cmd::BindUniformBuffer(0, _resources->particleTargetUniformsBuffer, 0, _resources->particleTargetUniformsBuffer.Size());
+          Fwog::Cmd::BindStorageBuffer(0, particles, 0, particles.Size());
+          Fwog::Cmd::BindStorageBuffer(1, counts, 0, counts.Size());
+          Fwog::Cmd::BindStorageBuffer(2, offsets, 0, offsets.Size());
+          Fwog::Cmd::BindStorageBuffer(3, sorted, 0, sorted.Size());
+          Fwog::Cmd::BindImage(0, graph.GetTexture(particleR), 0);
+          Fwog::Cmd::BindImage(1, graph.GetTexture(particleG), 0);
+          Fwog::Cmd::BindImage(2, graph.GetTexture(particleB), 0);
+          Fwog::Cmd::Dispatch(_resources->frame.particleTiles.x, _resources->frame.particleTiles.y, 1);
+          Fwog::EndCompute();
+        })
+        .Read(particlesBuffer, Access::STORAGE_READ)
+        .Read(tileCounts, Access::STORAGE_READ)
+        .Read(tileOffsets, Access::STORAGE_READ)
+        .Read(sortedIndices, Access::STORAGE_READ)
+        .Overwrite(particleR, Access::STORAGE_WRITE)
+        .Overwrite(particleG, Access::STORAGE_WRITE)
+        .Overwrite(particleB, Access::STORAGE_WRITE);
+    }
+    else
+    {
+      _graph->AddPass("Render particles", [this, &particles, &renderIndices, particleR, particleG, particleB](const RenderGraph& graph)
+        {
+          constexpr uint32_t zero = 0;
+          auto& targetR = graph.GetTexture(particleR);
+          auto& targetG = graph.GetTexture(particleG);
+          auto& targetB = graph.GetTexture(particleB);
+          const auto renderExtent = _resources->frame.renderExtent;
+          auto clearInfo = Fwog::TextureClearInfo
+          {
+            .size = { renderExtent.width, renderExtent.height, 1 },
+            .format = Fwog::UploadFormat::R_INTEGER,
+            .type = Fwog::UploadType::UINT,
+            .data = &zero,
+          };
+
+          targetR.ClearImage(clearInfo);
+          targetG.ClearImage(clearInfo);
+          targetB.ClearImage(clearInfo);
+
+          Fwog::BeginCompute("Render particles");
+          Fwog::Cmd::BindComputePipeline(_resources->particlePipeline);
+          Fwog::Cmd::BindUniformBuffer(0, _resources->particleTargetUniformsBuffer, 0, _resources->particleTargetUniformsBuffer.Size());
+          Fwog::Cmd::BindStorageBuffer(0, particles, 0, particles.Size());
+          Fwog::Cmd::BindStorageBuffer(1, renderIndices, 0, renderIndices.Size());
+          Fwog::Cmd::BindImage(0, targetR, 0);
+          Fwog::Cmd::BindImage(1, targetG, 0);
+          Fwog::Cmd::BindImage(2, targetB, 0);
+          Fwog::Cmd::DispatchIndirect(_resources->particleDispatchArgsBuffer, 0);
+          Fwog::EndCompute();
+        })
+        .Read(particlesBuffer, Access::STORAGE_READ)
+        .Read(indicesBuffer, Access::STORAGE_READ)
+        .Read(dispatchArgs, Access::INDIRECT)
+        .Overwrite(particleR, Access::TRANSFER_WRITE)
+        .Overwrite(particleG, Access::TRANSFER_WRITE)
+        .Overwrite(particleB, Access::TRANSFER_WRITE)
+        .Write(particleR, Access::STORAGE_WRITE)
+        .Write(particleG, Access::STORAGE_WRITE)
+        .Write(particleB, Access::STORAGE_WRITE);
+    }
 
-    Fwog::Cmd::MemoryBarrier(Fwog::MemoryBarrierAccessBit::TEXTURE_UPDATE_BIT);
-    _resources->frame.particle_hdr_r.ClearImage(clearInfo);
-    _resources->frame.particle_hdr_g.ClearImage(clearInfo);
-    _resources->frame.particle_hdr_b.ClearImage(clearInfo);
-    Fwog::Cmd::BindComputePipeline(_resources->particlePipeline);
-    Fwog::Cmd::BindStorageBuffer(0, particles, 0, particles.Size());
-    Fwog::Cmd::BindStorageBuffer(1, renderIndices, 0, renderIndices.Size());
-    Fwog::Cmd::BindImage(0, _resources->frame.particle_hdr_r, 0);
-    Fwog::Cmd::BindImage(1, _resources->frame.particle_hdr_g, 0);
-    Fwog::Cmd::BindImage(2, _resources->frame.particle_hdr_b, 0);
-
-    uint32_t workgroups = (maxParticles + 511) / 512;
-    Fwog::Cmd::MemoryBarrier(Fwog::MemoryBarrierAccessBit::IMAGE_ACCESS_BIT | Fwog::MemoryBarrierAccessBit::SHADER_STORAGE_BIT);
-    Fwog::Cmd::Dispatch(workgroups, 1, 1);
-  }
-  Fwog::EndCompute();
-
-  auto sampler = Fwog::Sampler(Fwog::SamplerState{ .minFilter = Fwog::Filter::NEAREST, .magFilter = Fwog::Filter::NEAREST });
-  auto attachment = Fwog::RenderAttachment{ .texture = &_resources->frame.output_hdr };
-  Fwog::BeginRendering({ .name = "Resolve particles", .colorAttachments = {{ attachment }} });
-  {
-    // HACK: if imgui is the only other thing doing graphics this frame,
-    // the pipeline binding will be skipped (due to Fwog not knowing about the outside world)
-    Fwog::Cmd::BindGraphicsPipeline(_resources->backgroundPipeline);
-    Fwog::Cmd::BindGraphicsPipeline(_resources->particleResolvePipeline);
-    Fwog::Cmd::BindSampledImage(0, _resources->frame.particle_hdr_r, sampler);
-    Fwog::Cmd::BindSampledImage(1, _resources->frame.particle_hdr_g, sampler);
-    Fwog::Cmd::BindSampledImage(2, _resources->frame.particle_hdr_b, sampler);
-    Fwog::Cmd::MemoryBarrier(Fwog::MemoryBarrierAccessBit::TEXTURE_FETCH_BIT);
-    Fwog::Cmd::Draw(3, 1, 0, 0);
-  }
-  Fwog::EndRendering();
-
-  ApplyBloom(_resources->frame.output_hdr, 6, enableBloom ? 1.0f / 64.0f : 0.0f, 1.0f, _resources->frame.output_hdr_scratch);
+    if (enableFusedPresent)
+    {
+      ResolveBloomAndPresent(outputHdr, { particleR, particleG, particleB });
+      return;
+    }
 
-  // fuggit, I'm gonna resolve the final image here too
-  Fwog::BeginCompute("Tonemap");
+    _graph->AddPass("Resolve particles", [this, outputHdr, particleR, particleG, particleB](const RenderGraph& graph)
+      {
+        auto viewport = Fwog::Viewport{ .drawRect = {.offset{}, .extent = _resources->frame.renderExtent} };
+        auto attachment = Fwog::RenderAttachment{ .texture = &graph.GetTexture(outputHdr) };
+        Fwog::BeginRendering({ .name = "Resolve particles", .viewport = &viewport, .colorAttachments = {{ attachment }} });
+        // HACK: if imgui is the only other thing doing graphics this frame,
+        // the pipeline binding will be skipped (due to Fwog not knowing about the outside world)
+        Fwog::Cmd::BindGraphicsPipeline(_resources->backgroundPipeline);
+        Fwog::Cmd::BindGraphicsPipeline(_resources->particleResolvePipeline);
+        Fwog::Cmd::BindSampledImage(0, graph.GetTexture(particleR), _resources->nearestSampler);
+        Fwog::Cmd::BindSampledImage(1, graph.GetTexture(particleG), _resources->nearestSampler);
+        Fwog::Cmd::BindSampledImage(2, graph.GetTexture(particleB), _resources->nearestSampler);
+        Fwog::Cmd::Draw(3, 1, 0, 0);
+        Fwog::EndRendering();
+      })
+      .Read(particleR, Access::SAMPLED)
+      .Read(particleG, Access::SAMPLED)
+      .Read(particleB, Access::SAMPLED)
+      .Write(outputHdr, Access::ATTACHMENT);
+  }
+
+  if (enableBloom)
   {
-    Fwog::Cmd::BindComputePipeline(_resources->tonemapPipeline);
-    Fwog::Cmd::BindSampledImage(0, _resources->frame.output_hdr, sampler);
-    Fwog::Cmd::BindImage(0, _resources->frame.output_ldr, 0);
+    auto scratch = _graph->CreateTexture({ .extent = frameDim >> 1, .format = Fwog::Format::R16G16B16A16_FLOAT, .mipLevels = 8 });
+    ApplyBloom(outputHdr, BLOOM_PASSES, BLOOM_STRENGTH, BLOOM_WIDTH, scratch);
+  }
+
+  // has the same size and texel size as the particle images, so it takes their storage once they're resolved
+  auto outputLdr = _graph->CreateTexture({ .extent = frameDim, .format = Fwog::Format::R8G8B8A8_UNORM });
+
+  // fuggit, I'm gonna resolve the final image here too
+  _graph->AddPass("Tonemap", [this, outputHdr, outputLdr](const RenderGraph& graph)
+    {
+      Fwog::BeginCompute("Tonemap");
+      Fwog::Cmd::BindComputePipeline(_resources->tonemapPipeline);
+      Fwog::Cmd::BindUniformBuffer(0, _resources->particleTargetUniformsBuffer, 0, _resources->particleTargetUniformsBuffer.Size());
+      Fwog::Cmd::BindSampledImage(0, graph.GetTexture(outputHdr), _resources->nearestSampler);
+      Fwog::Cmd::BindImage(0, graph.GetTexture(outputLdr), 0);
+      auto workgroups = (_resources->frame.renderExtent + 7) / 8;
+      Fwog::Cmd::Dispatch(workgroups.width, workgroups.height, 1);
+      Fwog::EndCompute();
+    })
+    .Read(outputHdr, Access::SAMPLED)
+    .Overwrite(outputLdr, Access::STORAGE_WRITE);
+
+  // scales the rendered region up to the window
+  _graph->AddPass("Present", [this, outputLdr](const RenderGraph& graph)
+    {
+      const auto renderExtent = _resources->frame.renderExtent;
+      Fwog::BlitTextureToSwapchain(graph.GetTexture(outputLdr),
+                                   { 0, 0, 0 },
+                                   { 0, 0, 0 },
+                                   { renderExtent.width, renderExtent.height, 1 },
+                                   { _resources->frame.width, _resources->frame.height, 1 },
+                                   Fwog::Filter::LINEAR);
+    })
+    .Read(outputLdr, Access::TRANSFER_READ)
+    .Overwrite(_graph->Swapchain(), Access::TRANSFER_WRITE);
+}
+
+void Renderer::ResolveBloomAndPresent(RenderGraph::TextureHandle sceneColor, const std::array<RenderGraph::TextureHandle, 3>& particleImages)
+{
+  using Access = RenderGraph::Access;
+  const Fwog::Extent2D frameDim = { _resources->frame.width, _resources->frame.height };
+  const Fwog::Extent2D renderDim = _resources->frame.renderExtent;
+  const Fwog::Extent2D bloomDim = renderDim >> 1;
 
-    auto workgroups = (_resources->frame.output_ldr.Extent() + 7) / 8;
-    Fwog::Cmd::MemoryBarrier(Fwog::MemoryBarrierAccessBit::IMAGE_ACCESS_BIT);
-    Fwog::Cmd::Dispatch(workgroups.width, workgroups.height, 1);
-    Fwog::Cmd::MemoryBarrier(Fwog::MemoryBarrierAccessBit::FRAMEBUFFER_BIT);
+  std::optional<RenderGraph::TextureHandle> bloom;
+  if (enableBloom)
+  {
+    bloom = _graph->CreateTexture({ .extent = frameDim >> 1, .format = Fwog::Format::R16G16B16A16_FLOAT, .mipLevels = 8 });
+    BuildBloomChain(sceneColor, BLOOM_PASSES, BLOOM_WIDTH, *bloom, particleImages);
   }
-  Fwog::EndCompute();
 
-  Fwog::BlitTextureToSwapchain(_resources->frame.output_ldr,
-                               { 0, 0, 0 },
-                               { 0, 0, 0 },
-                               _resources->frame.output_ldr.Extent(),
-                               { _resources->frame.width, _resources->frame.height, 1 },
-                               Fwog::Filter::LINEAR);
+  const auto uniforms = _uploads->Upload(PresentUniforms
+    {
+      .renderDim = { renderDim.width, renderDim.height },
+      .windowDim = { frameDim.width, frameDim.height },
+      .bloomDim = { bloomDim.width, bloomDim.height },
+      .bloomUvScale = RegionScale(bloomDim, frameDim >> 1),
+      .bloomWidth = BLOOM_WIDTH,
+      .bloomStrength = bloom ? BLOOM_STRENGTH : 0.0f,
+    });
+
+  // runs at the window's resolution, so it replaces the tonemap dispatch and the blit
+  auto present = _graph->AddPass("Present", [this, sceneColor, particleImages, bloom, uniforms](const RenderGraph& graph)
+    {
+      Fwog::BeginSwapchainRendering({ .viewport = {.drawRect = {.offset{}, .extent{_resources->frame.width, _resources->frame.height}}},
+                                      .clearColorOnLoad = false });
+      // HACK: if imgui is the only other thing doing graphics this frame,
+      // the pipeline binding will be skipped (due to Fwog not knowing about the outside world)
+      Fwog::Cmd::BindGraphicsPipeline(_resources->backgroundPipeline);
+      Fwog::Cmd::BindGraphicsPipeline(_resources->resolveBloomTonemapPipeline);
+      TransientUploadAllocator::BindUniformBuffer(0, uniforms);
+      Fwog::Cmd::BindSampledImage(0, graph.GetTexture(sceneColor), _resources->bloomSampler);
+      for (uint32_t i = 0; i < particleImages.size(); i++)
+      {
+        Fwog::Cmd::BindSampledImage(1 + i, graph.GetTexture(particleImages[i]), _resources->nearestSampler);
+      }
+      if (bloom)
+      {
+        Fwog::Cmd::BindSampledImage(4, graph.GetTexture(*bloom), _resources->bloomSampler);
+      }
+      Fwog::Cmd::Draw(3, 1, 0, 0);
+      Fwog::EndRendering();
+    });
+  present
+    .Read(sceneColor, Access::SAMPLED)
+    .Overwrite(_graph->Swapchain(), Access::ATTACHMENT);
+  for (auto image : particleImages)
+  {
+    present.Read(image, Access::SAMPLED);
+  }
+  if (bloom)
+  {
+    present.Read(*bloom, Access::SAMPLED);
+  }
 }
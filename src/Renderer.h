@@ -1,12 +1,19 @@
 #pragma once
+#include "RenderGraph.h"
 #include "ecs/components/DebugDraw.h"
+#include <array>
+#include <cstdint>
 #include <string_view>
 #include <vector>
 #include <span>
+#include <memory>
 #include <glm/mat3x2.hpp>
 #include <glm/vec4.hpp>
 
 struct GLFWwindow;
+class GpuProfiler;
+class TransientUploadAllocator;
+class DynamicResolution;
 
 namespace Fwog
 {
@@ -14,11 +21,27 @@ namespace Fwog
   class Buffer;
 }
 
-struct RenderableSprite
+// one sprite, as read by QuadBatched.vert.glsl
+struct SpriteInstance
 {
   glm::mat3x2 transform;
-  const Fwog::Texture* texture;
   glm::u8vec4 tint;
+  uint32_t texture; // returned by Renderer::AddSpriteTexture
+};
+
+// Memory for the sprites of one draw. instances is mapped GPU memory, so write each instance whole and never read it back
+struct SpriteBatch
+{
+  std::span<SpriteInstance> instances;
+  std::span<int16_t> drawOrders; // higher orders are drawn on top. Equal orders are drawn in instance order
+};
+
+// how particles are accumulated into the HDR image before being resolved
+enum class ParticleSplatMode
+{
+  SEPARATE, // three R32UI images, three atomics per particle
+  PACKED_INT64, // all channels packed into one 64-bit value, one atomic per particle
+  TILED, // particles are sorted by screen tile and accumulated in shared memory, no global atomics on pixels
 };
 
 class Renderer
@@ -32,24 +55,72 @@ public:
   Renderer& operator=(const Renderer&) = delete;
   Renderer& operator=(Renderer&&) = delete;
 
+  // bracket everything drawn in a frame so it can be profiled
+  void BeginFrame();
+  void EndFrame();
+
+  GpuProfiler& Profiler() { return *_profiler; }
+
+  // for data that the GPU reads once, in the frame it was uploaded
+  TransientUploadAllocator& Uploads() { return *_uploads; }
+
+  // The draw functions below only record passes. They run when the frame is submitted,
+  // so anything they read must stay alive and unchanged until then.
+  void SubmitFrame();
+
   void DrawBackground(const Fwog::Texture& texture);
-  void DrawSprites(std::vector<RenderableSprite> sprites);
 
-  void ClearHDR();
+  // Copies an RGBA8 sRGB image into its own layer of the sprite texture array and returns the layer.
+  // Images smaller than a layer only cover part of it
+  uint32_t AddSpriteTexture(const void* pixels, uint32_t width, uint32_t height);
 
-  // debug drawing utilities
+  // Every sprite is drawn in one instanced call. Write up to maxSprites sprites to the batch,
+  // then draw the first count of them. Only one batch may be open at a time
+  SpriteBatch BeginSprites(uint32_t maxSprites);
+  void DrawSprites(const SpriteBatch& batch, uint32_t count);
+
+  // debug drawing utilities. Lines and circles are drawn at the window's resolution over the presented image
   void DrawLines(std::span<const ecs::DebugLine> lines);
   void DrawBoxes(std::span<const ecs::DebugBox> boxes);
   void DrawCircles(std::span<const ecs::DebugCircle> circles);
 
-  void DrawParticles(const Fwog::Buffer& particles, const Fwog::Buffer& renderIndices, uint32_t maxParticles);
+  // Only the particles referenced by renderIndices are drawn. The dispatch is sized on the GPU from its count.
+  // Falls back to ParticleSplatMode::SEPARATE if particleSplatMode isn't supported.
+  void DrawParticles(const Fwog::Buffer& particles, const Fwog::Buffer& renderIndices);
+
+  [[nodiscard]] bool SupportsParticleSplatMode(ParticleSplatMode mode) const;
+
+  // fraction of the window's resolution that the particles, bloom and tonemap are rendered at this frame
+  [[nodiscard]] float RenderScale() const;
 
   struct Resources;
 
   // stinky GLOBAL (basically)
   static inline bool enableBloom = true;
+  static inline bool enableFusedPresent = true; // ignored when particles are splatted with PACKED_INT64
+  static inline ParticleSplatMode particleSplatMode = ParticleSplatMode::TILED;
+  static inline bool enableDynamicResolution = true;
+  static inline float gpuFrameBudgetMs = 1000.0f / 60.0f;
 private:
-  void ApplyBloom(const Fwog::Texture& target, uint32_t passes, float strength, float width, const Fwog::Texture& scratchTexture);
+  void SetRenderScale(float scale);
+  void ClearHDR();
+
+  // Downsamples source into the mips of scratchTexture and adds the smaller levels to the first.
+  // If particleImages holds the three unresolved particle images, they're added to source as it's read
+  void BuildBloomChain(RenderGraph::TextureHandle source,
+                       uint32_t passes,
+                       float width,
+                       RenderGraph::TextureHandle scratchTexture,
+                       std::span<const RenderGraph::TextureHandle> particleImages = {});
+  void ApplyBloom(RenderGraph::TextureHandle target, uint32_t passes, float strength, float width, RenderGraph::TextureHandle scratchTexture);
+
+  // Resolves the particles, adds bloom, tonemaps and writes the swapchain in one pass, so the particles
+  // are never blended into sceneColor and there's no LDR image to blit
+  void ResolveBloomAndPresent(RenderGraph::TextureHandle sceneColor, const std::array<RenderGraph::TextureHandle, 3>& particleImages);
 
   Resources* _resources;
+  std::unique_ptr<GpuProfiler> _profiler;
+  std::unique_ptr<TransientUploadAllocator> _uploads;
+  std::unique_ptr<RenderGraph> _graph;
+  std::unique_ptr<DynamicResolution> _dynamicResolution;
 };
\ No newline at end of file
@@ -0,0 +1,156 @@
+#include "TransientUploadAllocator.h"
+#include "GAssert.h"
+#include <glad/gl.h>
+#include <algorithm>
+#include <bit>
+
+namespace
+{
+  constexpr GLbitfield MAP_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+  // past this, big one-off uploads keep getting dedicated buffers instead of growing the ring forever
+  constexpr size_t MAX_FRAME_CAPACITY = 64 << 20;
+
+  void WaitAndDelete(void* fence)
+  {
+    if (!fence)
+    {
+      return;
+    }
+
+    const auto sync = static_cast<GLsync>(fence);
+    while (true)
+    {
+      const GLenum status = glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1'000'000'000);
+      if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED || status == GL_WAIT_FAILED)
+      {
+        break;
+      }
+    }
+    glDeleteSync(sync);
+  }
+
+  size_t AlignUp(size_t value, size_t alignment)
+  {
+    return (value + alignment - 1) / alignment * alignment;
+  }
+}
+
+TransientUploadAllocator::TransientUploadAllocator(size_t frameCapacity, uint32_t framesInFlight)
+  : _regions(framesInFlight)
+{
+  G_ASSERT(frameCapacity > 0 && framesInFlight > 0);
+
+  GLint uniformAlignment{};
+  GLint storageAlignment{};
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+  glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+  _alignment = std::max<size_t>({ static_cast<size_t>(uniformAlignment), static_cast<size_t>(storageAlignment), 16 });
+
+  CreateRing(frameCapacity);
+}
+
+TransientUploadAllocator::~TransientUploadAllocator()
+{
+  for (auto& region : _regions)
+  {
+    WaitAndDelete(region.fence);
+    region.fence = nullptr;
+    if (!region.overflowBuffers.empty())
+    {
+      glDeleteBuffers(static_cast<GLsizei>(region.overflowBuffers.size()), region.overflowBuffers.data());
+    }
+  }
+
+  DestroyRing();
+}
+
+TransientUploadAllocator::Allocation TransientUploadAllocator::Allocate(size_t size)
+{
+  // zero-sized bindings are invalid, so always hand out something
+  size = std::max<size_t>(size, 4);
+  _frameUsage += AlignUp(size, _alignment);
+
+  const size_t offset = AlignUp(_head, _alignment);
+  if (offset + size <= _frameCapacity)
+  {
+    _head = offset + size;
+    const size_t ringOffset = _currentRegion * _frameCapacity + offset;
+    return Allocation{ .buffer = _buffer, .offset = ringOffset, .size = size, .data = _mapped + ringOffset };
+  }
+
+  GLuint buffer{};
+  glCreateBuffers(1, &buffer);
+  glNamedBufferStorage(buffer, static_cast<GLsizeiptr>(size), nullptr, MAP_FLAGS);
+  auto* data = static_cast<std::byte*>(glMapNamedBufferRange(buffer, 0, static_cast<GLsizeiptr>(size), MAP_FLAGS));
+  G_ASSERT(data);
+  _regions[_currentRegion].overflowBuffers.push_back(buffer);
+  return Allocation{ .buffer = buffer, .offset = 0, .size = size, .data = data };
+}
+
+void TransientUploadAllocator::EndFrame()
+{
+  auto& current = _regions[_currentRegion];
+  G_ASSERT(current.fence == nullptr);
+  current.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+  // this frame overflowed, so make room for it in the ring. This has to wait for every region, but it's rare
+  const bool grow = _frameUsage > _frameCapacity && _frameCapacity < MAX_FRAME_CAPACITY;
+  if (grow)
+  {
+    for (auto& region : _regions)
+    {
+      WaitAndDelete(region.fence);
+      region.fence = nullptr;
+    }
+
+    DestroyRing();
+    CreateRing(std::min(std::bit_ceil(_frameUsage), MAX_FRAME_CAPACITY));
+  }
+
+  _currentRegion = (_currentRegion + 1) % _regions.size();
+  _head = 0;
+  _frameUsage = 0;
+
+  auto& next = _regions[_currentRegion];
+  WaitAndDelete(next.fence);
+  next.fence = nullptr;
+  if (!next.overflowBuffers.empty())
+  {
+    glDeleteBuffers(static_cast<GLsizei>(next.overflowBuffers.size()), next.overflowBuffers.data());
+    next.overflowBuffers.clear();
+  }
+}
+
+void TransientUploadAllocator::BindStorageBuffer(uint32_t index, const Allocation& allocation)
+{
+  glBindBufferRange(GL_SHADER_STORAGE_BUFFER, index, allocation.buffer, static_cast<GLintptr>(allocation.offset), static_cast<GLsizeiptr>(allocation.size));
+}
+
+void TransientUploadAllocator::BindUniformBuffer(uint32_t index, const Allocation& allocation)
+{
+  glBindBufferRange(GL_UNIFORM_BUFFER, index, allocation.buffer, static_cast<GLintptr>(allocation.offset), static_cast<GLsizeiptr>(allocation.size));
+}
+
+void TransientUploadAllocator::BindVertexBuffer(uint32_t bindingIndex, const Allocation& allocation, size_t stride)
+{
+  glBindVertexBuffer(bindingIndex, allocation.buffer, static_cast<GLintptr>(allocation.offset), static_cast<GLsizei>(stride));
+}
+
+void TransientUploadAllocator::CreateRing(size_t frameCapacity)
+{
+  _frameCapacity = AlignUp(frameCapacity, _alignment);
+  const auto size = static_cast<GLsizeiptr>(_frameCapacity * _regions.size());
+  glCreateBuffers(1, &_buffer);
+  glNamedBufferStorage(_buffer, size, nullptr, MAP_FLAGS);
+  _mapped = static_cast<std::byte*>(glMapNamedBufferRange(_buffer, 0, size, MAP_FLAGS));
+  G_ASSERT(_mapped);
+}
+
+void TransientUploadAllocator::DestroyRing()
+{
+  glUnmapNamedBuffer(_buffer);
+  glDeleteBuffers(1, &_buffer);
+  _buffer = 0;
+  _mapped = nullptr;
+}
\ No newline at end of file
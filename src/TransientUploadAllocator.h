@@ -0,0 +1,85 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+// Hands out short-lived slices of a persistently mapped ring buffer for data that is uploaded once and read by
+// the GPU in the same frame, like per-draw instance data and uniforms.
+// The ring is split into one region per frame in flight, each guarded by a fence, so writing never stalls
+// the GPU and steady-state frames don't create any buffers.
+// Allocations are valid until the EndFrame call that closes the frame they were made in.
+class TransientUploadAllocator
+{
+public:
+  struct Allocation
+  {
+    uint32_t buffer; // GL buffer name
+    size_t offset;
+    size_t size;
+    std::byte* data; // write the contents here before the GPU uses them
+  };
+
+  explicit TransientUploadAllocator(size_t frameCapacity = 1 << 20, uint32_t framesInFlight = 3);
+  ~TransientUploadAllocator();
+
+  TransientUploadAllocator(const TransientUploadAllocator&) = delete;
+  TransientUploadAllocator(TransientUploadAllocator&&) = delete;
+  TransientUploadAllocator& operator=(const TransientUploadAllocator&) = delete;
+  TransientUploadAllocator& operator=(TransientUploadAllocator&&) = delete;
+
+  // The offset is aligned for binding as a uniform or storage buffer.
+  // Requests that don't fit this frame's region get a dedicated buffer, and the ring grows at the end of the frame.
+  Allocation Allocate(size_t size);
+
+  template<typename T>
+    requires std::is_trivially_copyable_v<T>
+  Allocation Upload(std::span<const T> data)
+  {
+    auto allocation = Allocate(data.size_bytes());
+    std::memcpy(allocation.data, data.data(), data.size_bytes());
+    return allocation;
+  }
+
+  template<typename T>
+    requires std::is_trivially_copyable_v<T>
+  Allocation Upload(const T& data)
+  {
+    return Upload(std::span<const T>(&data, 1));
+  }
+
+  // Fences everything allocated since the last call, then waits until the next region is no longer in use.
+  // The wait only blocks if the GPU is more than framesInFlight frames behind.
+  void EndFrame();
+
+  // Fwog's binding commands only take Fwog::Buffer, so these bind the allocation directly.
+  static void BindStorageBuffer(uint32_t index, const Allocation& allocation);
+  static void BindUniformBuffer(uint32_t index, const Allocation& allocation);
+
+  // Call after binding the graphics pipeline, since it binds the vertex array this modifies.
+  static void BindVertexBuffer(uint32_t bindingIndex, const Allocation& allocation, size_t stride);
+
+private:
+  struct Region
+  {
+    void* fence = nullptr; // GLsync
+    std::vector<uint32_t> overflowBuffers; // deleted once the fence signals
+  };
+
+  void CreateRing(size_t frameCapacity);
+  void DestroyRing();
+
+  size_t _frameCapacity = 0;
+  size_t _alignment = 256;
+  uint32_t _buffer = 0;
+  std::byte* _mapped = nullptr;
+
+  std::vector<Region> _regions;
+  uint32_t _currentRegion = 0;
+  size_t _head = 0; // offset into the current region
+
+  // the most this frame asked for, which decides how much the ring grows
+  size_t _frameUsage = 0;
+};
\ No newline at end of file
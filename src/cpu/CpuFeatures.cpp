@@ -0,0 +1,81 @@
+#include "cpu/CpuFeatures.h"
+#include <cstdint>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#define CPU_FEATURES_X86 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#define CPU_FEATURES_X86 1
+#endif
+
+namespace cpu
+{
+  namespace
+  {
+#ifdef CPU_FEATURES_X86
+    void Cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4])
+    {
+#ifdef _MSC_VER
+      int r[4]{};
+      __cpuidex(r, static_cast<int>(leaf), static_cast<int>(subleaf));
+      for (int i = 0; i < 4; i++) regs[i] = static_cast<uint32_t>(r[i]);
+#else
+      __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+    }
+
+    uint64_t Xgetbv()
+    {
+#ifdef _MSC_VER
+      return _xgetbv(0);
+#else
+      uint32_t eax{};
+      uint32_t edx{};
+      __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+      return (uint64_t(edx) << 32) | eax;
+#endif
+    }
+#endif
+
+    bool DetectAvx2()
+    {
+#ifdef CPU_FEATURES_X86
+      uint32_t regs[4]{};
+      Cpuid(0, 0, regs);
+      if (regs[0] < 7)
+      {
+        return false;
+      }
+
+      Cpuid(1, 0, regs);
+      const bool fma = regs[2] & (1u << 12);
+      const bool osxsave = regs[2] & (1u << 27);
+      const bool avx = regs[2] & (1u << 28);
+      const bool f16c = regs[2] & (1u << 29);
+      if (!(fma && osxsave && avx && f16c))
+      {
+        return false;
+      }
+
+      // the OS must preserve XMM and YMM state across context switches
+      if ((Xgetbv() & 0b110) != 0b110)
+      {
+        return false;
+      }
+
+      Cpuid(7, 0, regs);
+      return regs[1] & (1u << 5);
+#else
+      return false;
+#endif
+    }
+  }
+
+  bool HasAvx2()
+  {
+    static const bool hasAvx2 = DetectAvx2();
+    return hasAvx2;
+  }
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+
+// Kernels that use AVX2 are compiled for x86 targets only, with CPU_TARGET_AVX2 on each function that uses it.
+// Enabling it per function rather than for a whole file means inline functions from headers, which the linker may
+// pick from any file, are never compiled with instructions that the host might not have.
+// MSVC allows the intrinsics in any function, so it doesn't need the attribute
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define CPU_AVX2_KERNELS 1
+#endif
+
+#if defined(CPU_AVX2_KERNELS) && (defined(__GNUC__) || defined(__clang__))
+#define CPU_TARGET_AVX2 __attribute__((target("avx2,fma,f16c")))
+#else
+#define CPU_TARGET_AVX2
+#endif
+
+namespace cpu
+{
+  // True if the host supports AVX2, FMA, and F16C, and the OS saves YMM state.
+  // The result is computed once and cached.
+  bool HasAvx2();
+}
\ No newline at end of file
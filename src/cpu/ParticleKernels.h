@@ -0,0 +1,42 @@
+#pragma once
+#include "cpu/ParticleSimulation.h"
+#include <cstdint>
+
+// Kernels used by cpu::ParticleSimulation. Not meant to be included anywhere else.
+namespace cpu::detail
+{
+  struct UpdateKernelParams
+  {
+    ParticleUpdateParams uniforms;
+
+    // wall bounds, precomputed the same way the shader computes them
+    const float* wallMinX;
+    const float* wallMinY;
+    const float* wallMaxX;
+    const float* wallMaxY;
+    uint32_t numWalls;
+  };
+
+  // Output of a kernel invocation over [begin, end).
+  // aliveIndices and deadIndices must have room for end - begin elements.
+  struct UpdateKernelResult
+  {
+    int32_t* aliveIndices;
+    int32_t* deadIndices;
+    uint32_t numAlive;
+    uint32_t numDead;
+  };
+
+  void UpdateParticlesScalar(const ParticleSimulation::Arrays& particles,
+                             const UpdateKernelParams& params,
+                             uint32_t begin,
+                             uint32_t end,
+                             UpdateKernelResult& result);
+
+  // Only call this if HasAvx2() returns true.
+  void UpdateParticlesAvx2(const ParticleSimulation::Arrays& particles,
+                           const UpdateKernelParams& params,
+                           uint32_t begin,
+                           uint32_t end,
+                           UpdateKernelResult& result);
+}
\ No newline at end of file
@@ -0,0 +1,172 @@
+// The functions in this file use AVX2, FMA, and F16C (see CPU_TARGET_AVX2).
+// They must only be called after checking cpu::HasAvx2().
+#include "cpu/ParticleKernels.h"
+#include "cpu/CpuFeatures.h"
+#include <bit>
+
+#if defined(CPU_AVX2_KERNELS)
+#include <immintrin.h>
+
+namespace cpu::detail
+{
+  namespace
+  {
+    CPU_TARGET_AVX2 __m256 LoadHalf(const uint16_t* p)
+    {
+      return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    }
+
+    CPU_TARGET_AVX2 void StoreHalf(uint16_t* p, __m256 v)
+    {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+    }
+
+    void AppendIndices(int32_t* out, uint32_t& count, uint32_t base, uint32_t mask)
+    {
+      while (mask)
+      {
+        out[count++] = static_cast<int32_t>(base + std::countr_zero(mask));
+        mask &= mask - 1;
+      }
+    }
+  }
+
+  CPU_TARGET_AVX2 void UpdateParticlesAvx2(const ParticleSimulation::Arrays& p,
+                           const UpdateKernelParams& params,
+                           uint32_t begin,
+                           uint32_t end,
+                           UpdateKernelResult& result)
+  {
+    const auto& u = params.uniforms;
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 dt = _mm256_set1_ps(u.dt);
+    const __m256 drag = _mm256_set1_ps(1.0f / (1.0f + (u.dt * u.friction)));
+    const __m256 cursorX = _mm256_set1_ps(u.cursorPosition.x);
+    const __m256 cursorY = _mm256_set1_ps(u.cursorPosition.y);
+    const __m256 magnetism = _mm256_set1_ps(u.magnetism);
+    const __m256 minDistance = _mm256_set1_ps(u.accelerationMinDistance);
+    const __m256 accelConstant = _mm256_set1_ps(u.accelerationConstant);
+    const bool useAccelConstant = u.accelerationConstant != 0;
+
+    uint32_t i = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+      __m256 lifetime = _mm256_loadu_ps(p.lifetime + i);
+      const __m256 active = _mm256_cmp_ps(lifetime, zero, _CMP_GT_OQ);
+      const uint32_t activeMask = static_cast<uint32_t>(_mm256_movemask_ps(active));
+
+      // most of the pool is usually dead
+      if (activeMask == 0)
+      {
+        continue;
+      }
+
+      __m256 posX = _mm256_loadu_ps(p.positionX + i);
+      __m256 posY = _mm256_loadu_ps(p.positionY + i);
+      const __m256 oldVelX = LoadHalf(p.velocityX + i);
+      const __m256 oldVelY = LoadHalf(p.velocityY + i);
+      __m256 emissiveR = LoadHalf(p.emissiveR + i);
+      __m256 emissiveG = LoadHalf(p.emissiveG + i);
+      __m256 emissiveB = LoadHalf(p.emissiveB + i);
+      __m256 emissiveA = LoadHalf(p.emissiveA + i);
+
+      __m256 velX = _mm256_mul_ps(oldVelX, drag);
+      __m256 velY = _mm256_mul_ps(oldVelY, drag);
+
+      const __m256 toCursorX = _mm256_sub_ps(cursorX, posX);
+      const __m256 toCursorY = _mm256_sub_ps(cursorY, posY);
+      const __m256 distance = _mm256_sqrt_ps(_mm256_fmadd_ps(toCursorX, toCursorX, _mm256_mul_ps(toCursorY, toCursorY)));
+      const __m256 accelMagnitude = useAccelConstant ? accelConstant : _mm256_div_ps(magnetism, _mm256_max_ps(distance, minDistance));
+      const __m256 accelScale = _mm256_div_ps(accelMagnitude, distance);
+      const __m256 accelX = _mm256_mul_ps(accelScale, toCursorX);
+      const __m256 accelY = _mm256_mul_ps(accelScale, toCursorY);
+
+      // visualize velocity magnitude
+      const __m256 fresh = _mm256_cmp_ps(lifetime, one, _CMP_GT_OQ);
+      {
+        const __m256 visX = _mm256_mul_ps(velX, _mm256_set1_ps(1.4f));
+        const __m256 visY = _mm256_mul_ps(velY, _mm256_set1_ps(1.4f));
+        const __m256 speed = _mm256_sqrt_ps(_mm256_fmadd_ps(visX, visX, _mm256_mul_ps(visY, visY)));
+        emissiveA = _mm256_blendv_ps(emissiveA, speed, fresh);
+      }
+
+      velX = _mm256_fmadd_ps(accelX, dt, velX);
+      velY = _mm256_fmadd_ps(accelY, dt, velY);
+
+      // the effect of a hit doesn't depend on which wall was hit, so we only need to know if any wall was hit
+      __m256 hit = zero;
+      for (uint32_t w = 0; w < params.numWalls; w++)
+      {
+        const __m256 inside = _mm256_and_ps(
+          _mm256_and_ps(_mm256_cmp_ps(posX, _mm256_set1_ps(params.wallMinX[w]), _CMP_GT_OQ),
+                        _mm256_cmp_ps(posY, _mm256_set1_ps(params.wallMinY[w]), _CMP_GT_OQ)),
+          _mm256_and_ps(_mm256_cmp_ps(posX, _mm256_set1_ps(params.wallMaxX[w]), _CMP_LT_OQ),
+                        _mm256_cmp_ps(posY, _mm256_set1_ps(params.wallMaxY[w]), _CMP_LT_OQ)));
+        hit = _mm256_or_ps(hit, inside);
+        if (static_cast<uint32_t>(_mm256_movemask_ps(hit)) == 0xFF)
+        {
+          break;
+        }
+      }
+      hit = _mm256_and_ps(hit, active);
+
+      if (_mm256_movemask_ps(hit))
+      {
+        emissiveR = _mm256_blendv_ps(emissiveR, _mm256_set1_ps(40.0f), hit);
+        emissiveG = _mm256_blendv_ps(emissiveG, _mm256_set1_ps(0.4f), hit);
+        emissiveB = _mm256_blendv_ps(emissiveB, _mm256_set1_ps(0.4f), hit);
+        emissiveA = _mm256_blendv_ps(emissiveA, zero, hit);
+
+        const __m256 bounce = _mm256_and_ps(hit, fresh);
+        const __m256 kick = _mm256_mul_ps(dt, _mm256_set1_ps(3.0f));
+        lifetime = _mm256_blendv_ps(lifetime, one, bounce);
+        posX = _mm256_blendv_ps(posX, _mm256_fmadd_ps(velX, kick, posX), bounce);
+        posY = _mm256_blendv_ps(posY, _mm256_fmadd_ps(velY, kick, posY), bounce);
+        velX = _mm256_blendv_ps(velX, _mm256_mul_ps(velX, _mm256_set1_ps(-1.5f)), bounce);
+        velY = _mm256_blendv_ps(velY, _mm256_mul_ps(velY, _mm256_set1_ps(-1.5f)), bounce);
+      }
+
+      // inactive lanes keep their old values; half -> float -> half is lossless
+      posX = _mm256_blendv_ps(posX, _mm256_fmadd_ps(velX, dt, posX), active);
+      posY = _mm256_blendv_ps(posY, _mm256_fmadd_ps(velY, dt, posY), active);
+      velX = _mm256_blendv_ps(oldVelX, velX, active);
+      velY = _mm256_blendv_ps(oldVelY, velY, active);
+      lifetime = _mm256_blendv_ps(lifetime, _mm256_sub_ps(lifetime, dt), active);
+
+      _mm256_storeu_ps(p.positionX + i, posX);
+      _mm256_storeu_ps(p.positionY + i, posY);
+      StoreHalf(p.velocityX + i, velX);
+      StoreHalf(p.velocityY + i, velY);
+      StoreHalf(p.emissiveR + i, emissiveR);
+      StoreHalf(p.emissiveG + i, emissiveG);
+      StoreHalf(p.emissiveB + i, emissiveB);
+      StoreHalf(p.emissiveA + i, emissiveA);
+      _mm256_storeu_ps(p.lifetime + i, lifetime);
+
+      const uint32_t deadMask = activeMask & static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(lifetime, zero, _CMP_LE_OQ)));
+      AppendIndices(result.deadIndices, result.numDead, i, deadMask);
+      AppendIndices(result.aliveIndices, result.numAlive, i, activeMask & ~deadMask);
+    }
+
+    // remainder
+    UpdateParticlesScalar(p, params, i, end, result);
+  }
+}
+
+#else
+
+namespace cpu::detail
+{
+  // AVX2 is not available for this target, so HasAvx2() is false and this is never reached
+  void UpdateParticlesAvx2(const ParticleSimulation::Arrays& p,
+                           const UpdateKernelParams& params,
+                           uint32_t begin,
+                           uint32_t end,
+                           UpdateKernelResult& result)
+  {
+    UpdateParticlesScalar(p, params, begin, end, result);
+  }
+}
+
+#endif
\ No newline at end of file
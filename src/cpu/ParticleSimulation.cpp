@@ -0,0 +1,402 @@
+#include "cpu/ParticleSimulation.h"
+#include "cpu/ParticleKernels.h"
+#include "cpu/CpuFeatures.h"
+#include "JobSystem.h"
+#include <glm/geometric.hpp>
+#include <glm/gtc/packing.hpp>
+#include <glm/common.hpp>
+#include <glm/integer.hpp>
+#include <glm/packing.hpp>
+#include <glm/vector_relational.hpp>
+#include <cmath>
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+
+namespace cpu
+{
+  namespace
+  {
+    // small enough to balance well across cores, big enough to amortize scheduling
+    constexpr uint32_t CHUNK_SIZE = 1 << 14;
+
+    // these match the functions of the same name in EmitParticles.comp.glsl
+    glm::vec2 Hammersley(uint32_t i, uint32_t N)
+    {
+      return glm::vec2(float(i) / float(N), float(glm::bitfieldReverse(i)) * 2.3283064365386963e-10f);
+    }
+
+    uint32_t Hash(uint32_t x)
+    {
+      x ^= x >> 16;
+      x *= 0x7feb352du;
+      x ^= x >> 15;
+      x *= 0x846ca68bu;
+      x ^= x >> 16;
+      return x;
+    }
+  }
+
+  namespace detail
+  {
+    void UpdateParticlesScalar(const ParticleSimulation::Arrays& p,
+                               const UpdateKernelParams& params,
+                               uint32_t begin,
+                               uint32_t end,
+                               UpdateKernelResult& result)
+    {
+      const auto& u = params.uniforms;
+      const float drag = 1.0f / (1.0f + (u.dt * u.friction));
+      static const uint16_t hitR = glm::packHalf1x16(40.0f);
+      static const uint16_t hitG = glm::packHalf1x16(0.4f);
+      static const uint16_t hitB = glm::packHalf1x16(0.4f);
+      static const uint16_t hitA = glm::packHalf1x16(0.0f);
+
+      for (uint32_t i = begin; i < end; i++)
+      {
+        float lifetime = p.lifetime[i];
+
+        // dead particles are left untouched
+        if (!(lifetime > 0.0f))
+        {
+          continue;
+        }
+
+        glm::vec2 position = { p.positionX[i], p.positionY[i] };
+        glm::vec2 velocity = glm::vec2(glm::unpackHalf1x16(p.velocityX[i]), glm::unpackHalf1x16(p.velocityY[i])) * drag;
+        glm::vec2 toCursor = u.cursorPosition - position;
+        float distance = glm::length(toCursor);
+        float accelMagnitude = u.magnetism / std::max(u.accelerationMinDistance, distance);
+        if (u.accelerationConstant != 0)
+        {
+          accelMagnitude = u.accelerationConstant;
+        }
+        glm::vec2 acceleration = accelMagnitude * (toCursor / distance);
+
+        // visualize velocity magnitude
+        if (lifetime > 1)
+        {
+          p.emissiveA[i] = glm::packHalf1x16(glm::length(velocity * 1.4f));
+        }
+
+        velocity += acceleration * u.dt;
+
+        for (uint32_t w = 0; w < params.numWalls; w++)
+        {
+          if (position.x > params.wallMinX[w] && position.y > params.wallMinY[w] &&
+              position.x < params.wallMaxX[w] && position.y < params.wallMaxY[w])
+          {
+            p.emissiveR[i] = hitR;
+            p.emissiveG[i] = hitG;
+            p.emissiveB[i] = hitB;
+            p.emissiveA[i] = hitA;
+
+            if (lifetime > 1)
+            {
+              lifetime = 1;
+              position += velocity * u.dt * 3.0f;
+              velocity = -velocity * 1.5f;
+            }
+            break;
+          }
+        }
+
+        position += velocity * u.dt;
+        lifetime -= u.dt;
+
+        p.positionX[i] = position.x;
+        p.positionY[i] = position.y;
+        p.velocityX[i] = glm::packHalf1x16(velocity.x);
+        p.velocityY[i] = glm::packHalf1x16(velocity.y);
+        p.lifetime[i] = lifetime;
+
+        if (lifetime <= 0.0f)
+        {
+          result.deadIndices[result.numDead++] = static_cast<int32_t>(i);
+        }
+        else
+        {
+          result.aliveIndices[result.numAlive++] = static_cast<int32_t>(i);
+        }
+      }
+    }
+  }
+
+  ParticleSimulation::ParticleSimulation(JobSystem* jobs, uint32_t maxParticles)
+    : _jobs(jobs)
+  {
+    Reset(maxParticles);
+  }
+
+  void ParticleSimulation::Reset(uint32_t maxParticles)
+  {
+    _maxParticles = maxParticles;
+
+    // zeroed particles have no lifetime, so they start out dead
+    _positionX.assign(maxParticles, 0.0f);
+    _positionY.assign(maxParticles, 0.0f);
+    _velocityX.assign(maxParticles, 0);
+    _velocityY.assign(maxParticles, 0);
+    _emissiveR.assign(maxParticles, 0);
+    _emissiveG.assign(maxParticles, 0);
+    _emissiveB.assign(maxParticles, 0);
+    _emissiveA.assign(maxParticles, 0);
+    _lifetime.assign(maxParticles, 0.0f);
+
+    // same initial order as the GPU, so slots are handed out from the top
+    _tombstones.resize(maxParticles);
+    std::iota(_tombstones.begin(), _tombstones.end(), 0);
+    _numTombstones = maxParticles;
+
+    _renderIndices.resize(maxParticles);
+    _numRenderIndices = 0;
+
+    _scratchAlive.resize(maxParticles);
+    _scratchDead.resize(maxParticles);
+
+    _chunks.clear();
+    for (uint32_t begin = 0; begin < maxParticles; begin += CHUNK_SIZE)
+    {
+      _chunks.push_back(Chunk{ .begin = begin, .end = std::min(begin + CHUNK_SIZE, maxParticles) });
+    }
+  }
+
+  void ParticleSimulation::Add(std::span<const ecs::Particle> particles)
+  {
+    for (const auto& particle : particles)
+    {
+      // nothing in freelist
+      if (_numTombstones == 0)
+      {
+        return;
+      }
+
+      const auto index = _tombstones[--_numTombstones];
+      _positionX[index] = particle.position.x;
+      _positionY[index] = particle.position.y;
+      _velocityX[index] = static_cast<uint16_t>(particle.velocity & 0xFFFF);
+      _velocityY[index] = static_cast<uint16_t>(particle.velocity >> 16);
+      _emissiveR[index] = static_cast<uint16_t>(particle.emissive.x & 0xFFFF);
+      _emissiveG[index] = static_cast<uint16_t>(particle.emissive.x >> 16);
+      _emissiveB[index] = static_cast<uint16_t>(particle.emissive.y & 0xFFFF);
+      _emissiveA[index] = static_cast<uint16_t>(particle.emissive.y >> 16);
+      _lifetime[index] = particle.lifetime;
+    }
+  }
+
+  void ParticleSimulation::Emit(const ecs::EmitParticles& emitter)
+  {
+    // particles that don't fit are dropped, like in Add
+    const uint32_t count = std::min(emitter.count, _numTombstones);
+    const uint32_t top = _numTombstones;
+    _numTombstones -= count;
+
+    const glm::vec2 rotation = glm::vec2(Hash(emitter.seed), Hash(emitter.seed * 0x9e3779b9u)) * 2.3283064365386963e-10f;
+    const uint32_t emissiveRG = glm::packHalf2x16({ emitter.color.r, emitter.color.g });
+    const uint32_t emissiveBA = glm::packHalf2x16({ emitter.color.b, emitter.color.a });
+
+    // slots are handed out from the top of the stack, so the i-th particle takes _tombstones[top - 1 - i]
+    const int32_t* slots = _tombstones.data();
+    _jobs->ParallelFor(count, CHUNK_SIZE, [&](size_t begin, size_t end)
+      {
+        for (auto i = static_cast<uint32_t>(begin); i < end; i++)
+        {
+          // rotate the point set by the seed, wrapping around to stay in (0, 1]
+          glm::vec2 xi = Hammersley(i + 1, emitter.count) + rotation;
+          xi -= glm::vec2(glm::greaterThan(xi, glm::vec2(1.0f)));
+
+          glm::vec2 offset{};
+          if (emitter.shape == ecs::EmitterShape::SQUARE)
+          {
+            offset = (xi * 2.0f - 1.0f) * emitter.radius;
+          }
+          else
+          {
+            const float r = std::sqrt(xi.x) * emitter.radius;
+            const float theta = xi.y * 6.283f;
+            offset = { r * std::cos(theta), r * std::sin(theta) };
+          }
+
+          const glm::vec2 position = glm::clamp(emitter.center + offset, glm::vec2(-1), glm::vec2(1));
+          const auto index = static_cast<uint32_t>(slots[top - 1 - i]);
+          _positionX[index] = position.x;
+          _positionY[index] = position.y;
+          _velocityX[index] = 0;
+          _velocityY[index] = 0;
+          _emissiveR[index] = static_cast<uint16_t>(emissiveRG & 0xFFFF);
+          _emissiveG[index] = static_cast<uint16_t>(emissiveRG >> 16);
+          _emissiveB[index] = static_cast<uint16_t>(emissiveBA & 0xFFFF);
+          _emissiveA[index] = static_cast<uint16_t>(emissiveBA >> 16);
+          _lifetime[index] = emitter.lifetime;
+        }
+      });
+  }
+
+  void ParticleSimulation::Update(const ParticleUpdateParams& params, std::span<const Wall> walls)
+  {
+    const auto substep = ParticleSubstep{ .params = params, .walls = walls };
+    Update(std::span(&substep, 1));
+  }
+
+  void ParticleSimulation::Update(std::span<const ParticleSubstep> substeps)
+  {
+    if (substeps.empty())
+    {
+      return;
+    }
+
+    size_t numBounds = 0;
+    for (const auto& substep : substeps)
+    {
+      numBounds += substep.walls.size() * 4;
+    }
+    _wallBounds.resize(numBounds);
+
+    std::vector<detail::UpdateKernelParams> kernelParams;
+    kernelParams.reserve(substeps.size());
+    float* bounds = _wallBounds.data();
+    for (const auto& substep : substeps)
+    {
+      const auto numWalls = static_cast<uint32_t>(substep.walls.size());
+      float* wallMinX = bounds;
+      float* wallMinY = wallMinX + numWalls;
+      float* wallMaxX = wallMinY + numWalls;
+      float* wallMaxY = wallMaxX + numWalls;
+      bounds += numWalls * 4;
+      for (uint32_t i = 0; i < numWalls; i++)
+      {
+        const auto& wall = substep.walls[i];
+        const glm::vec2 bscl = wall.scale / 2.0f;
+        wallMinX[i] = wall.position.x - bscl.x;
+        wallMinY[i] = wall.position.y - bscl.y;
+        wallMaxX[i] = wall.position.x + bscl.x;
+        wallMaxY[i] = wall.position.y + bscl.y;
+      }
+
+      kernelParams.push_back(detail::UpdateKernelParams
+        {
+          .uniforms = substep.params,
+          .wallMinX = wallMinX,
+          .wallMinY = wallMinY,
+          .wallMaxX = wallMaxX,
+          .wallMaxY = wallMaxY,
+          .numWalls = numWalls,
+        });
+    }
+
+    const auto arrays = MutableData();
+    const bool useAvx2 = HasAvx2();
+    _jobs->ParallelFor(_chunks.size(), 1, [&](size_t first, size_t last)
+      {
+        for (auto& chunk : std::span(_chunks).subspan(first, last - first))
+        {
+          auto result = detail::UpdateKernelResult
+          {
+            .aliveIndices = _scratchAlive.data() + chunk.begin,
+            .deadIndices = _scratchDead.data() + chunk.begin,
+          };
+
+          // a particle dies at most once, so deaths accumulate over substeps, but only the last substep's survivors count
+          for (const auto& params : kernelParams)
+          {
+            result.numAlive = 0;
+            if (useAvx2)
+            {
+              detail::UpdateParticlesAvx2(arrays, params, chunk.begin, chunk.end, result);
+            }
+            else
+            {
+              detail::UpdateParticlesScalar(arrays, params, chunk.begin, chunk.end, result);
+            }
+          }
+
+          chunk.numAlive = result.numAlive;
+          chunk.numDead = result.numDead;
+        }
+      });
+
+    // compact the per-chunk results into the render list and tombstone stack
+    uint32_t numAlive = 0;
+    uint32_t numTombstones = _numTombstones;
+    for (auto& chunk : _chunks)
+    {
+      chunk.aliveOffset = numAlive;
+      chunk.deadOffset = numTombstones;
+      numAlive += chunk.numAlive;
+      numTombstones += chunk.numDead;
+    }
+
+    _jobs->ParallelFor(_chunks.size(), 1, [this](size_t first, size_t last)
+      {
+        for (const auto& chunk : std::span(_chunks).subspan(first, last - first))
+        {
+          std::memcpy(_renderIndices.data() + chunk.aliveOffset, _scratchAlive.data() + chunk.begin, chunk.numAlive * sizeof(int32_t));
+          std::memcpy(_tombstones.data() + chunk.deadOffset, _scratchDead.data() + chunk.begin, chunk.numDead * sizeof(int32_t));
+        }
+      });
+
+    _numRenderIndices = numAlive;
+    _numTombstones = numTombstones;
+  }
+
+  std::span<const int32_t> ParticleSimulation::RenderIndices() const
+  {
+    return std::span(_renderIndices.data(), _numRenderIndices);
+  }
+
+  ecs::Particle ParticleSimulation::GetParticle(uint32_t index) const
+  {
+    return ecs::Particle
+    {
+      .position = { _positionX[index], _positionY[index] },
+      .emissive = { _emissiveR[index] | (uint32_t(_emissiveG[index]) << 16), _emissiveB[index] | (uint32_t(_emissiveA[index]) << 16) },
+      .velocity = _velocityX[index] | (uint32_t(_velocityY[index]) << 16),
+      .lifetime = _lifetime[index],
+    };
+  }
+
+  void ParticleSimulation::GatherRenderable(std::vector<ecs::Particle>& out) const
+  {
+    const auto indices = RenderIndices();
+    out.resize(indices.size());
+    _jobs->ParallelFor(indices.size(), CHUNK_SIZE, [&](size_t begin, size_t end)
+      {
+        for (size_t i = begin; i < end; i++)
+        {
+          out[i] = GetParticle(static_cast<uint32_t>(indices[i]));
+        }
+      });
+  }
+
+  ParticleSimulation::ConstArrays ParticleSimulation::Data() const
+  {
+    return ConstArrays
+    {
+      .positionX = _positionX.data(),
+      .positionY = _positionY.data(),
+      .velocityX = _velocityX.data(),
+      .velocityY = _velocityY.data(),
+      .emissiveR = _emissiveR.data(),
+      .emissiveG = _emissiveG.data(),
+      .emissiveB = _emissiveB.data(),
+      .emissiveA = _emissiveA.data(),
+      .lifetime = _lifetime.data(),
+    };
+  }
+
+  ParticleSimulation::Arrays ParticleSimulation::MutableData()
+  {
+    return Arrays
+    {
+      .positionX = _positionX.data(),
+      .positionY = _positionY.data(),
+      .velocityX = _velocityX.data(),
+      .velocityY = _velocityY.data(),
+      .emissiveR = _emissiveR.data(),
+      .emissiveG = _emissiveG.data(),
+      .emissiveB = _emissiveB.data(),
+      .emissiveA = _emissiveA.data(),
+      .lifetime = _lifetime.data(),
+    };
+  }
+}
\ No newline at end of file
@@ -0,0 +1,144 @@
+#pragma once
+#include "ecs/events/AddParticles.h"
+#include "ecs/events/EmitParticles.h"
+#include <glm/vec2.hpp>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+class JobSystem;
+
+namespace cpu
+{
+  // parameters of one substep of UpdateParticles.comp.glsl
+  struct ParticleUpdateParams
+  {
+    float dt;
+    float magnetism;
+    glm::vec2 cursorPosition;
+    float friction;
+    float accelerationConstant; // 0 = use dynamic acceleration
+    float accelerationMinDistance;
+  };
+
+  // mirrors the Box struct in UpdateParticles.comp.glsl
+  struct Wall
+  {
+    glm::vec2 position;
+    glm::vec2 scale;
+  };
+
+  struct ParticleSubstep
+  {
+    ParticleUpdateParams params;
+    std::span<const Wall> walls;
+  };
+
+  // CPU implementation of the particle simulation in UpdateParticles.comp.glsl and AddParticles.comp.glsl.
+  // Particles are stored as a structure of arrays. Attributes that the GPU stores as packed halves
+  // are stored as raw binary16 values, so they are rounded the same way every tick.
+  // Updates are split into chunks that run on the job system, and use AVX2 when the host supports it.
+  class ParticleSimulation
+  {
+  public:
+    ParticleSimulation(JobSystem* jobs, uint32_t maxParticles);
+
+    ParticleSimulation(const ParticleSimulation&) = delete;
+    ParticleSimulation& operator=(const ParticleSimulation&) = delete;
+
+    // Kills every particle and resizes the pool.
+    void Reset(uint32_t maxParticles);
+
+    // Copies particles into free slots. Particles that don't fit are dropped, like on the GPU.
+    void Add(std::span<const ecs::Particle> particles);
+
+    // Generates particles in free slots, exactly like EmitParticles.comp.glsl.
+    void Emit(const ecs::EmitParticles& emitter);
+
+    void Update(const ParticleUpdateParams& params, std::span<const Wall> walls);
+
+    // Runs every substep on a chunk of particles before moving on to the next chunk,
+    // so particles are streamed through memory once no matter how many substeps there are.
+    void Update(std::span<const ParticleSubstep> substeps);
+
+    [[nodiscard]] uint32_t MaxParticles() const { return _maxParticles; }
+    [[nodiscard]] uint32_t NumParticles() const { return _maxParticles - _numTombstones; }
+
+    // Indices of the particles that were alive at the end of the last update, like renderIndices on the GPU.
+    [[nodiscard]] std::span<const int32_t> RenderIndices() const;
+
+    [[nodiscard]] ecs::Particle GetParticle(uint32_t index) const;
+
+    // Writes the particles referenced by RenderIndices() to out, in the same order.
+    void GatherRenderable(std::vector<ecs::Particle>& out) const;
+
+    // Raw attribute arrays. Each has MaxParticles() elements.
+    struct Arrays
+    {
+      float* positionX;
+      float* positionY;
+      uint16_t* velocityX; // binary16
+      uint16_t* velocityY; // binary16
+      uint16_t* emissiveR; // binary16
+      uint16_t* emissiveG; // binary16
+      uint16_t* emissiveB; // binary16
+      uint16_t* emissiveA; // binary16
+      float* lifetime;
+    };
+
+    struct ConstArrays
+    {
+      const float* positionX;
+      const float* positionY;
+      const uint16_t* velocityX;
+      const uint16_t* velocityY;
+      const uint16_t* emissiveR;
+      const uint16_t* emissiveG;
+      const uint16_t* emissiveB;
+      const uint16_t* emissiveA;
+      const float* lifetime;
+    };
+
+    [[nodiscard]] ConstArrays Data() const;
+
+  private:
+    Arrays MutableData();
+
+    // A range of particles updated by one task.
+    // Indices of particles that die or stay alive are written to the same range of the scratch arrays.
+    struct Chunk
+    {
+      uint32_t begin;
+      uint32_t end;
+      uint32_t numAlive;
+      uint32_t numDead;
+      uint32_t aliveOffset; // into _renderIndices
+      uint32_t deadOffset; // into _tombstones
+    };
+
+    JobSystem* _jobs;
+    uint32_t _maxParticles = 0;
+
+    std::vector<float> _positionX;
+    std::vector<float> _positionY;
+    std::vector<uint16_t> _velocityX;
+    std::vector<uint16_t> _velocityY;
+    std::vector<uint16_t> _emissiveR;
+    std::vector<uint16_t> _emissiveG;
+    std::vector<uint16_t> _emissiveB;
+    std::vector<uint16_t> _emissiveA;
+    std::vector<float> _lifetime;
+
+    // When a particle dies, its index gets pushed to this stack
+    std::vector<int32_t> _tombstones;
+    uint32_t _numTombstones = 0;
+
+    std::vector<int32_t> _renderIndices;
+    uint32_t _numRenderIndices = 0;
+
+    std::vector<Chunk> _chunks;
+    std::vector<int32_t> _scratchAlive;
+    std::vector<int32_t> _scratchDead;
+    std::vector<float> _wallBounds; // minX, minY, maxX, maxY, one array after another, for each substep
+  };
+}
\ No newline at end of file
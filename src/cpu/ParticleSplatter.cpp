@@ -0,0 +1,186 @@
+#include "cpu/ParticleSplatter.h"
+#include "GAssert.h"
+#include "JobSystem.h"
+#include <glm/packing.hpp>
+#include <glm/common.hpp>
+#include <algorithm>
+#include <array>
+
+namespace cpu
+{
+  namespace
+  {
+    // A tile of accumulators fits in L2 with room to spare
+    constexpr uint32_t TILE_SIZE = 64;
+
+    // small enough to balance well across cores, big enough to amortize scheduling
+    constexpr uint32_t CHUNK_SIZE = 1 << 14;
+
+    // the fewest pixels resolved by one job
+    constexpr size_t RESOLVE_PIXELS = 1 << 14;
+
+    // these match RenderParticles.comp.glsl
+    bool ToPixel(glm::vec2 position, uint32_t width, uint32_t height, uint32_t& x, uint32_t& y)
+    {
+      // [-1, 1) -> [0, targetDim). Conversion to int truncates, so anything in (-1, 0) lands on the first pixel
+      const float fx = ((position.x + 1.0f) / 2.0f) * static_cast<float>(width);
+      const float fy = ((position.y + 1.0f) / 2.0f) * static_cast<float>(height);
+      if (!(fx > -1.0f && fx < static_cast<float>(width) && fy > -1.0f && fy < static_cast<float>(height)))
+      {
+        return false;
+      }
+
+      x = static_cast<uint32_t>(static_cast<int32_t>(fx));
+      y = static_cast<uint32_t>(static_cast<int32_t>(fy));
+      return true;
+    }
+
+    glm::vec4 QuantizeColor(const ecs::Particle& particle)
+    {
+      auto color = glm::vec4(glm::unpackHalf2x16(particle.emissive.x), glm::unpackHalf2x16(particle.emissive.y));
+      color.b *= color.w;
+      if (particle.lifetime < 1.0f)
+      {
+        color *= particle.lifetime;
+      }
+
+      // negative or enormous colors are undefined on the GPU
+      return glm::clamp(color * 256.0f + 0.5f, 0.0f, 4294967040.0f);
+    }
+  }
+
+  ParticleSplatter::ParticleSplatter(JobSystem* jobs)
+    : _jobs(jobs)
+  {
+    G_ASSERT(_jobs);
+  }
+
+  void ParticleSplatter::Splat(std::span<const ecs::Particle> particles, uint32_t width, uint32_t height)
+  {
+    G_ASSERT(width > 0 && height > 0);
+
+    if (width != _width || height != _height)
+    {
+      _width = width;
+      _height = height;
+      _r.resize(size_t(width) * height);
+      _g.resize(size_t(width) * height);
+      _b.resize(size_t(width) * height);
+      _tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+      _tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    }
+
+    const uint32_t numTiles = _tilesX * _tilesY;
+    const auto count = static_cast<uint32_t>(particles.size());
+    const uint32_t numChunks = std::max(1u, (count + CHUNK_SIZE - 1) / CHUNK_SIZE);
+
+    // count how many splats each chunk has in each tile
+    _tileOffsets.assign(size_t(numChunks) * numTiles, 0);
+    auto tileOf = [this](uint32_t x, uint32_t y)
+    {
+      return (y / TILE_SIZE) * _tilesX + x / TILE_SIZE;
+    };
+
+    _jobs->ParallelFor(numChunks, 1, [&](size_t firstChunk, size_t lastChunk)
+      {
+        for (auto chunk = static_cast<uint32_t>(firstChunk); chunk < lastChunk; chunk++)
+        {
+          uint32_t* counts = _tileOffsets.data() + size_t(chunk) * numTiles;
+          const uint32_t end = std::min(count, (chunk + 1) * CHUNK_SIZE);
+          for (uint32_t i = chunk * CHUNK_SIZE; i < end; i++)
+          {
+            uint32_t x, y;
+            if (ToPixel(particles[i].position, width, height, x, y))
+            {
+              counts[tileOf(x, y)]++;
+            }
+          }
+        }
+      });
+
+    // each tile's splats follow the previous tile's, and within a tile, each chunk's follow the previous chunk's
+    _tileBegins.resize(numTiles + 1);
+    uint32_t offset = 0;
+    for (uint32_t tile = 0; tile < numTiles; tile++)
+    {
+      _tileBegins[tile] = offset;
+      for (uint32_t chunk = 0; chunk < numChunks; chunk++)
+      {
+        offset += std::exchange(_tileOffsets[size_t(chunk) * numTiles + tile], offset);
+      }
+    }
+    _tileBegins[numTiles] = offset;
+    _splats.resize(offset);
+
+    _jobs->ParallelFor(numChunks, 1, [&](size_t firstChunk, size_t lastChunk)
+      {
+        for (auto chunk = static_cast<uint32_t>(firstChunk); chunk < lastChunk; chunk++)
+        {
+          uint32_t* offsets = _tileOffsets.data() + size_t(chunk) * numTiles;
+          const uint32_t end = std::min(count, (chunk + 1) * CHUNK_SIZE);
+          for (uint32_t i = chunk * CHUNK_SIZE; i < end; i++)
+          {
+            uint32_t x, y;
+            if (ToPixel(particles[i].position, width, height, x, y))
+            {
+              const auto color = QuantizeColor(particles[i]);
+              _splats[offsets[tileOf(x, y)]++] = TileSplat
+              {
+                .pixel = (y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE,
+                .r = static_cast<uint32_t>(color.r),
+                .g = static_cast<uint32_t>(color.g),
+                .b = static_cast<uint32_t>(color.b),
+              };
+            }
+          }
+        }
+      });
+
+    // every tile is owned by one job, which accumulates in its own buffer and then writes every pixel of the tile
+    _jobs->ParallelFor(numTiles, 1, [&](size_t firstTile, size_t lastTile)
+      {
+        for (auto tile = static_cast<uint32_t>(firstTile); tile < lastTile; tile++)
+        {
+          std::array<uint32_t, TILE_SIZE * TILE_SIZE> accumR{};
+          std::array<uint32_t, TILE_SIZE * TILE_SIZE> accumG{};
+          std::array<uint32_t, TILE_SIZE * TILE_SIZE> accumB{};
+          for (uint32_t i = _tileBegins[tile]; i < _tileBegins[tile + 1]; i++)
+          {
+            const auto& splat = _splats[i];
+            accumR[splat.pixel] += splat.r;
+            accumG[splat.pixel] += splat.g;
+            accumB[splat.pixel] += splat.b;
+          }
+
+          const uint32_t tileX = (tile % _tilesX) * TILE_SIZE;
+          const uint32_t tileY = (tile / _tilesX) * TILE_SIZE;
+          const uint32_t tileWidth = std::min(TILE_SIZE, width - tileX);
+          const uint32_t tileHeight = std::min(TILE_SIZE, height - tileY);
+          for (uint32_t y = 0; y < tileHeight; y++)
+          {
+            const size_t dst = size_t(tileY + y) * width + tileX;
+            std::copy_n(accumR.data() + y * TILE_SIZE, tileWidth, _r.data() + dst);
+            std::copy_n(accumG.data() + y * TILE_SIZE, tileWidth, _g.data() + dst);
+            std::copy_n(accumB.data() + y * TILE_SIZE, tileWidth, _b.data() + dst);
+          }
+        }
+      });
+  }
+
+  void ParticleSplatter::Resolve(std::span<glm::vec4> out) const
+  {
+    G_ASSERT(out.size() >= _r.size());
+
+    _jobs->ParallelFor(_r.size(), RESOLVE_PIXELS, [this, out](size_t begin, size_t end)
+      {
+        for (size_t i = begin; i < end; i++)
+        {
+          out[i] = glm::vec4(
+            std::min(static_cast<float>(_r[i]) / 256.0f, 64000.0f),
+            std::min(static_cast<float>(_g[i]) / 256.0f, 64000.0f),
+            std::min(static_cast<float>(_b[i]) / 256.0f, 64000.0f),
+            1.0f);
+        }
+      });
+  }
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+#include "ecs/events/AddParticles.h"
+#include <glm/vec4.hpp>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+class JobSystem;
+
+namespace cpu
+{
+  // CPU implementation of RenderParticles.comp.glsl and ResolveParticleImage.frag.glsl.
+  // Produces exactly the fixed-point sums the GPU accumulates in its three R32UI images, since integer addition
+  // doesn't depend on order. Particles are binned by screen tile on the job system, then each tile is accumulated
+  // by one job in its own buffer and copied to the image, so no atomics are needed.
+  class ParticleSplatter
+  {
+  public:
+    explicit ParticleSplatter(JobSystem* jobs);
+
+    // Splats every particle into a width x height image, like the GPU does with targetDim = { width, height }.
+    // Every pixel is overwritten, so the image doesn't need to be cleared between calls.
+    void Splat(std::span<const ecs::Particle> particles, uint32_t width, uint32_t height);
+
+    [[nodiscard]] uint32_t Width() const { return _width; }
+    [[nodiscard]] uint32_t Height() const { return _height; }
+
+    // Each channel is 24.8 fixed point, one row after another, starting with the bottom row like GL images
+    [[nodiscard]] std::span<const uint32_t> R() const { return _r; }
+    [[nodiscard]] std::span<const uint32_t> G() const { return _g; }
+    [[nodiscard]] std::span<const uint32_t> B() const { return _b; }
+
+    // Converts the image to HDR colors like ResolveParticleImage.frag.glsl. out needs Width() * Height() elements
+    void Resolve(std::span<glm::vec4> out) const;
+
+  private:
+    struct TileSplat
+    {
+      uint32_t pixel; // within its tile
+      uint32_t r;
+      uint32_t g;
+      uint32_t b;
+    };
+
+    JobSystem* _jobs;
+    uint32_t _width = 0;
+    uint32_t _height = 0;
+    std::vector<uint32_t> _r;
+    std::vector<uint32_t> _g;
+    std::vector<uint32_t> _b;
+
+    uint32_t _tilesX = 0;
+    uint32_t _tilesY = 0;
+    std::vector<uint32_t> _tileOffsets; // for each chunk, where each tile's splats go. One chunk after another
+    std::vector<uint32_t> _tileBegins; // numTiles + 1 elements
+    std::vector<TileSplat> _splats; // sorted by tile
+  };
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+#include "cpu/PostProcess.h"
+#include <cstddef>
+#include <cstdint>
+
+// Kernels used by cpu::PostProcess. Not meant to be included anywhere else.
+namespace cpu::detail
+{
+  // out[x] = sum of weights[k] * src[indices[k]] over the taps of x, for every x < outWidth
+  void FilterRowScalar(const glm::vec4* src, const PostProcess::FilterTable& table, glm::vec4* out, uint32_t outWidth);
+
+  // out[i] (+)= sum of weights[k] * rows[k][i]
+  void FilterColumnsScalar(const float* const* rows, const float* weights, uint32_t numRows, float* out, size_t count, bool accumulate);
+
+  // srgbTable maps a linear value in [0, 1] times SRGB_TABLE_MAX to its sRGB encoding in 8 bits
+  void TonemapScalar(const glm::vec4* in, uint32_t* out, size_t count, const uint8_t* srgbTable);
+
+  // Only call these if HasAvx2() returns true.
+  void FilterRowAvx2(const glm::vec4* src, const PostProcess::FilterTable& table, glm::vec4* out, uint32_t outWidth);
+  void FilterColumnsAvx2(const float* const* rows, const float* weights, uint32_t numRows, float* out, size_t count, bool accumulate);
+  void TonemapAvx2(const glm::vec4* in, uint32_t* out, size_t count, const uint8_t* srgbTable);
+
+  constexpr uint32_t SRGB_TABLE_MAX = 65535;
+}
\ No newline at end of file
@@ -0,0 +1,131 @@
+// The functions in this file use AVX2, FMA, and F16C (see CPU_TARGET_AVX2).
+// They must only be called after checking cpu::HasAvx2().
+#include "cpu/PostKernels.h"
+#include "cpu/CpuFeatures.h"
+
+#if defined(CPU_AVX2_KERNELS)
+#include <immintrin.h>
+
+namespace cpu::detail
+{
+  // two output pixels per iteration, one in each half of a register
+  CPU_TARGET_AVX2 void FilterRowAvx2(const glm::vec4* src, const PostProcess::FilterTable& table, glm::vec4* out, uint32_t outWidth)
+  {
+    const uint32_t taps = table.taps;
+    uint32_t x = 0;
+    for (; x + 2 <= outWidth; x += 2)
+    {
+      const int32_t* indicesA = table.indices.data() + size_t(x) * taps;
+      const int32_t* indicesB = indicesA + taps;
+      const float* weightsA = table.weights.data() + size_t(x) * taps;
+      const float* weightsB = weightsA + taps;
+
+      __m256 sum = _mm256_setzero_ps();
+      for (uint32_t k = 0; k < taps; k++)
+      {
+        const __m256 texels = _mm256_set_m128(_mm_loadu_ps(&src[indicesB[k]].x), _mm_loadu_ps(&src[indicesA[k]].x));
+        const __m256 weights = _mm256_set_m128(_mm_set1_ps(weightsB[k]), _mm_set1_ps(weightsA[k]));
+        sum = _mm256_fmadd_ps(weights, texels, sum);
+      }
+      _mm256_storeu_ps(&out[x].x, sum);
+    }
+
+    // remainder
+    for (; x < outWidth; x++)
+    {
+      const int32_t* indices = table.indices.data() + size_t(x) * taps;
+      const float* weights = table.weights.data() + size_t(x) * taps;
+      __m128 sum = _mm_setzero_ps();
+      for (uint32_t k = 0; k < taps; k++)
+      {
+        sum = _mm_fmadd_ps(_mm_set1_ps(weights[k]), _mm_loadu_ps(&src[indices[k]].x), sum);
+      }
+      _mm_storeu_ps(&out[x].x, sum);
+    }
+  }
+
+  CPU_TARGET_AVX2 void FilterColumnsAvx2(const float* const* rows, const float* weights, uint32_t numRows, float* out, size_t count, bool accumulate)
+  {
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+      __m256 sum = accumulate ? _mm256_loadu_ps(out + i) : _mm256_setzero_ps();
+      for (uint32_t k = 0; k < numRows; k++)
+      {
+        sum = _mm256_fmadd_ps(_mm256_set1_ps(weights[k]), _mm256_loadu_ps(rows[k] + i), sum);
+      }
+      _mm256_storeu_ps(out + i, sum);
+    }
+
+    // remainder
+    for (; i < count; i++)
+    {
+      float sum = accumulate ? out[i] : 0.0f;
+      for (uint32_t k = 0; k < numRows; k++)
+      {
+        sum += rows[k][i] * weights[k];
+      }
+      out[i] = sum;
+    }
+  }
+
+  // two pixels per iteration. The curve is evaluated in registers, then the sRGB encoding is looked up
+  CPU_TARGET_AVX2 void TonemapAvx2(const glm::vec4* in, uint32_t* out, size_t count, const uint8_t* srgbTable)
+  {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 exposure = _mm256_set1_ps(0.6f);
+    const __m256 a = _mm256_set1_ps(2.51f);
+    const __m256 b = _mm256_set1_ps(0.03f);
+    const __m256 c = _mm256_set1_ps(2.43f);
+    const __m256 d = _mm256_set1_ps(0.59f);
+    const __m256 e = _mm256_set1_ps(0.14f);
+    const __m256 tableScale = _mm256_set1_ps(static_cast<float>(SRGB_TABLE_MAX));
+    const __m256 half = _mm256_set1_ps(0.5f);
+
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2)
+    {
+      const __m256 v = _mm256_mul_ps(_mm256_loadu_ps(&in[i].x), exposure);
+      const __m256 numerator = _mm256_mul_ps(v, _mm256_fmadd_ps(a, v, b));
+      const __m256 denominator = _mm256_fmadd_ps(v, _mm256_fmadd_ps(c, v, d), e);
+
+      // max returns its second operand if either is NaN, so NaN becomes 0 like in the scalar path
+      const __m256 ldr = _mm256_min_ps(_mm256_max_ps(_mm256_div_ps(numerator, denominator), zero), one);
+      alignas(32) uint32_t indices[8];
+      _mm256_store_si256(reinterpret_cast<__m256i*>(indices), _mm256_cvttps_epi32(_mm256_fmadd_ps(ldr, tableScale, half)));
+
+      for (uint32_t p = 0; p < 2; p++)
+      {
+        const uint32_t* rgb = indices + p * 4;
+        out[i + p] = uint32_t(srgbTable[rgb[0]]) | (uint32_t(srgbTable[rgb[1]]) << 8) | (uint32_t(srgbTable[rgb[2]]) << 16) | (255u << 24);
+      }
+    }
+
+    // remainder
+    TonemapScalar(in + i, out + i, count - i, srgbTable);
+  }
+}
+
+#else
+
+namespace cpu::detail
+{
+  // AVX2 is not available for this target, so HasAvx2() is false and these are never reached
+  void FilterRowAvx2(const glm::vec4* src, const PostProcess::FilterTable& table, glm::vec4* out, uint32_t outWidth)
+  {
+    FilterRowScalar(src, table, out, outWidth);
+  }
+
+  void FilterColumnsAvx2(const float* const* rows, const float* weights, uint32_t numRows, float* out, size_t count, bool accumulate)
+  {
+    FilterColumnsScalar(rows, weights, numRows, out, count, accumulate);
+  }
+
+  void TonemapAvx2(const glm::vec4* in, uint32_t* out, size_t count, const uint8_t* srgbTable)
+  {
+    TonemapScalar(in, out, count, srgbTable);
+  }
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,252 @@
+#include "cpu/PostProcess.h"
+#include "cpu/PostKernels.h"
+#include "cpu/CpuFeatures.h"
+#include "GAssert.h"
+#include <glm/common.hpp>
+#include <algorithm>
+#include <cmath>
+#include <execution>
+#include <numeric>
+
+namespace cpu
+{
+  namespace
+  {
+    // few enough rows that a block's horizontally filtered source rows stay in L2
+    constexpr uint32_t ROW_BLOCK_SIZE = 8;
+    constexpr uint32_t MAX_TAPS = 8;
+
+    // DownsampleChain.comp.glsl's 13 taps land between texels, so each one is the average of a 2x2 box.
+    // Half of the filter is a 3x3 tent of boxes spaced two texels apart, and the other half is a 4x4 box
+    constexpr float DOWNSAMPLE_TENT[] = { 1.0f / 8.0f, 1.0f / 8.0f, 2.0f / 8.0f, 2.0f / 8.0f, 1.0f / 8.0f, 1.0f / 8.0f };
+    constexpr int32_t DOWNSAMPLE_TENT_OFFSET = -2;
+    constexpr float DOWNSAMPLE_BOX[] = { 0.25f, 0.25f, 0.25f, 0.25f };
+    constexpr int32_t DOWNSAMPLE_BOX_OFFSET = -1;
+
+    // emulates MIRRORED_REPEAT, which is only reached one or two texels past an edge
+    int32_t Mirror(int32_t i, int32_t n)
+    {
+      i = i < 0 ? -i - 1 : i;
+      i = i >= n ? 2 * n - i - 1 : i;
+      return std::clamp(i, 0, n - 1);
+    }
+
+    // The first level of the chain reads a region of the source that ends before the texture does,
+    // so it's clamped at its far edge instead of mirrored
+    void MakeDownsampleTable(PostProcess::FilterTable& table, uint32_t outSize, uint32_t inSize, std::span<const float> kernel, int32_t offset, bool clampFarEdge)
+    {
+      const auto n = static_cast<int32_t>(inSize);
+      table.taps = static_cast<uint32_t>(kernel.size());
+      table.indices.resize(size_t(outSize) * table.taps);
+      table.weights.resize(size_t(outSize) * table.taps);
+      for (uint32_t o = 0; o < outSize; o++)
+      {
+        for (uint32_t k = 0; k < table.taps; k++)
+        {
+          const int32_t i = 2 * static_cast<int32_t>(o) + offset + static_cast<int32_t>(k);
+          table.indices[o * table.taps + k] = clampFarEdge && i >= n ? n - 1 : Mirror(i, n);
+          table.weights[o * table.taps + k] = kernel[k];
+        }
+      }
+    }
+
+    // Three bilinear taps weighted 1, 2, 1, spaced filterWidth source texels apart
+    // and clamped to the center of the last texel, like Upsample.comp.glsl and UpsampleComposite.comp.glsl
+    void MakeUpsampleTable(PostProcess::FilterTable& table, uint32_t outSize, uint32_t inSize, float filterWidth)
+    {
+      const auto n = static_cast<int32_t>(inSize);
+      const float texel = 1.0f / static_cast<float>(inSize);
+      const float uvMax = 1.0f - 0.5f * texel;
+      table.taps = 6;
+      table.indices.resize(size_t(outSize) * table.taps);
+      table.weights.resize(size_t(outSize) * table.taps);
+      for (uint32_t o = 0; o < outSize; o++)
+      {
+        const float uv = (static_cast<float>(o) + 0.5f) / static_cast<float>(outSize);
+        for (int32_t k = -1; k <= 1; k++)
+        {
+          const float u = std::min(uv + static_cast<float>(k) * filterWidth * texel, uvMax);
+          const float pos = u * static_cast<float>(inSize) - 0.5f;
+          const float base = std::floor(pos);
+          const float f = pos - base;
+          const float weight = k == 0 ? 0.5f : 0.25f;
+          const uint32_t tap = o * table.taps + (k + 1) * 2;
+          table.indices[tap + 0] = Mirror(static_cast<int32_t>(base), n);
+          table.indices[tap + 1] = Mirror(static_cast<int32_t>(base) + 1, n);
+          table.weights[tap + 0] = weight * (1.0f - f);
+          table.weights[tap + 1] = weight * f;
+        }
+      }
+    }
+
+    std::vector<uint8_t> MakeSrgbTable()
+    {
+      std::vector<uint8_t> table(detail::SRGB_TABLE_MAX + 1);
+      for (uint32_t i = 0; i <= detail::SRGB_TABLE_MAX; i++)
+      {
+        const double linear = double(i) / detail::SRGB_TABLE_MAX;
+        const double srgb = linear < 0.0031308 ? linear * 12.92 : 1.055 * std::pow(linear, 1.0 / 2.4) - 0.055;
+        table[i] = static_cast<uint8_t>(std::clamp(srgb * 255.0 + 0.5, 0.0, 255.0));
+      }
+      return table;
+    }
+
+    float Aces(float v)
+    {
+      v *= 0.6f;
+      const float x = (v * (2.51f * v + 0.03f)) / (v * (2.43f * v + 0.59f) + 0.14f);
+      return x > 0.0f ? std::min(x, 1.0f) : 0.0f; // NaN becomes 0
+    }
+  }
+
+  namespace detail
+  {
+    void FilterRowScalar(const glm::vec4* src, const PostProcess::FilterTable& table, glm::vec4* out, uint32_t outWidth)
+    {
+      const int32_t* indices = table.indices.data();
+      const float* weights = table.weights.data();
+      for (uint32_t x = 0; x < outWidth; x++)
+      {
+        auto sum = glm::vec4(0);
+        for (uint32_t k = 0; k < table.taps; k++)
+        {
+          sum += src[indices[k]] * weights[k];
+        }
+        out[x] = sum;
+        indices += table.taps;
+        weights += table.taps;
+      }
+    }
+
+    void FilterColumnsScalar(const float* const* rows, const float* weights, uint32_t numRows, float* out, size_t count, bool accumulate)
+    {
+      for (size_t i = 0; i < count; i++)
+      {
+        float sum = accumulate ? out[i] : 0.0f;
+        for (uint32_t k = 0; k < numRows; k++)
+        {
+          sum += rows[k][i] * weights[k];
+        }
+        out[i] = sum;
+      }
+    }
+
+    void TonemapScalar(const glm::vec4* in, uint32_t* out, size_t count, const uint8_t* srgbTable)
+    {
+      auto encode = [srgbTable](float v)
+      {
+        return static_cast<uint32_t>(srgbTable[static_cast<uint32_t>(Aces(v) * SRGB_TABLE_MAX + 0.5f)]);
+      };
+
+      for (size_t i = 0; i < count; i++)
+      {
+        out[i] = encode(in[i].r) | (encode(in[i].g) << 8) | (encode(in[i].b) << 16) | (255u << 24);
+      }
+    }
+  }
+
+  void PostProcess::Resample(Image src, Image dst, const FilterTable& columns, const FilterTable& rows, float scale, bool accumulate)
+  {
+    G_ASSERT(columns.indices.size() == size_t(dst.width) * columns.taps);
+    G_ASSERT(rows.indices.size() == size_t(dst.height) * rows.taps);
+    G_ASSERT(rows.taps <= MAX_TAPS);
+
+    const bool useAvx2 = HasAvx2();
+    _rowBlocks.resize((dst.height + ROW_BLOCK_SIZE - 1) / ROW_BLOCK_SIZE);
+    std::iota(_rowBlocks.begin(), _rowBlocks.end(), 0u);
+    std::for_each(std::execution::par, _rowBlocks.begin(), _rowBlocks.end(), [&](uint32_t block)
+      {
+        const uint32_t rowBegin = block * ROW_BLOCK_SIZE;
+        const uint32_t rowEnd = std::min(dst.height, rowBegin + ROW_BLOCK_SIZE);
+
+        // filter every source row this block reads horizontally, once
+        const auto [firstRow, lastRow] = std::minmax_element(rows.indices.begin() + size_t(rowBegin) * rows.taps,
+                                                             rows.indices.begin() + size_t(rowEnd) * rows.taps);
+        thread_local std::vector<glm::vec4> filtered;
+        filtered.resize(size_t(*lastRow - *firstRow + 1) * dst.width);
+        for (int32_t row = *firstRow; row <= *lastRow; row++)
+        {
+          const auto* srcRow = src.data + size_t(row) * src.width;
+          auto* filteredRow = filtered.data() + size_t(row - *firstRow) * dst.width;
+          useAvx2 ? detail::FilterRowAvx2(srcRow, columns, filteredRow, dst.width)
+                  : detail::FilterRowScalar(srcRow, columns, filteredRow, dst.width);
+        }
+
+        for (uint32_t y = rowBegin; y < rowEnd; y++)
+        {
+          const float* rowPointers[MAX_TAPS];
+          float weights[MAX_TAPS];
+          for (uint32_t k = 0; k < rows.taps; k++)
+          {
+            const auto tap = size_t(y) * rows.taps + k;
+            rowPointers[k] = &filtered[size_t(rows.indices[tap] - *firstRow) * dst.width].x;
+            weights[k] = rows.weights[tap] * scale;
+          }
+
+          auto* dstRow = &dst.data[size_t(y) * dst.width].x;
+          useAvx2 ? detail::FilterColumnsAvx2(rowPointers, weights, rows.taps, dstRow, size_t(dst.width) * 4, accumulate)
+                  : detail::FilterColumnsScalar(rowPointers, weights, rows.taps, dstRow, size_t(dst.width) * 4, accumulate);
+        }
+      });
+  }
+
+  void PostProcess::ApplyBloom(std::span<glm::vec4> image, uint32_t width, uint32_t height, uint32_t passes, float strength, float filterWidth)
+  {
+    G_ASSERT(image.size() >= size_t(width) * height);
+    G_ASSERT_MSG(passes > 0 && width >> passes > 0 && height >> passes > 0, "Bloom target is too small");
+
+    // level i of the chain is half the size of the level before it, like the mips of the GPU's scratch texture
+    const auto target = Image{ width, height, image.data() };
+    _levels.resize(passes);
+    std::vector<Image> levels(passes);
+    for (uint32_t i = 0; i < passes; i++)
+    {
+      levels[i] = Image{ width >> (i + 1), height >> (i + 1) };
+      _levels[i].resize(size_t(levels[i].width) * levels[i].height);
+      levels[i].data = _levels[i].data();
+    }
+
+    for (uint32_t i = 0; i < passes; i++)
+    {
+      const Image source = i == 0 ? target : levels[i - 1];
+      const bool clampFarEdge = i == 0;
+      MakeDownsampleTable(_columns, levels[i].width, source.width, DOWNSAMPLE_TENT, DOWNSAMPLE_TENT_OFFSET, clampFarEdge);
+      MakeDownsampleTable(_rows, levels[i].height, source.height, DOWNSAMPLE_TENT, DOWNSAMPLE_TENT_OFFSET, clampFarEdge);
+      Resample(source, levels[i], _columns, _rows, 0.5f, false);
+
+      MakeDownsampleTable(_columns, levels[i].width, source.width, DOWNSAMPLE_BOX, DOWNSAMPLE_BOX_OFFSET, clampFarEdge);
+      MakeDownsampleTable(_rows, levels[i].height, source.height, DOWNSAMPLE_BOX, DOWNSAMPLE_BOX_OFFSET, clampFarEdge);
+      Resample(source, levels[i], _columns, _rows, 0.5f, true);
+    }
+
+    // add the smaller levels to the first
+    for (uint32_t i = 1; i < passes; i++)
+    {
+      MakeUpsampleTable(_columns, levels[0].width, levels[i].width, filterWidth);
+      MakeUpsampleTable(_rows, levels[0].height, levels[i].height, filterWidth);
+      Resample(levels[i], levels[0], _columns, _rows, 1.0f, true);
+    }
+
+    // and finally, add the result to the target
+    MakeUpsampleTable(_columns, width, levels[0].width, filterWidth);
+    MakeUpsampleTable(_rows, height, levels[0].height, filterWidth);
+    Resample(levels[0], target, _columns, _rows, strength, true);
+  }
+
+  void PostProcess::Tonemap(std::span<const glm::vec4> image, uint32_t width, uint32_t height, std::span<uint32_t> outRgba8)
+  {
+    G_ASSERT(image.size() >= size_t(width) * height && outRgba8.size() >= size_t(width) * height);
+
+    static const auto srgbTable = MakeSrgbTable();
+    const bool useAvx2 = HasAvx2();
+    _rowBlocks.resize((height + ROW_BLOCK_SIZE - 1) / ROW_BLOCK_SIZE);
+    std::iota(_rowBlocks.begin(), _rowBlocks.end(), 0u);
+    std::for_each(std::execution::par, _rowBlocks.begin(), _rowBlocks.end(), [&](uint32_t block)
+      {
+        const size_t begin = size_t(block) * ROW_BLOCK_SIZE * width;
+        const size_t end = std::min<size_t>(size_t(block + 1) * ROW_BLOCK_SIZE, height) * width;
+        useAvx2 ? detail::TonemapAvx2(image.data() + begin, outRgba8.data() + begin, end - begin, srgbTable.data())
+                : detail::TonemapScalar(image.data() + begin, outRgba8.data() + begin, end - begin, srgbTable.data());
+      });
+  }
+}
\ No newline at end of file
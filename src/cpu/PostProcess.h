@@ -0,0 +1,49 @@
+#pragma once
+#include <glm/vec4.hpp>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace cpu
+{
+  // CPU implementation of the post chain: the bloom chain that Renderer::ApplyBloom runs (DownsampleChain.comp.glsl,
+  // UpsampleComposite.comp.glsl and Upsample.comp.glsl), then TonemapAndDither.comp.glsl.
+  // Every filter is split into a horizontal and a vertical pass. Blocks of output rows are filtered on all cores,
+  // each from the few source rows it needs, and the kernels use AVX2 when the host supports it.
+  // Results match the GPU up to its half-float mips when every level of the chain has even dimensions.
+  // Odd dimensions are filtered as if they were one texel larger, which the GPU's bilinear taps don't exactly do.
+  class PostProcess
+  {
+  public:
+    // Adds bloom to a width x height image in place, with the same parameters as Renderer::ApplyBloom
+    void ApplyBloom(std::span<glm::vec4> image, uint32_t width, uint32_t height, uint32_t passes, float strength, float filterWidth);
+
+    // ACES approximation followed by the sRGB transfer function, quantized like the GPU's RGBA8 target.
+    // Alpha is always 255
+    void Tonemap(std::span<const glm::vec4> image, uint32_t width, uint32_t height, std::span<uint32_t> outRgba8);
+
+    // a 1D filter. Each output texel is a weighted sum of the same number of input texels
+    struct FilterTable
+    {
+      uint32_t taps = 0;
+      std::vector<int32_t> indices; // taps for each output texel, one after another
+      std::vector<float> weights;
+    };
+
+  private:
+    struct Image
+    {
+      uint32_t width = 0;
+      uint32_t height = 0;
+      glm::vec4* data = nullptr;
+    };
+
+    // dst (+)= scale * rows(columns(src))
+    void Resample(Image src, Image dst, const FilterTable& columns, const FilterTable& rows, float scale, bool accumulate);
+
+    std::vector<std::vector<glm::vec4>> _levels;
+    std::vector<uint32_t> _rowBlocks;
+    FilterTable _columns;
+    FilterTable _rows;
+  };
+}
\ No newline at end of file
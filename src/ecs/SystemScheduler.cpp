@@ -0,0 +1,248 @@
+#include "SystemScheduler.h"
+#include "ecs/systems/System.h"
+#include "utils/Timer.h"
+#include <imgui.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+namespace ecs
+{
+  bool SystemAccess::ConflictsWith(const SystemAccess& other) const
+  {
+    if (_structural || other._structural || (_mainThread && other._mainThread))
+    {
+      return true;
+    }
+
+    auto overlaps = [](const std::vector<entt::id_type>& a, const std::vector<entt::id_type>& b)
+    {
+      return std::any_of(a.begin(), a.end(), [&b](entt::id_type id) { return std::find(b.begin(), b.end(), id) != b.end(); });
+    };
+
+    return overlaps(_writes, other._writes) || overlaps(_writes, other._reads) || overlaps(_reads, other._writes);
+  }
+
+  SystemScheduler::SystemScheduler(JobSystem& jobs)
+    : _jobs(jobs)
+  {
+  }
+
+  void SystemScheduler::Add(std::string name, System& system)
+  {
+    SystemAccess access;
+    system.DeclareAccess(access);
+    Add(std::move(name), access, [&system](double dt) { system.Update(dt); });
+  }
+
+  void SystemScheduler::Add(std::string name, const SystemAccess& access, std::function<void(double)> update)
+  {
+    const auto index = static_cast<uint32_t>(_nodes.size());
+    auto& node = _nodes.emplace_back(Node{ .name = std::move(name), .access = access, .update = std::move(update) });
+    for (uint32_t i = 0; i < index; i++)
+    {
+      if (_nodes[i].access.ConflictsWith(node.access))
+      {
+        node.dependencies.push_back(i);
+        _nodes[i].dependents.push_back(index);
+      }
+    }
+
+    // names are viewed by the timings, so they're only made once every node is in place
+    _timings.clear();
+    for (const auto& n : _nodes)
+    {
+      _timings.push_back({ .name = n.name });
+    }
+  }
+
+  void SystemScheduler::Run(double dt)
+  {
+    const auto numNodes = static_cast<uint32_t>(_nodes.size());
+    auto remaining = std::make_unique<std::atomic<uint32_t>[]>(numNodes);
+    for (uint32_t i = 0; i < numNodes; i++)
+    {
+      remaining[i].store(static_cast<uint32_t>(_nodes[i].dependencies.size()), std::memory_order_relaxed);
+    }
+
+    // ready systems that must run on this thread
+    std::mutex mainMutex;
+    std::condition_variable mainWake;
+    std::vector<uint32_t> mainReady;
+    std::atomic<uint32_t> numDone = 0;
+    JobSystem::Counter counter;
+    Timer timer;
+
+    // Once a system throws, the rest are skipped but still retired so every job of this frame finishes
+    // before the exception leaves Run
+    std::atomic_flag failed;
+    std::exception_ptr error;
+
+    // the lambda schedules its dependents, so it refers to itself through a function
+    std::function<void(uint32_t)> schedule;
+    auto runNode = [&](uint32_t index)
+    {
+      auto& timing = _timings[index];
+      timing.startMs = timer.Elapsed_ms();
+      if (!failed.test(std::memory_order_relaxed))
+      {
+        try
+        {
+          _nodes[index].update(dt);
+        }
+        catch (...)
+        {
+          if (!failed.test_and_set(std::memory_order_relaxed))
+          {
+            error = std::current_exception();
+          }
+        }
+      }
+      timing.durationMs = timer.Elapsed_ms() - timing.startMs;
+
+      for (auto dependent : _nodes[index].dependents)
+      {
+        if (remaining[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+          schedule(dependent);
+        }
+      }
+
+      if (numDone.fetch_add(1, std::memory_order_acq_rel) + 1 == numNodes)
+      {
+        {
+          auto lock = std::lock_guard(mainMutex);
+        }
+        mainWake.notify_one();
+      }
+    };
+
+    schedule = [&](uint32_t index)
+    {
+      if (_nodes[index].access.IsMainThread())
+      {
+        {
+          auto lock = std::lock_guard(mainMutex);
+          mainReady.push_back(index);
+        }
+        mainWake.notify_one();
+      }
+      else
+      {
+        _jobs.Submit(counter, [&runNode, index] { runNode(index); });
+      }
+    };
+
+    for (uint32_t i = 0; i < numNodes; i++)
+    {
+      if (_nodes[i].dependencies.empty())
+      {
+        schedule(i);
+      }
+    }
+
+    while (numDone.load(std::memory_order_acquire) < numNodes)
+    {
+      std::optional<uint32_t> next;
+      {
+        auto lock = std::lock_guard(mainMutex);
+        if (!mainReady.empty())
+        {
+          next = mainReady.back();
+          mainReady.pop_back();
+        }
+      }
+
+      if (next)
+      {
+        runNode(*next);
+      }
+      else if (!_jobs.RunOne())
+      {
+        // the workers are busy with the rest, so sleep until a main thread system is ready or all are done
+        auto lock = std::unique_lock(mainMutex);
+        mainWake.wait(lock, [&] { return !mainReady.empty() || numDone.load(std::memory_order_acquire) == numNodes; });
+      }
+    }
+
+    // jobs decrement the counter after they return, so they may still be referencing this frame
+    _jobs.Wait(counter);
+    _totalMs = timer.Elapsed_ms();
+    FindCriticalPath();
+
+    if (error)
+    {
+      std::rethrow_exception(error);
+    }
+  }
+
+  void SystemScheduler::FindCriticalPath()
+  {
+    // dependencies always come before their dependents, so one pass in order finds the longest chain
+    std::vector<double> finishMs(_nodes.size());
+    std::vector<int32_t> previous(_nodes.size(), -1);
+    int32_t last = -1;
+    for (uint32_t i = 0; i < _nodes.size(); i++)
+    {
+      for (auto dependency : _nodes[i].dependencies)
+      {
+        if (finishMs[dependency] > finishMs[i])
+        {
+          finishMs[i] = finishMs[dependency];
+          previous[i] = static_cast<int32_t>(dependency);
+        }
+      }
+      finishMs[i] += _timings[i].durationMs;
+      _timings[i].critical = false;
+
+      if (last == -1 || finishMs[i] > finishMs[last])
+      {
+        last = static_cast<int32_t>(i);
+      }
+    }
+
+    _criticalPathMs = last == -1 ? 0 : finishMs[last];
+    for (auto i = last; i != -1; i = previous[i])
+    {
+      _timings[i].critical = true;
+    }
+  }
+
+  void SystemScheduler::DrawImGui(bool* open)
+  {
+    ImGui::SetNextWindowSize(ImVec2(420, 0), ImGuiCond_FirstUseEver);
+    if (!ImGui::Begin("Systems", open))
+    {
+      ImGui::End();
+      return;
+    }
+
+    ImGui::Text("Last tick: %.3fms, critical path %.3fms", _totalMs, _criticalPathMs);
+    if (ImGui::BeginTable("systems", 3, ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders))
+    {
+      ImGui::TableSetupColumn("System");
+      ImGui::TableSetupColumn("Start");
+      ImGui::TableSetupColumn("Time");
+      ImGui::TableHeadersRow();
+
+      for (const auto& timing : _timings)
+      {
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::Text("%s%.*s", timing.critical ? "* " : "", static_cast<int>(timing.name.size()), timing.name.data());
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", timing.startMs);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", timing.durationMs);
+      }
+
+      ImGui::EndTable();
+    }
+
+    ImGui::End();
+  }
+}
\ No newline at end of file
@@ -0,0 +1,119 @@
+#pragma once
+#include "JobSystem.h"
+#include <entt/core/type_info.hpp>
+#include <entt/fwd.hpp>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace ecs
+{
+  class System;
+
+  // The components a system reads and writes, named like the entt views it uses
+  class SystemAccess
+  {
+  public:
+    template<typename... Components>
+    SystemAccess& Read()
+    {
+      (_reads.push_back(entt::type_hash<Components>::value()), ...);
+      return *this;
+    }
+
+    template<typename... Components>
+    SystemAccess& Write()
+    {
+      (_writes.push_back(entt::type_hash<Components>::value()), ...);
+      return *this;
+    }
+
+    // Creating or destroying entities, or adding or removing components, changes storage that other views may be using
+    SystemAccess& Structural()
+    {
+      _structural = true;
+      return *this;
+    }
+
+    // for systems that use the GL context or anything else that only the main thread may touch
+    SystemAccess& MainThread()
+    {
+      _mainThread = true;
+      return *this;
+    }
+
+    [[nodiscard]] bool ConflictsWith(const SystemAccess& other) const;
+    [[nodiscard]] bool IsMainThread() const { return _mainThread; }
+
+  private:
+    std::vector<entt::id_type> _reads;
+    std::vector<entt::id_type> _writes;
+    bool _structural = false;
+    bool _mainThread = false;
+  };
+
+  // Calls fn(std::span<const entt::entity>) for chunks of the entities in view on the job system.
+  // fn may only touch the components its system declared
+  template<typename View, typename Fn>
+  void ParallelEach(JobSystem& jobs, const View& view, size_t minChunkSize, Fn&& fn)
+  {
+    const std::vector<entt::entity> entities(view.begin(), view.end());
+    jobs.ParallelFor(entities.size(), minChunkSize, [&](size_t begin, size_t end)
+    {
+      fn(std::span<const entt::entity>(entities.data() + begin, end - begin));
+    });
+  }
+
+  // Runs systems in the order they were added, except that systems whose accesses don't conflict may run at the same
+  // time on the job system. Systems that must be on the main thread run on the thread that calls Run.
+  class SystemScheduler
+  {
+  public:
+    struct Timing
+    {
+      std::string_view name;
+      double startMs = 0; // since Run was called
+      double durationMs = 0;
+      bool critical = false; // on the chain of dependent systems that took longest
+    };
+
+    explicit SystemScheduler(JobSystem& jobs);
+
+    SystemScheduler(const SystemScheduler&) = delete;
+    SystemScheduler& operator=(const SystemScheduler&) = delete;
+
+    // the system's update is System::Update, and its access comes from System::DeclareAccess
+    void Add(std::string name, System& system);
+    void Add(std::string name, const SystemAccess& access, std::function<void(double)> update);
+
+    // every system is done when this returns
+    void Run(double dt);
+
+    // of the last Run, in the order systems were added
+    [[nodiscard]] std::span<const Timing> Timings() const { return _timings; }
+    [[nodiscard]] double CriticalPathMs() const { return _criticalPathMs; }
+    [[nodiscard]] double TotalMs() const { return _totalMs; }
+
+    void DrawImGui(bool* open);
+
+  private:
+    struct Node
+    {
+      std::string name;
+      SystemAccess access;
+      std::function<void(double)> update;
+      std::vector<uint32_t> dependencies; // earlier systems that conflict with this one
+      std::vector<uint32_t> dependents;
+    };
+
+    void FindCriticalPath();
+
+    JobSystem& _jobs;
+    std::vector<Node> _nodes;
+    std::vector<Timing> _timings;
+    double _criticalPathMs = 0;
+    double _totalMs = 0;
+  };
+}
\ No newline at end of file
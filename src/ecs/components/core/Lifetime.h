@@ -2,15 +2,19 @@
 
 namespace ecs
 {
+  // The entity is deleted this long after the component is added. LifetimeSystem doesn't count it down, so
+  // the duration stays as it was added. Replacing or patching the component through the registry restarts
+  // the countdown with the new duration, but writing to it in place has no effect
   struct Lifetime
   {
-    int microsecondsLeft;
+    int durationMicroseconds;
   };
 
   struct DeleteNextTick {};
 
+  // like Lifetime, but counted in ticks
   struct DeleteInNTicks
   {
-    int ticks;
+    int durationTicks;
   };
 }
\ No newline at end of file
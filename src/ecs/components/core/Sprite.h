@@ -1,5 +1,4 @@
 #pragma once
-#include <Fwog/Texture.h>
 #include <cstdint>
 #include <glm/vec4.hpp>
 
@@ -7,7 +6,8 @@ namespace ecs
 {
   struct Sprite
   {
-    const Fwog::Texture* texture; // a 2D texture
+    uint32_t texture; // returned by Renderer::AddSpriteTexture
     glm::u8vec4 tint = { 255, 255, 255, 255 };
+    int16_t order = 0; // higher is drawn on top
   };
 }
\ No newline at end of file
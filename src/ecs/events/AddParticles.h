@@ -1,6 +1,8 @@
 #pragma once
+#include "utils/EventBus.h"
 #include <glm/vec2.hpp>
 #include <span>
+#include <vector>
 
 namespace ecs
 {
@@ -17,4 +19,34 @@ namespace ecs
   {
     std::span<const Particle> particles;
   };
-}
\ No newline at end of file
+}
+
+// Queued particles are copied, since the spans would dangle by the time they're flushed. Every span queued
+// before a flush is coalesced into one, so they're uploaded and dispatched together
+template<>
+class EventQueue<ecs::AddParticles>
+{
+public:
+  void Push(const ecs::AddParticles& e)
+  {
+    m_Particles.insert(m_Particles.end(), e.particles.begin(), e.particles.end());
+  }
+
+  template<typename PublishFn>
+  void Flush(PublishFn&& publish)
+  {
+    if (m_Particles.empty())
+    {
+      return;
+    }
+
+    std::swap(m_Particles, m_Flushing);
+    auto e = ecs::AddParticles{ .particles = m_Flushing };
+    publish(e);
+    m_Flushing.clear();
+  }
+
+private:
+  std::vector<ecs::Particle> m_Particles;
+  std::vector<ecs::Particle> m_Flushing;
+};
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+#include "utils/EventBus.h"
+#include <glm/vec2.hpp>
+#include <glm/vec4.hpp>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace ecs
+{
+  enum class EmitterShape : uint32_t
+  {
+    DISK,   // uniformly distributed over a disk with the given radius
+    SQUARE, // uniformly distributed over a square with the given half-extent
+  };
+
+  // event
+  // Particles are generated where they are simulated (on the GPU for the GPU backend),
+  // so spawning any number of them only uploads this struct.
+  struct EmitParticles
+  {
+    EmitterShape shape = EmitterShape::DISK;
+    uint32_t count = 0;
+    glm::vec2 center = { 0, 0 };
+    float radius = 0.25f;
+    glm::vec4 color = { 1, 1, 1, 1 }; // emissive RGBA
+    float lifetime = 9999;
+    uint32_t seed = 0; // rotates the sample pattern. 0 = no rotation
+  };
+
+  // event
+  // Emitters that are generated together, so the GPU backend needs one upload and dispatch for all of them
+  struct EmitParticleBatch
+  {
+    std::span<const EmitParticles> emitters;
+  };
+}
+
+// Every emitter queued before a flush is published in one EmitParticleBatch
+template<>
+class EventQueue<ecs::EmitParticles>
+{
+public:
+  void Push(const ecs::EmitParticles& e)
+  {
+    m_Emitters.push_back(e);
+  }
+
+  template<typename PublishFn>
+  void Flush(PublishFn&& publish)
+  {
+    if (m_Emitters.empty())
+    {
+      return;
+    }
+
+    std::swap(m_Emitters, m_Flushing);
+    auto e = ecs::EmitParticleBatch{ .emitters = m_Flushing };
+    publish(e);
+    m_Flushing.clear();
+  }
+
+private:
+  std::vector<ecs::EmitParticles> m_Emitters;
+  std::vector<ecs::EmitParticles> m_Flushing;
+};
\ No newline at end of file
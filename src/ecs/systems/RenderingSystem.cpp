@@ -9,9 +9,6 @@
 #include <stb_image.h>
 #include <glm/gtx/matrix_transform_2d.hpp>
 #include <glad/gl.h>
-#include <vector>
-#include <utility>
-#include <algorithm>
 
 namespace ecs
 {
@@ -39,30 +36,30 @@ namespace ecs
   void RenderingSystem::Update([[maybe_unused]] double dt)
   {
     glDisable(GL_FRAMEBUFFER_SRGB);
-    return;
 
     //_renderer->DrawBackground(*_backgroundTexture);
 
-    //std::vector<RenderableSprite> sprites;
+    auto view = _scene->Registry().view<ecs::Transform, ecs::Sprite>();
+    if (view.size_hint() == 0)
+    {
+      return;
+    }
 
-    //auto view = _scene->Registry().view<ecs::Transform, ecs::Sprite>();
+    // size_hint is an upper bound, so only the sprites that were written are drawn
+    auto batch = _renderer->BeginSprites(static_cast<uint32_t>(view.size_hint()));
+    uint32_t count = 0;
+    for (auto&& [_, transform, sprite] : view.each())
+    {
+      batch.instances[count] = SpriteInstance
+      {
+        .transform = glm::scale(glm::rotate(glm::translate(glm::mat3(1), transform.translation), transform.rotation), transform.scale),
+        .tint = sprite.tint,
+        .texture = sprite.texture,
+      };
+      batch.drawOrders[count] = sprite.order;
+      count++;
+    }
 
-    //sprites.reserve(view.size_hint());
-
-    //std::for_each(view.begin(), view.end(),
-    //  [&sprites, view](auto entity)
-    //  {
-    //    const auto&& [transform, sprite] = view.get<ecs::Transform, ecs::Sprite>(entity);
-    //    auto model = glm::mat3x2(1);
-    //    model = glm::scale(glm::rotate(glm::translate(glm::mat3(1), transform.translation), transform.rotation), transform.scale);
-
-    //    sprites.push_back(RenderableSprite{
-    //      .transform = model,
-    //      .texture = sprite.texture,
-    //      .tint = sprite.tint
-    //    });
-    //  });
-
-    //_renderer->DrawSprites(std::move(sprites));
+    _renderer->DrawSprites(batch, count);
   }
 }
\ No newline at end of file
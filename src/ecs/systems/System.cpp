@@ -1,5 +1,6 @@
 #include "System.h"
 #include "ecs/Scene.h"
+#include "ecs/SystemScheduler.h"
 
 namespace ecs
 {
@@ -12,4 +13,9 @@ namespace ecs
   System::~System()
   {
   }
+
+  void System::DeclareAccess(SystemAccess& access) const
+  {
+    access.Structural().MainThread();
+  }
 }
\ No newline at end of file
@@ -6,6 +6,7 @@ class EventBus;
 namespace ecs
 {
   class Scene;
+  class SystemAccess;
 
   // abstract class that all systems should derive from
   class System
@@ -22,6 +23,10 @@ namespace ecs
     virtual void Update(double dt) = 0;
     virtual void Draw() {}
 
+    // Declares the components that Update reads and writes so SystemScheduler knows what it may run alongside.
+    // By default a system may do anything, so it runs alone on the main thread
+    virtual void DeclareAccess(SystemAccess& access) const;
+
   protected:
     Scene* _scene;
     EventBus* _eventBus;
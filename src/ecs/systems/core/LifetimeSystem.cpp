@@ -1,35 +1,127 @@
 #include "LifetimeSystem.h"
 #include <ecs/components/core/Lifetime.h>
 #include <ecs/Scene.h>
+#include <ecs/SystemScheduler.h>
 #include <entt/entity/registry.hpp>
+#include <algorithm>
+#include <type_traits>
 
 namespace ecs
 {
+  namespace
+  {
+    // lifetimes are bucketed by ~1ms. The wheel only expires a timer once its deadline has passed
+    constexpr uint32_t MICROSECOND_RESOLUTION_BITS = 10;
+  }
+
   LifetimeSystem::LifetimeSystem(Scene* scene, EventBus* eventBus)
-    : System(scene, eventBus)
+    : System(scene, eventBus),
+      _lifetimes({ .wheel = TimingWheel<Timer>(MICROSECOND_RESOLUTION_BITS) })
   {
+    auto& registry = _scene->Registry();
+    registry.on_construct<DeleteInNTicks>().connect<&LifetimeSystem::Schedule<DeleteInNTicks>>(this);
+    registry.on_update<DeleteInNTicks>().connect<&LifetimeSystem::Schedule<DeleteInNTicks>>(this);
+    registry.on_destroy<DeleteInNTicks>().connect<&LifetimeSystem::OnRemoved<DeleteInNTicks>>(this);
+    registry.on_construct<Lifetime>().connect<&LifetimeSystem::Schedule<Lifetime>>(this);
+    registry.on_update<Lifetime>().connect<&LifetimeSystem::Schedule<Lifetime>>(this);
+    registry.on_destroy<Lifetime>().connect<&LifetimeSystem::OnRemoved<Lifetime>>(this);
+
+    // components that were added before the system existed start counting now
+    for (auto entity : registry.view<DeleteInNTicks>())
+    {
+      Schedule<DeleteInNTicks>(registry, entity);
+    }
+
+    for (auto entity : registry.view<Lifetime>())
+    {
+      Schedule<Lifetime>(registry, entity);
+    }
   }
 
-  void LifetimeSystem::Update(double dt)
+  LifetimeSystem::~LifetimeSystem()
   {
-    for (auto&& [entity, deleteTicks] : _scene->Registry().view<DeleteInNTicks>().each())
+    auto& registry = _scene->Registry();
+    registry.on_construct<DeleteInNTicks>().disconnect<&LifetimeSystem::Schedule<DeleteInNTicks>>(this);
+    registry.on_update<DeleteInNTicks>().disconnect<&LifetimeSystem::Schedule<DeleteInNTicks>>(this);
+    registry.on_destroy<DeleteInNTicks>().disconnect<&LifetimeSystem::OnRemoved<DeleteInNTicks>>(this);
+    registry.on_construct<Lifetime>().disconnect<&LifetimeSystem::Schedule<Lifetime>>(this);
+    registry.on_update<Lifetime>().disconnect<&LifetimeSystem::Schedule<Lifetime>>(this);
+    registry.on_destroy<Lifetime>().disconnect<&LifetimeSystem::OnRemoved<Lifetime>>(this);
+  }
+
+  void LifetimeSystem::DeclareAccess(SystemAccess& access) const
+  {
+    access.Write<DeleteInNTicks, Lifetime>().Structural();
+  }
+
+  template<typename Component>
+  void LifetimeSystem::Schedule(entt::registry& registry, entt::entity entity)
+  {
+    auto& timed = std::is_same_v<Component, Lifetime> ? _lifetimes : _deleteInTicks;
+    const auto index = entt::to_entity(entity);
+    if (index >= timed.generations.size())
     {
-      if (--deleteTicks.ticks <= 0)
-      {
-        _scene->Registry().emplace<ecs::DeleteNextTick>(entity);
-      }
+      timed.generations.resize(index + 1);
+    }
+
+    const auto generation = ++timed.generations[index];
+    if constexpr (std::is_same_v<Component, Lifetime>)
+    {
+      const auto microseconds = std::max(registry.get<Lifetime>(entity).durationMicroseconds, 0);
+      timed.wheel.Insert(_microseconds + microseconds, { entity, generation });
     }
+    else
+    {
+      const auto ticks = std::max(registry.get<DeleteInNTicks>(entity).durationTicks, 0);
+      timed.wheel.Insert(_ticks + ticks, { entity, generation });
+    }
+  }
 
-    auto deleteView = _scene->Registry().view<DeleteNextTick>();
-    _scene->Registry().destroy(deleteView.begin(), deleteView.end());
+  template<typename Component>
+  void LifetimeSystem::OnRemoved(entt::registry&, entt::entity entity)
+  {
+    auto& timed = std::is_same_v<Component, Lifetime> ? _lifetimes : _deleteInTicks;
+    timed.generations[entt::to_entity(entity)]++;
+  }
 
-    for (auto&& [entity, lifetime] : _scene->Registry().view<Lifetime>().each())
+  void LifetimeSystem::Expire(TimedComponent& timed, uint64_t now, std::vector<entt::entity>& expired)
+  {
+    const auto& registry = _scene->Registry();
+    _due.clear();
+    timed.wheel.Advance(now, _due);
+    for (const auto& timer : _due)
     {
-      lifetime.microsecondsLeft -= static_cast<int>(dt * 1'000'000.0 + 0.5);
-      if (lifetime.microsecondsLeft <= 0)
+      if (registry.valid(timer.entity) && timed.generations[entt::to_entity(timer.entity)] == timer.generation)
       {
-        _scene->Registry().emplace<ecs::DeleteNextTick>(entity);
+        expired.push_back(timer.entity);
       }
     }
   }
+
+  void LifetimeSystem::MarkForDeletion(std::vector<entt::entity>& entities)
+  {
+    auto& registry = _scene->Registry();
+
+    // Entity::Destroy may have marked some already
+    std::erase_if(entities, [&registry](entt::entity entity) { return registry.all_of<DeleteNextTick>(entity); });
+    registry.insert<DeleteNextTick>(entities.begin(), entities.end());
+    entities.clear();
+  }
+
+  void LifetimeSystem::Update(double dt)
+  {
+    auto& registry = _scene->Registry();
+
+    // a component that is added in tick N with a count of 1 expires in tick N + 1, same as counting it down each tick
+    _ticks++;
+    Expire(_deleteInTicks, _ticks, _expired);
+    MarkForDeletion(_expired);
+
+    auto deleteView = registry.view<DeleteNextTick>();
+    registry.destroy(deleteView.begin(), deleteView.end());
+
+    _microseconds += static_cast<uint64_t>(dt * 1'000'000.0 + 0.5);
+    Expire(_lifetimes, _microseconds, _expired);
+    MarkForDeletion(_expired);
+  }
 }
\ No newline at end of file
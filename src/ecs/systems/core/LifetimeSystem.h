@@ -1,15 +1,56 @@
 #pragma once
 #include <ecs/systems/System.h>
+#include "utils/TimingWheel.h"
+#include <entt/entity/entity.hpp>
+#include <cstdint>
+#include <vector>
 
 namespace ecs
 {
+  // Lifetime and DeleteInNTicks are counted from when they're added or last replaced. Their entities are kept in
+  // timing wheels, so an update only touches the ones that expire
   class LifetimeSystem : public System
   {
   public:
     LifetimeSystem(Scene* scene, EventBus* eventBus);
+    ~LifetimeSystem();
 
     void Update(double dt) override;
+    void DeclareAccess(SystemAccess& access) const override;
 
   private:
+    struct Timer
+    {
+      entt::entity entity;
+      uint32_t generation;
+    };
+
+    struct TimedComponent
+    {
+      TimingWheel<Timer> wheel;
+
+      // By entity index. Bumped whenever the component is added, replaced or removed, so timers that were
+      // made for an earlier component are ignored rather than searched for and removed
+      std::vector<uint32_t> generations;
+    };
+
+    // (re)starts the component's timer from now
+    template<typename Component>
+    void Schedule(entt::registry& registry, entt::entity entity);
+
+    template<typename Component>
+    void OnRemoved(entt::registry& registry, entt::entity entity);
+
+    // appends the entities whose timers came due by now and are still current
+    void Expire(TimedComponent& timed, uint64_t now, std::vector<entt::entity>& expired);
+
+    void MarkForDeletion(std::vector<entt::entity>& entities);
+
+    TimedComponent _deleteInTicks;
+    TimedComponent _lifetimes;
+    uint64_t _ticks = 0;
+    uint64_t _microseconds = 0;
+    std::vector<Timer> _due;
+    std::vector<entt::entity> _expired;
   };
 }
\ No newline at end of file
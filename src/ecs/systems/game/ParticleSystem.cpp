@@ -1,17 +1,24 @@
 #include "ParticleSystem.h"
 #include "Renderer.h"
+#include "AsyncReadback.h"
+#include "GpuProfiler.h"
+#include "TransientUploadAllocator.h"
+#include "PipelineCache.h"
 #include "ecs/Scene.h"
 #include "ecs/Entity.h"
-#include "utils/LoadFile.h"
-#include <glm/packing.hpp>
+#include "ecs/SystemScheduler.h"
+#include "cpu/ParticleSimulation.h"
+#include "GAssert.h"
 #include <glm/glm.hpp>
 #include <entt/entity/registry.hpp>
-#include <Fwog/Shader.h>
 #include <Fwog/Rendering.h>
 #include <vector>
 #include <glad/gl.h>
 #include <algorithm>
 #include <cmath>
+#include <numeric>
+#include <utility>
+#include <cstring>
 
 #include <iostream>
 
@@ -19,35 +26,140 @@ namespace ecs
 {
   namespace
   {
+    // same layout as the Uniforms block in UpdateParticles.comp.glsl
     struct Uniforms
     {
-      float dt;
       float magnetism;
-      glm::vec2 cursorPosition;
       float friction;
       float accelerationConstant;
       float accelerationMinDistance;
+      uint32_t numSubsteps;
+      uint32_t numWalls;
+      uint32_t _padding[2];
+      glm::vec4 substeps[ParticleSystem::MAX_SUBSTEPS]; // xy = cursor position, z = dt
     };
+
+    // same layout as the Emitter struct in EmitParticles.comp.glsl
+    struct GpuEmitter
+    {
+      glm::vec4 color;
+      glm::vec2 center;
+      float radius;
+      float lifetime;
+      uint32_t count;
+      uint32_t shape;
+      uint32_t seed;
+      uint32_t firstParticle; // of the dispatch
+    };
+
+    // same layout as the Uniforms block in EmitParticles.comp.glsl
+    struct EmitUniforms
+    {
+      uint32_t numEmitters;
+      uint32_t numParticles;
+    };
+
+    using Box = cpu::Wall;
+
+    // keep in sync with UpdateParticles.comp.glsl
+    constexpr int WALL_GRID_SIZE = 16;
+
+    struct WallTile
+    {
+      uint32_t offset;
+      uint32_t count;
+    };
+
+    struct WallBounds
+    {
+      glm::vec2 boundsMin;
+      glm::vec2 boundsMax;
+    };
+
+    // same as WallTileIndex in the shader, for one axis
+    int WallTileCoord(float x)
+    {
+      return std::clamp(static_cast<int>(std::floor((x + 1.0f) * (WALL_GRID_SIZE / 2.0f))), 0, WALL_GRID_SIZE - 1);
+    }
+
+    // Sorts walls into a grid of tiles over [-1, 1]. Each tile references every wall that overlaps it.
+    // sweptBounds should cover a wall's bounds in every substep.
+    void BinWalls(std::span<const WallBounds> sweptBounds, std::vector<WallTile>& tiles, std::vector<uint32_t>& wallIndices)
+    {
+      // a little slack so a particle can't land in a tile the wall wasn't binned into due to rounding
+      constexpr float slack = 1e-4f;
+
+      tiles.assign(WALL_GRID_SIZE * WALL_GRID_SIZE, WallTile{});
+
+      auto forEachTile = [&tiles](const WallBounds& b, auto&& func)
+      {
+        for (int y = WallTileCoord(b.boundsMin.y - slack); y <= WallTileCoord(b.boundsMax.y + slack); y++)
+        {
+          for (int x = WallTileCoord(b.boundsMin.x - slack); x <= WallTileCoord(b.boundsMax.x + slack); x++)
+          {
+            func(tiles[y * WALL_GRID_SIZE + x]);
+          }
+        }
+      };
+
+      for (const auto& b : sweptBounds)
+      {
+        forEachTile(b, [](WallTile& tile) { tile.count++; });
+      }
+
+      uint32_t offset = 0;
+      for (auto& tile : tiles)
+      {
+        tile.offset = offset;
+        offset += tile.count;
+        tile.count = 0;
+      }
+
+      wallIndices.resize(offset);
+      for (uint32_t i = 0; i < sweptBounds.size(); i++)
+      {
+        forEachTile(sweptBounds[i], [&](WallTile& tile) { wallIndices[tile.offset + tile.count++] = i; });
+      }
+    }
   }
 
-  ParticleSystem::ParticleSystem(Scene* scene, EventBus* eventBus, Renderer* renderer)
-    : System(scene, eventBus), _renderer(renderer)
+  ParticleSystem::ParticleSystem(Scene* scene, EventBus* eventBus, Renderer* renderer, JobSystem* jobs, ParticleBackend backend)
+    : System(scene, eventBus), _renderer(renderer), _jobs(jobs), _backend(backend)
   {
+    G_ASSERT_MSG(_renderer || _backend == ParticleBackend::CPU, "The GPU backend needs a renderer");
+    G_ASSERT_MSG(_jobs || _backend == ParticleBackend::GPU, "The CPU backend needs a job system");
+
     Reset(true, 5'000'000);
 
-    auto update = Fwog::Shader(Fwog::PipelineStage::COMPUTE_SHADER, LoadFile("assets/shaders/particles/UpdateParticles.comp.glsl"));
-    auto add = Fwog::Shader(Fwog::PipelineStage::COMPUTE_SHADER, LoadFile("assets/shaders/particles/AddParticles.comp.glsl"));
-    
-    _particleUpdate = Fwog::CompileComputePipeline({ .shader = &update });
-    _particleAdd = Fwog::CompileComputePipeline({ .shader = &add });
+    if (_backend == ParticleBackend::GPU)
+    {
+      auto pipelines = PipelineCache();
+      _particleUpdate = pipelines.AddCompute("assets/shaders/particles/UpdateParticles.comp.glsl");
+      _particleAdd = pipelines.AddCompute("assets/shaders/particles/AddParticles.comp.glsl");
+      _particleEmit = pipelines.AddCompute("assets/shaders/particles/EmitParticles.comp.glsl");
+      _writeDispatchArgs = pipelines.AddCompute("assets/shaders/particles/WriteDispatchArgs.comp.glsl");
+      pipelines.Build();
+
+      _statsReadback = std::make_unique<AsyncReadback>(sizeof(int32_t));
+    }
 
     _eventBus->Subscribe(this, &ParticleSystem::HandleParticleAdd);
+    _eventBus->Subscribe(this, &ParticleSystem::HandleParticleEmit);
+    _eventBus->Subscribe(this, &ParticleSystem::HandleParticleEmitBatch);
     _eventBus->Subscribe(this, &ParticleSystem::HandleMousePosition);
   }
 
+  ParticleSystem::~ParticleSystem()
+  {
+  }
+
   void ParticleSystem::Reset(bool hard, uint32_t maxParticles)
   {
     MAX_PARTICLES = maxParticles;
+    _substeps.clear();
+    _substepWalls.clear();
+    _flushedCursor = { cursorX, cursorY };
+
     // reset to default
     if (hard)
     {
@@ -57,6 +169,35 @@ namespace ecs
       accelerationMinDistance = 1.0f;
     }
 
+    if (_backend == ParticleBackend::CPU)
+    {
+      if (_cpuSimulation)
+      {
+        _cpuSimulation->Reset(MAX_PARTICLES);
+      }
+      else
+      {
+        _cpuSimulation = std::make_unique<cpu::ParticleSimulation>(_jobs, MAX_PARTICLES);
+      }
+
+      // the renderer consumes a dense copy of the live particles every frame, so the render list is always 0..n-1
+      if (_renderer)
+      {
+        std::vector<int32_t> renderIndices(MAX_PARTICLES + 1);
+        std::iota(renderIndices.begin() + 1, renderIndices.end(), 0);
+        _particles = std::make_unique<Fwog::Buffer>(sizeof(Particle) * MAX_PARTICLES, Fwog::BufferStorageFlag::DYNAMIC_STORAGE);
+        _renderIndices = std::make_unique<Fwog::Buffer>(std::span(renderIndices), Fwog::BufferStorageFlag::DYNAMIC_STORAGE);
+      }
+      return;
+    }
+
+    // counts of the old buffers are meaningless now
+    if (_statsReadback)
+    {
+      _statsReadback->Discard();
+    }
+    _statsValidFrame = _frameIndex;
+
     _particles = std::make_unique<Fwog::Buffer>(sizeof(Particle) * MAX_PARTICLES, Fwog::BufferStorageFlag::NONE);
     // +1 for int
     std::vector<int> tombstones;
@@ -69,99 +210,180 @@ namespace ecs
 
     _tombstones = std::make_unique<Fwog::Buffer>(std::span(tombstones), Fwog::BufferStorageFlag::NONE);
     _renderIndices = std::make_unique<Fwog::Buffer>(sizeof(uint32_t) * (MAX_PARTICLES + 1), Fwog::BufferStorageFlag::NONE);
-    _uniforms = std::make_unique<Fwog::Buffer>(sizeof(Uniforms), Fwog::BufferStorageFlag::DYNAMIC_STORAGE);
+    _renderIndicesNext = std::make_unique<Fwog::Buffer>(sizeof(uint32_t) * (MAX_PARTICLES + 1), Fwog::BufferStorageFlag::NONE);
+    _updateDispatchArgs = std::make_unique<Fwog::Buffer>(sizeof(uint32_t) * 3, Fwog::BufferStorageFlag::NONE);
 
     constexpr int32_t zero = 0;
     _particles->ClearSubData(0, _particles->Size(), Fwog::Format::R32_SINT, Fwog::UploadFormat::R, Fwog::UploadType::SINT, &zero);
     _renderIndices->ClearSubData(0, sizeof(int32_t), Fwog::Format::R32_SINT, Fwog::UploadFormat::R, Fwog::UploadType::SINT, &zero);
+    _renderIndicesNext->ClearSubData(0, sizeof(int32_t), Fwog::Format::R32_SINT, Fwog::UploadFormat::R, Fwog::UploadType::SINT, &zero);
   }
 
   void ParticleSystem::Update(double dt)
   {
-    struct Box
-    {
-      glm::vec2 position;
-      glm::vec2 scale;
-    };
+    Substep(dt);
+    Flush();
+  }
+
+  void ParticleSystem::DeclareAccess(SystemAccess& access) const
+  {
+    access.Read<ecs::DebugBox>().MainThread();
+  }
+
+  void ParticleSystem::Substep(double dt)
+  {
     auto viewBox = _scene->Registry().view<ecs::DebugBox>();
     std::vector<Box> boxes;
     boxes.reserve(viewBox.size());
     for (auto&& [_, box] : viewBox.each()) if (box.active) boxes.push_back({ box.translation, box.scale });
-    auto boxBuffer = Fwog::Buffer(std::span(boxes));
 
-    // make boxes that are "about to spawn" flicker in some way
-    auto viewBoxLife = _scene->Registry().view<ecs::DebugBox, ecs::Flicker>();
-    std::vector<ecs::Entity> removeFlickerList;
-    for (auto&& [entity, box, flicker] : viewBoxLife.each())
+    // substeps in a batch must have the same number of walls
+    if (_substeps.size() == MAX_SUBSTEPS || (!_substeps.empty() && boxes.size() != _substepNumWalls))
     {
-      flicker.timeLeft -= dt;
-      glm::vec4 emissive = {};
-      emissive.r = static_cast<float>(200 * (1 + sin(flicker.timeLeft * 4.0 * 3.1415) / 2));
-      emissive.g = static_cast<float>(200 * (1 + sin(flicker.timeLeft * 4.0 * 3.1415) / 2));
-      emissive = glm::mix(emissive, glm::vec4(200, 0, 0, 0), float(1.0 - flicker.timeLeft / 3.0));
+      Flush();
+    }
 
-      if (flicker.timeLeft <= 0)
-      {
-        emissive.r = 200;
-        emissive.g = 0;
-        removeFlickerList.push_back(Entity(entity, _scene));
-        box.active = true;
-      }
-      box.color16f.x = glm::packHalf2x16(glm::vec2(emissive));
-      //box.color16f.y = glm::packHalf2x16(glm::vec2(emissive));
+    _substeps.push_back({ .dt = static_cast<float>(dt), .cursor = { cursorX, cursorY } });
+    _substepWalls.insert(_substepWalls.end(), boxes.begin(), boxes.end());
+    _substepNumWalls = boxes.size();
+  }
+
+  void ParticleSystem::Flush()
+  {
+    if (_substeps.empty())
+    {
+      return;
     }
 
-    for (auto&& entity : removeFlickerList)
+    // the cursor is only polled once per frame, so spread its movement over the substeps
+    const auto numSubsteps = static_cast<uint32_t>(_substeps.size());
+    const auto numWalls = static_cast<uint32_t>(_substepNumWalls);
+    std::vector<glm::vec2> cursors(numSubsteps);
+    for (uint32_t i = 0; i < numSubsteps; i++)
     {
-      entity.RemoveComponents<ecs::Flicker>();
+      cursors[i] = glm::mix(_flushedCursor, _substeps[i].cursor, float(i + 1) / numSubsteps);
     }
+    _flushedCursor = _substeps.back().cursor;
 
-    auto viewBoxMove = _scene->Registry().view<ecs::DebugBox, ecs::Movement>();
-    for (auto&& [_, box, move] : viewBoxMove.each())
+    if (_backend == ParticleBackend::CPU)
     {
-      move.accum += dt;
-      move.accum = std::fmod(move.accum, move.period);
-      if (move.accum / (move.period / 2.0) < 1.0)
+      std::vector<cpu::ParticleSubstep> substeps;
+      substeps.reserve(numSubsteps);
+      for (uint32_t i = 0; i < numSubsteps; i++)
       {
-        box.translation = glm::mix(move.posA, move.posB, move.accum / (move.period / 2.0));
+        substeps.push_back(cpu::ParticleSubstep
+          {
+            .params =
+            {
+              .dt = _substeps[i].dt,
+              .magnetism = magnetism,
+              .cursorPosition = cursors[i],
+              .friction = friction,
+              .accelerationConstant = accelerationConstant,
+              .accelerationMinDistance = accelerationMinDistance,
+            },
+            .walls = std::span(_substepWalls).subspan(i * numWalls, numWalls),
+          });
+      }
+      _cpuSimulation->Update(substeps);
+      _substeps.clear();
+      _substepWalls.clear();
+      return;
+    }
+
+    // bounds are computed exactly like the old per-particle test did
+    std::vector<WallBounds> wallBounds(std::max(numSubsteps * numWalls, 1u));
+    std::vector<WallBounds> sweptBounds(numWalls);
+    for (uint32_t i = 0; i < numSubsteps * numWalls; i++)
+    {
+      const auto& wall = _substepWalls[i];
+      const glm::vec2 bscl = wall.scale / 2.0f;
+      wallBounds[i] = { wall.position - bscl, wall.position + bscl };
+
+      auto& swept = sweptBounds[i % numWalls];
+      if (i < numWalls)
+      {
+        swept = wallBounds[i];
       }
       else
       {
-        box.translation = glm::mix(move.posA, move.posB, 2 - move.accum / (move.period / 2.0));
+        swept.boundsMin = glm::min(swept.boundsMin, wallBounds[i].boundsMin);
+        swept.boundsMax = glm::max(swept.boundsMax, wallBounds[i].boundsMax);
       }
     }
 
-    Fwog::BeginCompute("Update particles");
+    std::vector<WallTile> wallTiles;
+    std::vector<uint32_t> wallIndices;
+    BinWalls(sweptBounds, wallTiles, wallIndices);
+    auto& uploads = _renderer->Uploads();
+    const size_t wallTilesSize = wallTiles.size() * sizeof(WallTile);
+    const auto wallBins = uploads.Allocate(wallTilesSize + wallIndices.size() * sizeof(uint32_t));
+    std::memcpy(wallBins.data, wallTiles.data(), wallTilesSize);
+    if (!wallIndices.empty())
     {
-      Fwog::Cmd::BindComputePipeline(_particleUpdate);
-      Fwog::Cmd::BindStorageBuffer(0, *_particles, 0, _particles->Size());
-      Fwog::Cmd::BindStorageBuffer(1, *_tombstones, 0, _tombstones->Size());
-      Fwog::Cmd::BindStorageBuffer(2, *_renderIndices, 0, _renderIndices->Size());
-      Fwog::Cmd::BindStorageBuffer(3, boxBuffer, 0, boxBuffer.Size());
-      Fwog::Cmd::BindUniformBuffer(0, *_uniforms, 0, _uniforms->Size());
+      std::memcpy(wallBins.data + wallTilesSize, wallIndices.data(), wallIndices.size() * sizeof(uint32_t));
+    }
+    const auto wallBoundsUpload = uploads.Upload(std::span(std::as_const(wallBounds)));
 
+    Fwog::BeginCompute("Update particles");
+    {
+      auto zone = _renderer->Profiler().Scope("Update particles");
       Uniforms uniforms
       {
-        .dt = static_cast<float>(dt),
         .magnetism = magnetism,
-        .cursorPosition = { cursorX, cursorY },
         .friction = friction,
         .accelerationConstant = accelerationConstant,
         .accelerationMinDistance = accelerationMinDistance,
+        .numSubsteps = numSubsteps,
+        .numWalls = numWalls,
       };
-      _uniforms->SubData(uniforms, 0);
+      for (uint32_t i = 0; i < numSubsteps; i++)
+      {
+        uniforms.substeps[i] = { cursors[i], _substeps[i].dt, 0 };
+      }
+      const auto uniformsUpload = uploads.Upload(uniforms);
+
+      // only live particles are updated, so size the dispatch from their count
+      Fwog::Cmd::BindComputePipeline(_writeDispatchArgs);
+      Fwog::Cmd::BindStorageBuffer(0, *_renderIndices, 0, _renderIndices->Size());
+      Fwog::Cmd::BindStorageBuffer(1, *_updateDispatchArgs, 0, _updateDispatchArgs->Size());
+      Fwog::Cmd::MemoryBarrier(Fwog::MemoryBarrierAccessBit::SHADER_STORAGE_BIT);
+      Fwog::Cmd::Dispatch(1, 1, 1);
+
+      Fwog::Cmd::BindComputePipeline(_particleUpdate);
+      Fwog::Cmd::BindStorageBuffer(0, *_particles, 0, _particles->Size());
+      Fwog::Cmd::BindStorageBuffer(1, *_tombstones, 0, _tombstones->Size());
+      Fwog::Cmd::BindStorageBuffer(2, *_renderIndices, 0, _renderIndices->Size());
+      Fwog::Cmd::BindStorageBuffer(3, *_renderIndicesNext, 0, _renderIndicesNext->Size());
+      TransientUploadAllocator::BindStorageBuffer(4, wallBins);
+      TransientUploadAllocator::BindStorageBuffer(5, wallBoundsUpload);
+      TransientUploadAllocator::BindUniformBuffer(0, uniformsUpload);
 
-      uint32_t workgroups = (MAX_PARTICLES + 511) / 512;
-      Fwog::Cmd::MemoryBarrier(Fwog::MemoryBarrierAccessBit::SHADER_STORAGE_BIT | Fwog::MemoryBarrierAccessBit::UNIFORM_BUFFER_BIT);
       constexpr int32_t zero = 0;
-      _renderIndices->ClearSubData(0, sizeof(int32_t), Fwog::Format::R32_SINT, Fwog::UploadFormat::R, Fwog::UploadType::SINT, &zero);
-      Fwog::Cmd::Dispatch(workgroups, 1, 1);
+      _renderIndicesNext->ClearSubData(0, sizeof(int32_t), Fwog::Format::R32_SINT, Fwog::UploadFormat::R, Fwog::UploadType::SINT, &zero);
+      Fwog::Cmd::MemoryBarrier(Fwog::MemoryBarrierAccessBit::SHADER_STORAGE_BIT |
+                               Fwog::MemoryBarrierAccessBit::UNIFORM_BUFFER_BIT |
+                               Fwog::MemoryBarrierAccessBit::COMMAND_BUFFER_BIT);
+      Fwog::Cmd::DispatchIndirect(*_updateDispatchArgs, 0);
     }
     Fwog::EndCompute();
+
+    // the survivors are what gets rendered and updated next
+    std::swap(_renderIndices, _renderIndicesNext);
+
+    _substeps.clear();
+    _substepWalls.clear();
   }
 
   void ParticleSystem::Draw()
   {
+    Flush();
+
+    if (!_renderer)
+    {
+      return;
+    }
+
     // draw debug primitives
     // FYI, this is a HACK as the code is ripped straight from the debug system
     // the reason it's done this way is because the game needs a simple way to draw boxes, which the debug drawing facilities provide
@@ -180,18 +402,78 @@ namespace ecs
       boxes.push_back(box);
     }
 
-    _renderer->ClearHDR();
-
     _renderer->DrawBoxes(boxes);
 
-    _renderer->DrawParticles(*_particles, *_renderIndices, MAX_PARTICLES);
+    if (_backend == ParticleBackend::CPU)
+    {
+      GatherRenderable();
+      const auto count = static_cast<int32_t>(_cpuRenderable.size());
+      if (count > 0)
+      {
+        _particles->SubData(std::span(std::as_const(_cpuRenderable)), 0);
+      }
+      _renderIndices->SubData(count, 0);
+    }
+
+    _renderer->DrawParticles(*_particles, *_renderIndices);
+
+    if (_statsReadback)
+    {
+      _statsReadback->Record(*_tombstones, 0, _frameIndex);
+    }
+    _frameIndex++;
+  }
+
+  std::span<const Particle> ParticleSystem::GatherRenderable()
+  {
+    G_ASSERT(_backend == ParticleBackend::CPU);
+    _cpuSimulation->GatherRenderable(_cpuRenderable);
+    return _cpuRenderable;
   }
 
-  std::uint32_t ParticleSystem::GetNumParticles()
+  void ParticleSystem::ReadBackParticles(std::vector<Particle>& out)
   {
+    Flush();
+
+    if (_backend == ParticleBackend::CPU)
+    {
+      _cpuSimulation->GatherRenderable(out);
+      return;
+    }
+
+    // reading a buffer waits for the shaders that wrote it, once their writes are made visible to it
     glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+    int32_t count{};
+    glGetNamedBufferSubData(static_cast<GLuint>(_renderIndices->Handle()), 0, sizeof(int32_t), &count);
+    std::vector<int32_t> indices(static_cast<size_t>(std::max(count, 0)));
+    glGetNamedBufferSubData(static_cast<GLuint>(_renderIndices->Handle()), sizeof(int32_t), static_cast<GLsizeiptr>(indices.size() * sizeof(int32_t)), indices.data());
+
+    std::vector<Particle> particles(MAX_PARTICLES);
+    glGetNamedBufferSubData(static_cast<GLuint>(_particles->Handle()), 0, static_cast<GLsizeiptr>(particles.size() * sizeof(Particle)), particles.data());
+
+    out.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+      out[i] = particles[indices[i]];
+    }
+  }
+
+  ParticleStats ParticleSystem::GetStats()
+  {
+    if (_backend == ParticleBackend::CPU)
+    {
+      return ParticleStats{ .numParticles = _cpuSimulation->NumParticles(), .frameAge = 0, .valid = true };
+    }
+
+    auto result = _statsReadback->Poll();
+    if (!result)
+    {
+      return ParticleStats{};
+    }
+
     int32_t size{};
-    glGetNamedBufferSubData(_tombstones->Handle(), 0, sizeof(int32_t), &size);
+    std::memcpy(&size, result->data, sizeof(int32_t));
     auto ret = int32_t(MAX_PARTICLES) - size;
     if (ret < 0)
     {
@@ -200,18 +482,37 @@ namespace ecs
 #endif
       ret = 0;
     }
-    return ret;
+
+    return ParticleStats
+    {
+      .numParticles = static_cast<uint32_t>(ret),
+      .frameAge = static_cast<uint32_t>(_frameIndex - result->tag),
+      .valid = result->tag >= _statsValidFrame,
+    };
   }
 
   void ParticleSystem::HandleParticleAdd(AddParticles& e)
   {
+    // new particles must not be affected by substeps that were recorded before they were spawned
+    Flush();
+
+    if (_backend == ParticleBackend::CPU)
+    {
+      _cpuSimulation->Add(e.particles);
+      return;
+    }
+
+    _statsValidFrame = _frameIndex;
+
     Fwog::BeginCompute("Copy particles");
     {
-      auto tempBuffer = Fwog::TypedBuffer<Particle>(std::span(e.particles));
+      auto zone = _renderer->Profiler().Scope("Copy particles");
+      const auto particlesUpload = _renderer->Uploads().Upload(e.particles);
       Fwog::Cmd::BindComputePipeline(_particleAdd);
       Fwog::Cmd::BindStorageBuffer(0, *_particles, 0, _particles->Size());
       Fwog::Cmd::BindStorageBuffer(1, *_tombstones, 0, _tombstones->Size());
-      Fwog::Cmd::BindStorageBuffer(2, tempBuffer, 0, tempBuffer.Size());
+      TransientUploadAllocator::BindStorageBuffer(2, particlesUpload);
+      Fwog::Cmd::BindStorageBuffer(3, *_renderIndices, 0, _renderIndices->Size());
 
       uint32_t workgroups = static_cast<uint32_t>((e.particles.size() + 511) / 512);
       Fwog::Cmd::MemoryBarrier(Fwog::MemoryBarrierAccessBit::SHADER_STORAGE_BIT);
@@ -220,6 +521,84 @@ namespace ecs
     Fwog::EndCompute();
   }
 
+  void ParticleSystem::HandleParticleEmit(EmitParticles& e)
+  {
+    auto batch = EmitParticleBatch{ .emitters = std::span(&e, 1) };
+    HandleParticleEmitBatch(batch);
+  }
+
+  void ParticleSystem::HandleParticleEmitBatch(EmitParticleBatch& e)
+  {
+    // Each emitter gets a range of invocations in one dispatch. Particles past MAX_PARTICLES would be
+    // dropped anyways, so they aren't launched
+    std::vector<GpuEmitter> emitters;
+    emitters.reserve(e.emitters.size());
+    uint32_t numParticles = 0;
+    for (const auto& emitter : e.emitters)
+    {
+      const uint32_t count = std::min(emitter.count, MAX_PARTICLES - numParticles);
+      if (count == 0)
+      {
+        continue;
+      }
+
+      // count (not emitter.count) invocations are launched, but the sample pattern is still based on emitter.count
+      emitters.push_back(GpuEmitter
+        {
+          .color = emitter.color,
+          .center = emitter.center,
+          .radius = emitter.radius,
+          .lifetime = emitter.lifetime,
+          .count = emitter.count,
+          .shape = static_cast<uint32_t>(emitter.shape),
+          .seed = emitter.seed,
+          .firstParticle = numParticles,
+        });
+      numParticles += count;
+    }
+
+    if (numParticles == 0)
+    {
+      return;
+    }
+
+    Flush();
+
+    if (_backend == ParticleBackend::CPU)
+    {
+      for (const auto& emitter : e.emitters)
+      {
+        _cpuSimulation->Emit(emitter);
+      }
+      return;
+    }
+
+    _statsValidFrame = _frameIndex;
+
+    Fwog::BeginCompute("Emit particles");
+    {
+      auto zone = _renderer->Profiler().Scope("Emit particles");
+      const auto uniformsUpload = _renderer->Uploads().Upload(EmitUniforms
+        {
+          .numEmitters = static_cast<uint32_t>(emitters.size()),
+          .numParticles = numParticles,
+        });
+      const auto emittersUpload = _renderer->Uploads().Upload(std::span<const GpuEmitter>(emitters));
+
+      Fwog::Cmd::BindComputePipeline(_particleEmit);
+      Fwog::Cmd::BindStorageBuffer(0, *_particles, 0, _particles->Size());
+      Fwog::Cmd::BindStorageBuffer(1, *_tombstones, 0, _tombstones->Size());
+      Fwog::Cmd::BindStorageBuffer(2, *_renderIndices, 0, _renderIndices->Size());
+      TransientUploadAllocator::BindStorageBuffer(3, emittersUpload);
+      TransientUploadAllocator::BindUniformBuffer(0, uniformsUpload);
+
+      uint32_t workgroups = (numParticles + 511) / 512;
+      Fwog::Cmd::MemoryBarrier(Fwog::MemoryBarrierAccessBit::SHADER_STORAGE_BIT | Fwog::MemoryBarrierAccessBit::UNIFORM_BUFFER_BIT);
+      Fwog::Cmd::Dispatch(workgroups, 1, 1);
+    }
+    Fwog::EndCompute();
+  }
+
   void ParticleSystem::HandleMousePosition(input::MousePositionEvent& e)
   {
     cursorX = float(e.cursorPosX / e.windowX * 2.0 - 1.0);
@@ -1,27 +1,67 @@
 #pragma once
 #include "ecs/systems/System.h"
 #include "ecs/events/AddParticles.h"
+#include "ecs/events/EmitParticles.h"
 #include "Input.h"
+#include "cpu/ParticleSimulation.h"
 #include <Fwog/Buffer.h>
 #include <Fwog/Pipeline.h>
 #include <memory>
+#include <vector>
 
 class Renderer;
+class JobSystem;
+class AsyncReadback;
 
 namespace ecs
 {
+  enum class ParticleBackend
+  {
+    GPU, // particles live in GPU buffers and are simulated with compute shaders
+    CPU, // particles live in host memory, so no GL context is needed unless they are drawn
+  };
+
+  struct ParticleStats
+  {
+    uint32_t numParticles = 0;
+    uint32_t frameAge = 0; // how many frames ago numParticles was captured
+    bool valid = false;    // false if particles were reset or spawned after numParticles was captured
+  };
+
   class ParticleSystem : public System
   {
   public:
-    ParticleSystem(Scene* scene, EventBus* eventBus, Renderer* renderer);
+    // renderer may be null when using the CPU backend, in which case nothing is drawn.
+    // The CPU backend simulates on jobs
+    ParticleSystem(Scene* scene, EventBus* eventBus, Renderer* renderer, JobSystem* jobs, ParticleBackend backend = ParticleBackend::GPU);
+    ~ParticleSystem();
 
     void Reset(bool hard, uint32_t maxParticles);
 
+    // Substep followed by Flush.
     void Update(double dt) override;
 
+    // reads the walls, and flushing may touch the GL context
+    void DeclareAccess(SystemAccess& access) const override;
+
+    // Records a simulation step against the current walls. Particles aren't touched until Flush.
+    // Flushes automatically when MAX_SUBSTEPS are pending, or the number of walls changes.
+    void Substep(double dt);
+
+    // Simulates every pending substep in a single pass over the particles.
+    void Flush();
+
     void Draw() override;
 
-    std::uint32_t GetNumParticles();
+    // Never waits on the GPU, so the result may be a few frames old.
+    ParticleStats GetStats();
+
+    // CPU backend only. The particles that are drawn this frame, valid until the next call
+    std::span<const Particle> GatherRenderable();
+
+    // Flushes, waits for the GPU and copies every live particle to out, in no particular order.
+    // Meant for tools that compare the backends, it's far too slow to call every frame
+    void ReadBackParticles(std::vector<Particle>& out);
 
     std::uint32_t MAX_PARTICLES;
     float magnetism;
@@ -32,8 +72,27 @@ namespace ecs
     float cursorX = 0;
     float cursorY = 0;
 
+    static constexpr uint32_t MAX_SUBSTEPS = 16; // keep in sync with UpdateParticles.comp.glsl
+
   private:
     Renderer* _renderer;
+    JobSystem* _jobs;
+    ParticleBackend _backend;
+
+    struct PendingSubstep
+    {
+      float dt;
+      glm::vec2 cursor;
+    };
+
+    std::vector<PendingSubstep> _substeps;
+    std::vector<cpu::Wall> _substepWalls; // walls of each pending substep, one after another
+    size_t _substepNumWalls = 0;
+    glm::vec2 _flushedCursor = { 0, 0 }; // cursor position of the last flushed substep
+
+    // only used by the CPU backend
+    std::unique_ptr<cpu::ParticleSimulation> _cpuSimulation;
+    std::vector<Particle> _cpuRenderable;
 
     // List(s) containing per-particle attributes
     std::unique_ptr<Fwog::Buffer> _particles;
@@ -41,15 +100,28 @@ namespace ecs
     // When a particle dies, its index gets pushed to this atomic stack
     std::unique_ptr<Fwog::Buffer> _tombstones;
 
-    // Buffer containing a count & indices of particles to render
+    // Buffer containing a count & indices of live particles, which are updated and rendered
     std::unique_ptr<Fwog::Buffer> _renderIndices;
 
-    std::unique_ptr<Fwog::Buffer> _uniforms;
+    // The update writes the indices of particles that survive to this list, then it's swapped with _renderIndices
+    std::unique_ptr<Fwog::Buffer> _renderIndicesNext;
+
+    // glDispatchComputeIndirect arguments for the update, written on the GPU from the number of live particles
+    std::unique_ptr<Fwog::Buffer> _updateDispatchArgs;
+
+    // copies of the tombstone count, recorded every frame
+    std::unique_ptr<AsyncReadback> _statsReadback;
+    uint64_t _frameIndex = 0;
+    uint64_t _statsValidFrame = 0; // results recorded before this frame are stale
 
     Fwog::ComputePipeline _particleUpdate;
     Fwog::ComputePipeline _particleAdd;
+    Fwog::ComputePipeline _writeDispatchArgs;
+    Fwog::ComputePipeline _particleEmit;
 
     void HandleParticleAdd(AddParticles& e);
+    void HandleParticleEmit(EmitParticles& e);
+    void HandleParticleEmitBatch(EmitParticleBatch& e);
     void HandleMousePosition(input::MousePositionEvent& e);
   };
 }
\ No newline at end of file
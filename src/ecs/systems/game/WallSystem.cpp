@@ -0,0 +1,65 @@
+#include "WallSystem.h"
+#include "ecs/Scene.h"
+#include "ecs/SystemScheduler.h"
+#include "ecs/components/DebugDraw.h"
+#include <glm/packing.hpp>
+#include <glm/glm.hpp>
+#include <entt/entity/registry.hpp>
+#include <cmath>
+
+namespace ecs
+{
+  WallSystem::WallSystem(Scene* scene, EventBus* eventBus)
+    : System(scene, eventBus)
+  {
+  }
+
+  void WallSystem::DeclareAccess(SystemAccess& access) const
+  {
+    access.Write<ecs::DebugBox, ecs::Flicker, ecs::Movement>();
+  }
+
+  void WallSystem::Update(double dt)
+  {
+    // make boxes that are "about to spawn" flicker in some way
+    // Flicker is left on boxes that have spawned, since removing it would stop this system running alongside others
+    auto viewBoxLife = _scene->Registry().view<ecs::DebugBox, ecs::Flicker>();
+    for (auto&& [_, box, flicker] : viewBoxLife.each())
+    {
+      if (flicker.timeLeft <= 0)
+      {
+        continue;
+      }
+
+      flicker.timeLeft -= dt;
+      glm::vec4 emissive = {};
+      emissive.r = static_cast<float>(200 * (1 + sin(flicker.timeLeft * 4.0 * 3.1415) / 2));
+      emissive.g = static_cast<float>(200 * (1 + sin(flicker.timeLeft * 4.0 * 3.1415) / 2));
+      emissive = glm::mix(emissive, glm::vec4(200, 0, 0, 0), float(1.0 - flicker.timeLeft / 3.0));
+
+      if (flicker.timeLeft <= 0)
+      {
+        emissive.r = 200;
+        emissive.g = 0;
+        box.active = true;
+      }
+      box.color16f.x = glm::packHalf2x16(glm::vec2(emissive));
+      //box.color16f.y = glm::packHalf2x16(glm::vec2(emissive));
+    }
+
+    auto viewBoxMove = _scene->Registry().view<ecs::DebugBox, ecs::Movement>();
+    for (auto&& [_, box, move] : viewBoxMove.each())
+    {
+      move.accum += dt;
+      move.accum = std::fmod(move.accum, move.period);
+      if (move.accum / (move.period / 2.0) < 1.0)
+      {
+        box.translation = glm::mix(move.posA, move.posB, move.accum / (move.period / 2.0));
+      }
+      else
+      {
+        box.translation = glm::mix(move.posA, move.posB, 2 - move.accum / (move.period / 2.0));
+      }
+    }
+  }
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+#include "ecs/systems/System.h"
+
+namespace ecs
+{
+  // Makes walls that are about to spawn flicker, and moves walls that have a Movement
+  class WallSystem : public System
+  {
+  public:
+    WallSystem(Scene* scene, EventBus* eventBus);
+
+    void Update(double dt) override;
+    void DeclareAccess(SystemAccess& access) const override;
+  };
+}
\ No newline at end of file
@@ -1,16 +1,105 @@
 #include "Application.h"
 #include "ecs/Scene.h"
 #include "utils/EventBus.h"
+#include "utils/AssetLoader.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
-int main(int, const char* const*)
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+namespace
+{
+  void PrintUsage(const char* program)
+  {
+    printf("Usage: %s [--headless <ticks>] [--particles <1-%d>] [--hz <rate>] [--render <width>x<height>] [--screenshot <path>]\n", program, HeadlessOptions::MAX_START_PARTICLES);
+  }
+}
+
+int main(int argc, const char* const* argv)
 {
+  bool headless = false;
+  HeadlessOptions headlessOptions;
+
+  for (int i = 1; i < argc; i++)
+  {
+    const auto arg = std::string_view(argv[i]);
+    if (i + 1 >= argc)
+    {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+
+    const char* value = argv[++i];
+    if (arg == "--headless")
+    {
+      headless = true;
+      headlessOptions.ticks = std::strtoull(value, nullptr, 10);
+    }
+    else if (arg == "--particles")
+    {
+      // unlike atoi, strtol reports trailing garbage and saturates instead of overflowing
+      char* end = nullptr;
+      const long startParticles = std::strtol(value, &end, 10);
+      if (*value == '\0' || *end != '\0' || startParticles <= 0 || startParticles > HeadlessOptions::MAX_START_PARTICLES)
+      {
+        PrintUsage(argv[0]);
+        return 1;
+      }
+      headlessOptions.startParticles = static_cast<int>(startParticles);
+    }
+    else if (arg == "--hz")
+    {
+      headlessOptions.simulationHz = std::atoi(value);
+    }
+    else if (arg == "--render")
+    {
+      if (std::sscanf(value, "%ux%u", &headlessOptions.renderWidth, &headlessOptions.renderHeight) != 2)
+      {
+        PrintUsage(argv[0]);
+        return 1;
+      }
+    }
+    else if (arg == "--screenshot")
+    {
+      headlessOptions.screenshotPath = value;
+    }
+    else
+    {
+      PrintUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  // --screenshot writes the last frame of --render
+  const bool renders = headlessOptions.renderWidth > 0 && headlessOptions.renderHeight > 0;
+  if (headlessOptions.startParticles <= 0 || headlessOptions.simulationHz <= 0 || (!headlessOptions.screenshotPath.empty() && !renders))
+  {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  // read the shaders while the window and context are created
+  if (!headless)
+  {
+    AssetLoader::Get().PrefetchText("assets/shaders");
+  }
+
   EventBus eventBus;
   auto scene = ecs::Scene(&eventBus);
-  auto app = Application("Flocker", &scene, &eventBus);
-  app.Run();
+  auto app = Application("Flocker", &scene, &eventBus, headless);
+  if (headless)
+  {
+    app.RunHeadless(headlessOptions);
+  }
+  else
+  {
+    app.Run();
+  }
 
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,223 @@
+// Compares the cost of publishing through EventBus with the EventBus it replaced, which looked handlers up by
+// std::type_index in an unordered_map and called each through a heap allocated virtual dispatcher.
+#include "utils/EventBus.h"
+#include "utils/Timer.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <typeindex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace
+{
+  // the old EventBus, minus Unsubscribe
+  class TypeIndexEventBus
+  {
+  public:
+    template<typename EventType>
+    void Publish(EventType&& e)
+    {
+      auto entry = m_Subscriptions.find(typeid(EventType));
+      if (entry != m_Subscriptions.end())
+      {
+        for (const auto& handler : entry->second)
+        {
+          handler->InvokeHandler(&e);
+        }
+      }
+    }
+
+    template<typename Receiver, typename EventType>
+    void Subscribe(Receiver* receiver, void(Receiver::* handlerFn)(EventType&))
+    {
+      m_Subscriptions[typeid(EventType)].emplace_back(std::make_unique<EventHandler<Receiver, EventType>>(receiver, handlerFn, nullptr));
+    }
+
+    template<typename Receiver, typename EventType, typename Fn>
+    void Subscribe(Receiver* receiver, void(Receiver::* handlerFn)(EventType&), Fn&& predicateFn)
+    {
+      m_Subscriptions[typeid(EventType)].emplace_back(std::make_unique<EventHandler<Receiver, EventType>>(receiver, handlerFn, std::forward<Fn>(predicateFn)));
+    }
+
+  private:
+    class EventDispatcher
+    {
+    public:
+      virtual ~EventDispatcher() = default;
+      virtual void InvokeHandler(void* e) const = 0;
+    };
+
+    template<typename Receiver, typename EventType>
+    class EventHandler : public EventDispatcher
+    {
+    public:
+      using HandlerFn = void(Receiver::*)(EventType&);
+      using PredicateFn = std::function<bool(const EventType&)>;
+
+      EventHandler(Receiver* receiver, HandlerFn handlerFn, PredicateFn predicateFn)
+        : m_Receiver(receiver),
+        m_HandlerFn(handlerFn),
+        m_PredicateFn(std::move(predicateFn))
+      {
+      }
+
+      void InvokeHandler(void* e) const override
+      {
+        if (!m_PredicateFn || m_PredicateFn(*reinterpret_cast<EventType*>(e)))
+        {
+          (m_Receiver->*m_HandlerFn)(*reinterpret_cast<EventType*>(e));
+        }
+      }
+
+    private:
+      Receiver* m_Receiver;
+      HandlerFn m_HandlerFn;
+      PredicateFn m_PredicateFn;
+    };
+
+    std::unordered_map<std::type_index, std::vector<std::unique_ptr<EventDispatcher>>> m_Subscriptions;
+  };
+
+  // a few event types, so lookups aren't always for the same key
+  template<int N>
+  struct Event
+  {
+    int value;
+  };
+
+  struct Receiver
+  {
+    template<int N>
+    void Handle(Event<N>& e)
+    {
+      sum += e.value;
+    }
+
+    int64_t sum = 0;
+  };
+
+  struct ConstReceiver
+  {
+    void Handle(const Event<0>& e)
+    {
+      sum += e.value;
+    }
+
+    int64_t sum = 0;
+  };
+
+  // handlers that take the event as const are found by the published type, however it is published
+  bool ConstHandlersReceiveEvents()
+  {
+    auto bus = EventBus();
+    auto receiver = ConstReceiver();
+    auto filtered = ConstReceiver();
+    bus.Subscribe(&receiver, &ConstReceiver::Handle);
+    bus.Subscribe(&filtered, &ConstReceiver::Handle, [](const Event<0>& e) { return e.value > 1; });
+
+    auto e = Event<0>{ 1 };
+    const auto constEvent = Event<0>{ 2 };
+    bus.Publish(e);
+    bus.Publish(constEvent);
+    bus.Publish(Event<0>{ 4 });
+    bus.Enqueue(Event<0>{ 8 });
+    bus.Flush();
+    if (receiver.sum != 15 || filtered.sum != 14)
+    {
+      return false;
+    }
+
+    bus.Unsubscribe(&receiver, &ConstReceiver::Handle);
+    bus.Unsubscribe(&filtered, &ConstReceiver::Handle);
+    bus.Publish(e);
+    return receiver.sum == 15 && filtered.sum == 14;
+  }
+
+  template<typename Bus, int... N>
+  void SubscribeAll(Bus& bus, std::vector<Receiver>& receivers, std::integer_sequence<int, N...>)
+  {
+    for (size_t i = 0; i < receivers.size(); i++)
+    {
+      // every fourth handler has a predicate that passes every other event
+      if (i % 4 == 3)
+      {
+        (bus.Subscribe(&receivers[i], &Receiver::Handle<N>, [](const Event<N>& e) { return e.value % 2 == 0; }), ...);
+      }
+      else
+      {
+        (bus.Subscribe(&receivers[i], &Receiver::Handle<N>), ...);
+      }
+    }
+  }
+
+  template<typename Bus, int... N>
+  void PublishAll(Bus& bus, int value, std::integer_sequence<int, N...>)
+  {
+    (bus.Publish(Event<N>{ value }), ...);
+  }
+
+  // returns nanoseconds per handler call, and the sum of what the receivers saw so the work isn't optimized out
+  template<typename Bus>
+  std::pair<double, int64_t> Measure(size_t numHandlers, uint32_t numEvents)
+  {
+    constexpr auto types = std::make_integer_sequence<int, 8>();
+    auto bus = Bus();
+    auto receivers = std::vector<Receiver>(numHandlers);
+    SubscribeAll(bus, receivers, types);
+
+    auto timer = Timer();
+    for (uint32_t i = 0; i < numEvents; i++)
+    {
+      PublishAll(bus, static_cast<int>(i), types);
+    }
+    const double ns = timer.Elapsed_us() * 1000.0 / (double(numEvents) * types.size() * numHandlers);
+
+    int64_t sum = 0;
+    for (const auto& receiver : receivers)
+    {
+      sum += receiver.sum;
+    }
+    return { ns, sum };
+  }
+}
+
+int main(int argc, const char* const* argv)
+{
+  const uint32_t events = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 1'000'000;
+  if (events == 0)
+  {
+    printf("Usage: %s [events per type]\n", argv[0]);
+    return 1;
+  }
+
+  if (!ConstHandlersReceiveEvents())
+  {
+    printf("a handler that takes a const event missed events\n");
+    return 1;
+  }
+
+  printf("%u events of 8 types each\n", events);
+  printf("%10s %16s %16s\n", "handlers", "type_index ns", "EventBus ns");
+
+  for (size_t handlers : { 1, 4, 16, 64 })
+  {
+    // fewer events for more handlers, so each row takes about as long
+    const auto numEvents = static_cast<uint32_t>(std::max<size_t>(events / handlers, 1));
+    const auto [oldNs, oldSum] = Measure<TypeIndexEventBus>(handlers, numEvents);
+    const auto [newNs, newSum] = Measure<EventBus>(handlers, numEvents);
+    if (oldSum != newSum)
+    {
+      printf("the buses called different handlers\n");
+      return 1;
+    }
+
+    printf("%10zu %16.2f %16.2f\n", handlers, oldNs, newNs);
+  }
+
+  return 0;
+}
\ No newline at end of file
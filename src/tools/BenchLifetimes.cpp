@@ -0,0 +1,121 @@
+// Compares the per-tick cost of LifetimeSystem's timing wheels with counting every Lifetime down each tick,
+// which is what LifetimeSystem did before. Expired entities are replaced, so there are always about N of them.
+#include "JobSystem.h"
+#include "ecs/Scene.h"
+#include "ecs/SystemScheduler.h"
+#include "ecs/components/core/Lifetime.h"
+#include "ecs/systems/core/LifetimeSystem.h"
+#include "utils/Timer.h"
+#include <entt/entity/registry.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <vector>
+
+namespace
+{
+  constexpr double TICK = 1.0 / 60.0;
+
+  // the old LifetimeSystem::Update, minus DeleteInNTicks
+  class ScanLifetimes
+  {
+  public:
+    ScanLifetimes(entt::registry& registry, JobSystem& jobs)
+      : _registry(registry), _jobs(jobs)
+    {
+    }
+
+    void Update(double dt)
+    {
+      auto deleteView = _registry.view<ecs::DeleteNextTick>();
+      _registry.destroy(deleteView.begin(), deleteView.end());
+
+      const auto microseconds = static_cast<int>(dt * 1'000'000.0 + 0.5);
+      auto view = _registry.view<ecs::Lifetime>();
+      std::mutex expiredMutex;
+      std::vector<entt::entity> expired;
+      ecs::ParallelEach(_jobs, view, 4096, [&](std::span<const entt::entity> entities)
+      {
+        std::vector<entt::entity> chunkExpired;
+        for (auto entity : entities)
+        {
+          // the old Lifetime was counted down in place
+          auto& lifetime = view.get<ecs::Lifetime>(entity);
+          lifetime.durationMicroseconds -= microseconds;
+          if (lifetime.durationMicroseconds <= 0)
+          {
+            chunkExpired.push_back(entity);
+          }
+        }
+
+        auto lock = std::lock_guard(expiredMutex);
+        expired.insert(expired.end(), chunkExpired.begin(), chunkExpired.end());
+      });
+
+      for (auto entity : expired)
+      {
+        _registry.emplace<ecs::DeleteNextTick>(entity);
+      }
+    }
+
+  private:
+    entt::registry& _registry;
+    JobSystem& _jobs;
+  };
+
+  // Spawns entities until there are count of them. Lifetimes are between half a second and five seconds
+  void Populate(entt::registry& registry, size_t count, std::mt19937& rng)
+  {
+    auto microseconds = std::uniform_int_distribution<int>(500'000, 5'000'000);
+    for (size_t alive = registry.view<ecs::Lifetime>().size(); alive < count; alive++)
+    {
+      registry.emplace<ecs::Lifetime>(registry.create(), microseconds(rng));
+    }
+  }
+
+  // returns the average milliseconds per tick, including respawns
+  template<typename Update>
+  double Measure(entt::registry& registry, size_t count, uint32_t ticks, Update&& update)
+  {
+    auto rng = std::mt19937(count);
+    Populate(registry, count, rng);
+
+    auto timer = Timer();
+    for (uint32_t i = 0; i < ticks; i++)
+    {
+      update(TICK);
+      Populate(registry, count, rng);
+    }
+    return timer.Elapsed_ms() / ticks;
+  }
+}
+
+int main(int argc, const char* const* argv)
+{
+  const uint32_t ticks = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 600;
+  if (ticks == 0)
+  {
+    printf("Usage: %s [ticks]\n", argv[0]);
+    return 1;
+  }
+
+  auto jobs = JobSystem();
+  printf("%u ticks at %.0f Hz, %u workers\n", ticks, 1.0 / TICK, jobs.NumWorkers());
+  printf("%10s %12s %12s\n", "entities", "scan ms", "wheel ms");
+
+  for (size_t count : { 1'000, 10'000, 100'000, 1'000'000 })
+  {
+    auto scanScene = ecs::Scene(nullptr);
+    auto scan = ScanLifetimes(scanScene.Registry(), jobs);
+    const double scanMs = Measure(scanScene.Registry(), count, ticks, [&](double dt) { scan.Update(dt); });
+
+    auto wheelScene = ecs::Scene(nullptr);
+    auto wheel = ecs::LifetimeSystem(&wheelScene, nullptr);
+    const double wheelMs = Measure(wheelScene.Registry(), count, ticks, [&](double dt) { wheel.Update(dt); });
+
+    printf("%10zu %12.4f %12.4f\n", count, scanMs, wheelMs);
+  }
+
+  return 0;
+}
\ No newline at end of file
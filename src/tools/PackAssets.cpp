@@ -0,0 +1,95 @@
+// Bundles every file under <root>/assets into an AssetPack. Assets are named by their path relative to root,
+// so "assets/shaders/Texture.frag.glsl" is found in the pack under the same path it would be loaded from.
+#include "utils/AssetPack.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+  struct File
+  {
+    std::string name;
+    std::filesystem::path path;
+    uint64_t size;
+  };
+
+  uint64_t AlignUp(uint64_t value, uint64_t alignment)
+  {
+    return (value + alignment - 1) / alignment * alignment;
+  }
+}
+
+int main(int argc, const char* const* argv)
+{
+  if (argc != 3)
+  {
+    printf("Usage: %s <output> <root>\n", argv[0]);
+    return 1;
+  }
+
+  const auto root = std::filesystem::path(argv[2]);
+  std::vector<File> files;
+  for (const auto& entry : std::filesystem::recursive_directory_iterator(root / "assets"))
+  {
+    if (entry.is_regular_file())
+    {
+      files.push_back({ std::filesystem::relative(entry.path(), root).generic_string(), entry.path(), entry.file_size() });
+    }
+  }
+
+  // the runtime binary searches the entries
+  std::sort(files.begin(), files.end(), [](const File& a, const File& b) { return a.name < b.name; });
+
+  AssetPack::Header header{};
+  std::copy(std::begin(AssetPack::MAGIC), std::end(AssetPack::MAGIC), header.magic);
+  header.version = AssetPack::VERSION;
+  header.numEntries = static_cast<uint32_t>(files.size());
+
+  std::vector<AssetPack::Entry> entries(files.size());
+  uint64_t offset = sizeof(AssetPack::Header) + sizeof(AssetPack::Entry) * files.size();
+  for (size_t i = 0; i < files.size(); i++)
+  {
+    entries[i].nameOffset = offset;
+    entries[i].nameSize = static_cast<uint32_t>(files[i].name.size());
+    offset += files[i].name.size();
+  }
+  for (size_t i = 0; i < files.size(); i++)
+  {
+    offset = AlignUp(offset, AssetPack::CONTENT_ALIGNMENT);
+    entries[i].contentOffset = offset;
+    entries[i].contentSize = files[i].size;
+    offset += files[i].size;
+  }
+
+  std::ofstream output(argv[1], std::ios::binary | std::ios::trunc);
+  output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  output.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(sizeof(AssetPack::Entry) * entries.size()));
+  for (const auto& file : files)
+  {
+    output.write(file.name.data(), static_cast<std::streamsize>(file.name.size()));
+  }
+  for (size_t i = 0; i < files.size(); i++)
+  {
+    const auto padding = std::vector<char>(entries[i].contentOffset - static_cast<uint64_t>(output.tellp()));
+    output.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+    // inserting an empty stream fails the output
+    if (files[i].size > 0)
+    {
+      std::ifstream input(files[i].path, std::ios::binary);
+      output << input.rdbuf();
+    }
+  }
+
+  if (!output)
+  {
+    printf("Failed to write %s\n", argv[1]);
+    return 1;
+  }
+
+  printf("Packed %zu assets into %s\n", files.size(), argv[1]);
+  return 0;
+}
\ No newline at end of file
@@ -0,0 +1,193 @@
+// Runs the same emitters, walls and cursor through the GPU and CPU particle backends, then checks that the
+// particles they end up with agree within a tolerance. The backends hand out particle slots in different orders,
+// so each attribute is compared by its distribution: if every particle is within epsilon of its counterpart,
+// the i-th smallest value of an attribute is too. Exits with 1 if any attribute is off by more than its epsilon.
+#include "JobSystem.h"
+#include "Renderer.h"
+#include "ecs/Scene.h"
+#include "ecs/components/DebugDraw.h"
+#include "ecs/events/EmitParticles.h"
+#include "ecs/systems/game/ParticleSystem.h"
+#include "utils/EventBus.h"
+#include <entt/entity/registry.hpp>
+#include <glad/gl.h>
+#include <GLFW/glfw3.h>
+#include <glm/packing.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+namespace
+{
+  constexpr double TICK = 1.0 / 60.0;
+  constexpr size_t NUM_QUANTILES = 4096;
+
+  struct Attribute
+  {
+    const char* name;
+    float epsilon;
+    std::function<float(const ecs::Particle&)> get;
+  };
+
+  // the largest difference between the same quantiles of a and b
+  float MaxQuantileError(const Attribute& attribute, std::span<const ecs::Particle> a, std::span<const ecs::Particle> b)
+  {
+    auto sorted = [&attribute](std::span<const ecs::Particle> particles)
+    {
+      std::vector<float> values(particles.size());
+      std::transform(particles.begin(), particles.end(), values.begin(), attribute.get);
+      std::sort(values.begin(), values.end());
+      return values;
+    };
+
+    const auto valuesA = sorted(a);
+    const auto valuesB = sorted(b);
+    float maxError = 0;
+    for (size_t q = 0; q <= NUM_QUANTILES; q++)
+    {
+      const auto quantile = [q](const std::vector<float>& values) { return values[(values.size() - 1) * q / NUM_QUANTILES]; };
+      maxError = std::max(maxError, std::abs(quantile(valuesA) - quantile(valuesB)));
+    }
+    return maxError;
+  }
+
+  void AddWall(ecs::Scene& scene, glm::vec2 position, glm::vec2 scale)
+  {
+    auto& registry = scene.Registry();
+    registry.emplace<ecs::DebugBox>(registry.create(), ecs::DebugBox{ .translation = position, .scale = scale, .active = true });
+  }
+
+  // returns true if the backends agree
+  bool Compare(GLFWwindow* window, uint32_t ticks, uint32_t maxParticles)
+  {
+    auto eventBus = EventBus();
+    auto scene = ecs::Scene(&eventBus);
+    auto jobs = JobSystem();
+    auto renderer = Renderer(window);
+
+    // both subscribe to the same bus, so they see the same emitters
+    auto gpu = ecs::ParticleSystem(&scene, &eventBus, &renderer, &jobs);
+    auto cpu = ecs::ParticleSystem(&scene, &eventBus, nullptr, &jobs, ecs::ParticleBackend::CPU);
+    gpu.Reset(true, maxParticles);
+    cpu.Reset(true, maxParticles);
+
+    AddWall(scene, { 0.5f, 0.0f }, { 0.1f, 0.8f });
+    AddWall(scene, { -0.4f, -0.5f }, { 0.6f, 0.1f });
+
+    // short lifetimes so some particles die along the way
+    for (uint32_t i = 0; i < 3; i++)
+    {
+      eventBus.Publish(ecs::EmitParticles
+        {
+          .shape = i % 2 ? ecs::EmitterShape::SQUARE : ecs::EmitterShape::DISK,
+          .count = maxParticles / 4,
+          .center = { -0.5f + i * 0.5f, 0.3f },
+          .radius = 0.2f,
+          .color = { 1.0f, 0.5f * i, 0.25f, 1.0f },
+          .lifetime = 0.5f + i * float(ticks * TICK),
+          .seed = i * 7919 + 1,
+        });
+    }
+
+    for (uint32_t tick = 0; tick < ticks; tick++)
+    {
+      // the cursor circles the middle, so the particles are pulled through the walls
+      const float angle = float(tick * TICK);
+      for (auto* system : { &gpu, &cpu })
+      {
+        system->cursorX = 0.6f * std::cos(angle);
+        system->cursorY = 0.6f * std::sin(angle);
+      }
+
+      renderer.Profiler().BeginFrame();
+      gpu.Update(TICK);
+      cpu.Update(TICK);
+      renderer.Profiler().EndFrame();
+      renderer.Uploads().EndFrame();
+    }
+
+    std::vector<ecs::Particle> gpuParticles;
+    std::vector<ecs::Particle> cpuParticles;
+    gpu.ReadBackParticles(gpuParticles);
+    cpu.ReadBackParticles(cpuParticles);
+
+    // a particle near a wall or at the end of its lifetime may go either way, but only a few should
+    const auto numGpu = static_cast<int64_t>(gpuParticles.size());
+    const auto numCpu = static_cast<int64_t>(cpuParticles.size());
+    const bool countsMatch = std::abs(numGpu - numCpu) <= std::max<int64_t>(numCpu / 1000, 1);
+    printf("%-12s %12lld %12lld %s\n", "alive", static_cast<long long>(numGpu), static_cast<long long>(numCpu), countsMatch ? "ok" : "MISMATCH");
+    if (gpuParticles.empty() || cpuParticles.empty())
+    {
+      return countsMatch;
+    }
+
+    // velocities are stored as halves, and the backends may round them differently
+    const Attribute attributes[] =
+    {
+      { "position.x", 1e-3f, [](const ecs::Particle& p) { return p.position.x; } },
+      { "position.y", 1e-3f, [](const ecs::Particle& p) { return p.position.y; } },
+      { "velocity.x", 1e-2f, [](const ecs::Particle& p) { return glm::unpackHalf2x16(p.velocity).x; } },
+      { "velocity.y", 1e-2f, [](const ecs::Particle& p) { return glm::unpackHalf2x16(p.velocity).y; } },
+      { "emissive.r", 1e-3f, [](const ecs::Particle& p) { return glm::unpackHalf2x16(p.emissive.x).x; } },
+      { "emissive.g", 1e-3f, [](const ecs::Particle& p) { return glm::unpackHalf2x16(p.emissive.x).y; } },
+      { "lifetime", 1e-4f, [](const ecs::Particle& p) { return p.lifetime; } },
+    };
+
+    bool ok = countsMatch;
+    for (const auto& attribute : attributes)
+    {
+      const float error = MaxQuantileError(attribute, gpuParticles, cpuParticles);
+      const bool attributeOk = error <= attribute.epsilon;
+      printf("%-12s %12g %12g %s\n", attribute.name, error, attribute.epsilon, attributeOk ? "ok" : "MISMATCH");
+      ok = ok && attributeOk;
+    }
+    return ok;
+  }
+}
+
+int main(int argc, const char* const* argv)
+{
+  const uint32_t ticks = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 120;
+  const uint32_t maxParticles = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 1 << 18;
+  if (ticks == 0 || maxParticles < 4)
+  {
+    printf("Usage: %s [ticks] [max particles]\n", argv[0]);
+    return 1;
+  }
+
+  if (!glfwInit())
+  {
+    throw std::runtime_error("Failed to initialize GLFW");
+  }
+
+  // the context is only used for compute, so the window is never shown
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  auto* window = glfwCreateWindow(64, 64, "Particle parity", nullptr, nullptr);
+  if (!window)
+  {
+    throw std::runtime_error("Failed to create window");
+  }
+  glfwMakeContextCurrent(window);
+
+  printf("%u ticks at %.0f Hz, %u max particles\n", ticks, 1.0 / TICK, maxParticles);
+  printf("%-12s %12s %12s\n", "", "gpu/error", "cpu/epsilon");
+  const bool ok = Compare(window, ticks, maxParticles);
+
+  glfwTerminate();
+  return ok ? 0 : 1;
+}
\ No newline at end of file
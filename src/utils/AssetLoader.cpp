@@ -0,0 +1,130 @@
+#include "utils/AssetLoader.h"
+#include "Exception.h"
+#include <filesystem>
+#include <fstream>
+#include "stb_image.h"
+
+AssetLoader::AssetLoader(const std::string& packPath)
+  : _jobs(std::clamp(std::thread::hardware_concurrency(), 2u, MAX_WORKERS + 1) - 1)
+{
+  if (std::filesystem::exists(packPath))
+  {
+    _pack.emplace(packPath);
+  }
+}
+
+AssetLoader::~AssetLoader()
+{
+  // the loads use the pack, so they must finish before it's unmapped
+  _jobs.Wait(_loads);
+}
+
+AssetLoader& AssetLoader::Get()
+{
+  static AssetLoader loader("assets.pack");
+  return loader;
+}
+
+std::span<const std::byte> AssetLoader::Read(const std::string& path, std::vector<std::byte>& storage) const
+{
+  if (_pack)
+  {
+    if (auto contents = _pack->Find(path))
+    {
+      return *contents;
+    }
+  }
+
+  std::ifstream file{ path, std::ios::binary | std::ios::ate };
+  if (file.fail()) // empty files are acceptable, missing/bad files are not
+  {
+    throw LoadFileException(path);
+  }
+
+  storage.resize(static_cast<size_t>(file.tellg()));
+  file.seekg(0);
+  file.read(reinterpret_cast<char*>(storage.data()), static_cast<std::streamsize>(storage.size()));
+  return storage;
+}
+
+template<typename Fn>
+auto AssetLoader::Async(Fn load) -> std::shared_future<decltype(load())>
+{
+  // Job must be copyable, and the task catches what load throws so get() can rethrow it
+  auto task = std::make_shared<std::packaged_task<decltype(load())()>>(std::move(load));
+  auto future = task->get_future().share();
+  _jobs.Submit(_loads, [task] { (*task)(); });
+  return future;
+}
+
+std::shared_future<std::string> AssetLoader::LoadText(std::string_view path)
+{
+  auto lock = std::lock_guard(_mutex);
+  auto [it, inserted] = _texts.try_emplace(std::string(path));
+  if (inserted)
+  {
+    it->second = Async([this, path = it->first]
+      {
+        std::vector<std::byte> storage;
+        const auto contents = Read(path, storage);
+        return std::string(reinterpret_cast<const char*>(contents.data()), contents.size());
+      });
+  }
+  return it->second;
+}
+
+std::shared_future<Image> AssetLoader::LoadImage(std::string_view path)
+{
+  auto lock = std::lock_guard(_mutex);
+  auto [it, inserted] = _images.try_emplace(std::string(path));
+  if (inserted)
+  {
+    it->second = Async([this, path = it->first]
+      {
+        std::vector<std::byte> storage;
+        const auto contents = Read(path, storage);
+
+        int width{};
+        int height{};
+        int channels{};
+        auto* pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(contents.data()), static_cast<int>(contents.size()), &width, &height, &channels, 4);
+        if (!pixels)
+        {
+          throw LoadFileException(path);
+        }
+
+        auto image = Image{ .width = static_cast<uint32_t>(width), .height = static_cast<uint32_t>(height) };
+        image.pixels.assign(pixels, pixels + size_t(width) * height * 4);
+        stbi_image_free(pixels);
+        return image;
+      });
+  }
+  return it->second;
+}
+
+void AssetLoader::PrefetchText(std::string_view directory)
+{
+  auto prefix = std::string(directory);
+  if (!prefix.empty() && prefix.back() != '/')
+  {
+    prefix += '/';
+  }
+
+  if (_pack)
+  {
+    for (auto name : _pack->Names(prefix))
+    {
+      LoadText(name);
+    }
+    return;
+  }
+
+  std::error_code error;
+  for (const auto& entry : std::filesystem::recursive_directory_iterator(prefix, error))
+  {
+    if (entry.is_regular_file())
+    {
+      LoadText(entry.path().generic_string());
+    }
+  }
+}
\ No newline at end of file
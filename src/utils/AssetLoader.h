@@ -0,0 +1,61 @@
+#pragma once
+#include "JobSystem.h"
+#include "utils/AssetPack.h"
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// decoded by stb_image
+struct Image
+{
+  uint32_t width{};
+  uint32_t height{};
+  std::vector<uint8_t> pixels; // RGBA8, rows start at the top
+};
+
+// Loads assets on a few background threads, so reading and decoding them can overlap with other startup work.
+// Assets are read from the pack if it has them, or else from loose files. Each asset is only loaded once,
+// loading it again returns the same future. Failed loads rethrow LoadFileException from get().
+class AssetLoader
+{
+public:
+  // a missing pack is fine, every asset is loose then
+  explicit AssetLoader(const std::string& packPath);
+  ~AssetLoader();
+
+  AssetLoader(const AssetLoader&) = delete;
+  AssetLoader& operator=(const AssetLoader&) = delete;
+
+  std::shared_future<std::string> LoadText(std::string_view path);
+  std::shared_future<Image> LoadImage(std::string_view path);
+
+  // starts loading every asset under the directory as text
+  void PrefetchText(std::string_view directory);
+
+  // the loader used by LoadFile. Its pack is assets.pack in the working directory
+  static AssetLoader& Get();
+
+private:
+  // a view of the packed contents, or else the contents of the loose file in storage
+  std::span<const std::byte> Read(const std::string& path, std::vector<std::byte>& storage) const;
+
+  // runs load on the pool and returns its result
+  template<typename Fn>
+  auto Async(Fn load) -> std::shared_future<decltype(load())>;
+
+  // Loading is mostly waiting on the disk, so a few workers are enough. Declared after the pack so the
+  // workers are joined before it's unmapped
+  static constexpr uint32_t MAX_WORKERS = 4;
+
+  std::optional<AssetPack> _pack;
+  JobSystem _jobs;
+  JobSystem::Counter _loads;
+  std::mutex _mutex;
+  std::unordered_map<std::string, std::shared_future<std::string>> _texts;
+  std::unordered_map<std::string, std::shared_future<Image>> _images;
+};
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "utils/AssetPack.h"
+#include "Exception.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+AssetPack::AssetPack(const std::string& path)
+{
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+  {
+    throw LoadFileException(path);
+  }
+
+  LARGE_INTEGER size{};
+  GetFileSizeEx(file, &size);
+  _size = static_cast<size_t>(size.QuadPart);
+  _mapping = _size > 0 ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+  CloseHandle(file);
+  if (_mapping)
+  {
+    _data = static_cast<const std::byte*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+  }
+#else
+  const int file = open(path.c_str(), O_RDONLY);
+  if (file == -1)
+  {
+    throw LoadFileException(path);
+  }
+
+  struct stat info{};
+  fstat(file, &info);
+  _size = static_cast<size_t>(info.st_size);
+  if (_size > 0)
+  {
+    void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, file, 0);
+    _data = data == MAP_FAILED ? nullptr : static_cast<const std::byte*>(data);
+  }
+  close(file);
+#endif
+
+  Header header{};
+  if (_data && _size >= sizeof(Header))
+  {
+    std::memcpy(&header, _data, sizeof(Header));
+  }
+
+  const bool valid = _data &&
+    _size >= sizeof(Header) &&
+    std::equal(std::begin(MAGIC), std::end(MAGIC), header.magic) &&
+    header.version == VERSION &&
+    header.numEntries <= (_size - sizeof(Header)) / sizeof(Entry) &&
+    ValidateEntries();
+  if (!valid)
+  {
+    Unmap();
+    throw LoadFileException(path);
+  }
+}
+
+AssetPack::~AssetPack()
+{
+  Unmap();
+}
+
+void AssetPack::Unmap()
+{
+#ifdef _WIN32
+  if (_data)
+  {
+    UnmapViewOfFile(_data);
+  }
+  if (_mapping)
+  {
+    CloseHandle(_mapping);
+  }
+#else
+  if (_data)
+  {
+    munmap(const_cast<std::byte*>(_data), _size);
+  }
+#endif
+  _data = nullptr;
+  _mapping = nullptr;
+}
+
+bool AssetPack::ValidateEntries() const
+{
+  // Find and Names trust the entries, so a truncated or corrupt pack must be caught here
+  auto inBounds = [this](uint64_t offset, uint64_t size) { return offset <= _size && size <= _size - offset; };
+
+  const auto entries = Entries();
+  for (size_t i = 0; i < entries.size(); i++)
+  {
+    if (!inBounds(entries[i].nameOffset, entries[i].nameSize) || !inBounds(entries[i].contentOffset, entries[i].contentSize))
+    {
+      return false;
+    }
+
+    if (i > 0 && !(NameOf(entries[i - 1]) < NameOf(entries[i])))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::span<const AssetPack::Entry> AssetPack::Entries() const
+{
+  Header header;
+  std::memcpy(&header, _data, sizeof(Header));
+  return { reinterpret_cast<const Entry*>(_data + sizeof(Header)), header.numEntries };
+}
+
+std::string_view AssetPack::NameOf(const Entry& entry) const
+{
+  return { reinterpret_cast<const char*>(_data + entry.nameOffset), entry.nameSize };
+}
+
+std::optional<std::span<const std::byte>> AssetPack::Find(std::string_view name) const
+{
+  const auto entries = Entries();
+  const auto it = std::lower_bound(entries.begin(), entries.end(), name,
+    [this](const Entry& entry, std::string_view value) { return NameOf(entry) < value; });
+  if (it == entries.end() || NameOf(*it) != name)
+  {
+    return std::nullopt;
+  }
+
+  return std::span(_data + it->contentOffset, it->contentSize);
+}
+
+std::vector<std::string_view> AssetPack::Names(std::string_view prefix) const
+{
+  std::vector<std::string_view> names;
+  for (const auto& entry : Entries())
+  {
+    if (auto name = NameOf(entry); name.starts_with(prefix))
+    {
+      names.push_back(name);
+    }
+  }
+  return names;
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A read-only archive of assets that is memory-mapped instead of read. Built by tools/PackAssets.cpp.
+// Layout:
+//   Header
+//   Entry[numEntries], sorted by name
+//   names, referenced by the entries
+//   contents, each aligned to CONTENT_ALIGNMENT
+class AssetPack
+{
+public:
+  struct Header
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t numEntries;
+  };
+
+  struct Entry
+  {
+    uint64_t nameOffset;
+    uint64_t contentOffset;
+    uint64_t contentSize;
+    uint32_t nameSize;
+    uint32_t _padding;
+  };
+
+  static constexpr char MAGIC[8] = { 'L', 'D', '5', '1', 'P', 'A', 'C', 'K' };
+  static constexpr uint32_t VERSION = 1;
+  static constexpr size_t CONTENT_ALIGNMENT = 16;
+
+  // throws LoadFileException if the file can't be mapped, isn't a pack of this version or has an entry outside the file
+  explicit AssetPack(const std::string& path);
+  ~AssetPack();
+
+  AssetPack(const AssetPack&) = delete;
+  AssetPack& operator=(const AssetPack&) = delete;
+
+  // The contents point into the mapping, so they're valid for as long as the pack is
+  [[nodiscard]] std::optional<std::span<const std::byte>> Find(std::string_view name) const;
+
+  // every asset whose name starts with prefix, sorted
+  [[nodiscard]] std::vector<std::string_view> Names(std::string_view prefix = {}) const;
+
+private:
+  void Unmap();
+  [[nodiscard]] bool ValidateEntries() const;
+  [[nodiscard]] std::span<const Entry> Entries() const;
+  [[nodiscard]] std::string_view NameOf(const Entry& entry) const;
+
+  const std::byte* _data = nullptr;
+  size_t _size = 0;
+  void* _mapping = nullptr; // only used on Windows
+};
\ No newline at end of file
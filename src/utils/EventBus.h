@@ -1,33 +1,104 @@
 // event bus class adapted from here: https://gist.github.com/Jgb14002/44716ad59c9654ad08b59abbf1c45b40
 #pragma once
+#include "GAssert.h"
 #include <algorithm>
-#include <unordered_map>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <vector>
 #include <memory>
-#include <typeindex>
+#include <new>
 #include <functional>
+#include <type_traits>
 #include <utility>
 
+// Holds the events of one type that were queued with EventBus::Enqueue until EventBus::Flush. By default each event
+// is copied and published on its own. Specialize it for event types that refer to memory they don't own, or whose
+// events can be coalesced into fewer. A specialization may publish a different type, like a batch of the events.
+template<typename EventType>
+class EventQueue
+{
+public:
+  void Push(const EventType& e)
+  {
+    m_Events.push_back(e);
+  }
+
+  template<typename PublishFn>
+  void Flush(PublishFn&& publish)
+  {
+    // events that are queued by the handlers are published in the next flush
+    std::swap(m_Events, m_Flushing);
+    for (auto& e : m_Flushing)
+    {
+      publish(e);
+    }
+    m_Flushing.clear();
+  }
+
+private:
+  std::vector<EventType> m_Events;
+  std::vector<EventType> m_Flushing;
+};
+
 class EventBus
 {
 private:
-  class EventDispatcher
+  // Every event type gets a small index on first use, so handlers are found by indexing rather than hashing.
+  // A stateful metaprogramming counter would number types per translation unit, so they would disagree between files
+  class EventTypeId
   {
   public:
-    virtual ~EventDispatcher() = default;
-
-    template<typename T>
-    void Dispatch(T& e) const
+    template<typename EventType>
+    static uint32_t Get()
     {
-      InvokeHandler(&e);
+      static const uint32_t id = s_next++;
+      return id;
     }
 
-  protected:
-    virtual void InvokeHandler(void* e) const = 0;
+  private:
+    static inline std::atomic<uint32_t> s_next = 0;
+  };
+
+  // A member function bound to its receiver, stored inline. The thunk is instantiated per receiver and event type,
+  // so it knows how to call the stored member function pointer. Predicates are stored and called the same way
+  struct Delegate
+  {
+    using Thunk = void(*)(const Delegate&, void* e);
+    using PredicateThunk = bool(*)(const Delegate&, const void* e);
+
+    void* receiver;
+    Thunk invoke; // null once unsubscribed during a publish, until the outermost publish returns
+    std::array<std::byte, 2 * sizeof(void*)> handlerFn;
+
+    PredicateThunk predicate; // null if the handler has no predicate
+    alignas(void*) std::array<std::byte, 4 * sizeof(void*)> predicateFn;
+  };
+
+  using HandlerList = std::vector<Delegate>;
+
+  class QueuedEvents
+  {
+  public:
+    virtual ~QueuedEvents() = default;
+    virtual void Flush(EventBus& bus) = 0;
+
+    bool pending = false; // in m_PendingQueues
   };
 
-  using Dispatcher = std::unique_ptr<EventDispatcher>;
-  using HandlerList = std::vector<Dispatcher>;
+  template<typename EventType>
+  class TypedQueuedEvents : public QueuedEvents
+  {
+  public:
+    void Flush(EventBus& bus) override
+    {
+      queue.Flush([&bus](auto& e) { bus.Publish(e); });
+    }
+
+    EventQueue<EventType> queue;
+  };
 
 public:
 
@@ -38,101 +109,207 @@ public:
   template<typename EventType>
   void Publish(EventType&& e)
   {
-    auto entry = m_Subscriptions.find(typeid(EventType));
-    if (entry != m_Subscriptions.end())
+    using Event = std::remove_cvref_t<EventType>;
+    const auto id = EventTypeId::Get<Event>();
+    if (id >= m_Subscriptions.size())
+    {
+      return;
+    }
+
+    // Handlers may subscribe while this runs, so the list is indexed rather than iterated. Handlers that
+    // unsubscribe are only removed once the outermost publish returns, so no handler gets skipped
+    auto scope = PublishScope(*this);
+    for (size_t i = 0; i < m_Subscriptions[id].size(); i++)
     {
-      for (const auto& handler : entry->second)
+      const Delegate& handler = m_Subscriptions[id][i];
+      if (handler.invoke && (!handler.predicate || handler.predicate(handler, &e)))
       {
-        handler->Dispatch(e);
+        handler.invoke(handler, const_cast<Event*>(&e));
       }
     }
   }
 
+  // The event is stored until the next Flush, then published
+  template<typename EventType>
+  void Enqueue(EventType&& e)
+  {
+    using Event = std::remove_cvref_t<EventType>;
+    const auto id = EventTypeId::Get<Event>();
+    if (id >= m_Queues.size())
+    {
+      m_Queues.resize(id + 1);
+    }
+
+    auto& queued = m_Queues[id];
+    if (!queued)
+    {
+      queued = std::make_unique<TypedQueuedEvents<Event>>();
+    }
+
+    static_cast<TypedQueuedEvents<Event>&>(*queued).queue.Push(e);
+    if (!queued->pending)
+    {
+      queued->pending = true;
+      m_PendingQueues.push_back(queued.get());
+    }
+  }
+
+  // Publishes every queued event. Events are grouped by type, and types are flushed in the order they were first
+  // queued in. Must not be called by a handler
+  void Flush()
+  {
+    G_ASSERT_MSG(!m_Flushing, "EventBus::Flush was called by a handler");
+    m_Flushing = true;
+    std::swap(m_PendingQueues, m_FlushingQueues);
+    for (auto* queued : m_FlushingQueues)
+    {
+      queued->pending = false;
+      queued->Flush(*this);
+    }
+    m_FlushingQueues.clear();
+    m_Flushing = false;
+  }
+
   template<typename Receiver, typename EventType>
   void Subscribe(Receiver* receiver, void(Receiver::* handlerFn)(EventType&))
   {
-    HandlerList& handlers = m_Subscriptions[typeid(EventType)];
-    handlers.emplace_back(std::make_unique<EventHandler<Receiver, EventType>>(receiver, handlerFn, nullptr));
+    GetHandlers<EventType>().push_back(MakeDelegate(receiver, handlerFn));
   }
 
+  // The predicate is stored in the handler, so it must be small and trivially copyable, like a lambda
+  // that captures a few pointers or values
   template<typename Receiver, typename EventType, typename Fn>
   void Subscribe(Receiver* receiver, void(Receiver::* handlerFn)(EventType&), Fn&& predicateFn)
   {
-    HandlerList& handlers = m_Subscriptions[typeid(EventType)];
-    handlers.emplace_back(std::make_unique<EventHandler<Receiver, EventType>>(receiver, handlerFn, std::forward<Fn>(predicateFn)));
+    using Predicate = std::decay_t<Fn>;
+    static_assert(sizeof(Predicate) <= sizeof(Delegate::predicateFn) && alignof(Predicate) <= alignof(void*),
+      "predicate doesn't fit in a delegate");
+    static_assert(std::is_trivially_copyable_v<Predicate> && std::is_trivially_destructible_v<Predicate>,
+      "predicate must be trivially copyable, since delegates are copied as bytes and never destroyed");
+
+    auto delegate = MakeDelegate(receiver, handlerFn);
+    delegate.predicate = &InvokePredicate<Predicate, EventType>;
+    new (delegate.predicateFn.data()) Predicate(std::forward<Fn>(predicateFn));
+    GetHandlers<EventType>().push_back(delegate);
   }
 
   // unsubscribes a receiver from a single event
   template<typename Receiver, typename EventType>
   void Unsubscribe(Receiver* receiver, void(Receiver::* handlerFn)(EventType&))
   {
-    auto entry = m_Subscriptions.find(typeid(EventType));
-    if (entry != m_Subscriptions.end())
+    const auto id = EventTypeId::Get<std::remove_cvref_t<EventType>>();
+    if (id >= m_Subscriptions.size())
+    {
+      return;
+    }
+
+    const auto tmp = MakeDelegate(receiver, handlerFn);
+    auto matches = [&](const Delegate& handler)
+    {
+      return handler.receiver == tmp.receiver && handler.invoke == tmp.invoke &&
+        GetHandlerFn<Receiver, EventType>(handler) == handlerFn;
+    };
+
+    // erasing would shift the handlers of a list that is being published to
+    if (m_PublishDepth > 0)
     {
-      const EventHandler<Receiver, EventType> tmp = { receiver, handlerFn, nullptr };
-      HandlerList& handlers = entry->second;
-      std::erase_if(handlers, [&](const auto& handler)
+      for (auto& handler : m_Subscriptions[id])
+      {
+        if (matches(handler))
         {
-          using T = EventHandler<Receiver, EventType>;
-          return static_cast<T&>(*handler) == tmp;
-        });
+          handler.invoke = nullptr;
+          m_HasUnsubscribed = true;
+        }
+      }
+    }
+    else
+    {
+      std::erase_if(m_Subscriptions[id], matches);
     }
   }
 
-  // unsubscribes a receiver from all events
-  //template<typename Receiver>
-  //void UnsubscribeAll(Receiver* receiver)
-  //{
-  //  for (auto& [_, handlers] : m_Subscriptions)
-  //  {
-  //    std::erase_if(handlers, [&](const auto& handler)
-  //      {
-  //        using T = EventHandler<Receiver, Event>;
-  //        return static_cast<T&>(*handler) == receiver; // this static cast is UB
-  //      });
-  //  }
-  //}
-
 private:
-  // potential optimization: https://mc-deltat.github.io/articles/stateful-metaprogramming-cpp20
-  std::unordered_map<std::type_index, HandlerList> m_Subscriptions;
-
-  // type-erased wrapper
-  template<typename Receiver, typename EventType>
-  class EventHandler : public EventDispatcher
+  // removes the handlers that were unsubscribed during a publish once the outermost one returns
+  class PublishScope
   {
   public:
-    using HandlerFn = void(Receiver::*)(EventType&);
-    using PredicateFn = std::function<bool(const EventType&)>;
-
-    EventHandler(Receiver* receiver, HandlerFn handlerFn, PredicateFn predicateFn)
-      : m_Receiver(receiver),
-      m_HandlerFn(handlerFn),
-      m_PredicateFn(std::move(predicateFn))
+    explicit PublishScope(EventBus& bus)
+      : m_Bus(bus)
     {
+      m_Bus.m_PublishDepth++;
     }
 
-    void InvokeHandler(void* e) const override
+    ~PublishScope()
     {
-      if (!m_PredicateFn || m_PredicateFn(*reinterpret_cast<EventType*>(e)))
+      if (--m_Bus.m_PublishDepth == 0 && m_Bus.m_HasUnsubscribed)
       {
-        (m_Receiver->*m_HandlerFn)(*reinterpret_cast<EventType*>(e));
+        m_Bus.m_HasUnsubscribed = false;
+        for (auto& handlers : m_Bus.m_Subscriptions)
+        {
+          std::erase_if(handlers, [](const Delegate& handler) { return !handler.invoke; });
+        }
       }
     }
 
-    bool operator==(const EventHandler& rhs) const noexcept
-    {
-      return m_Receiver == rhs.m_Receiver && m_HandlerFn == rhs.m_HandlerFn;
-    }
+    PublishScope(const PublishScope&) = delete;
+    PublishScope& operator=(const PublishScope&) = delete;
+
+  private:
+    EventBus& m_Bus;
+  };
+
+  // indexed by EventTypeId
+  std::vector<HandlerList> m_Subscriptions;
+  uint32_t m_PublishDepth = 0;
+  bool m_HasUnsubscribed = false;
+  std::vector<std::unique_ptr<QueuedEvents>> m_Queues;
+
+  // queues with events since the last flush, in the order they were first pushed to
+  std::vector<QueuedEvents*> m_PendingQueues;
+  std::vector<QueuedEvents*> m_FlushingQueues;
+  bool m_Flushing = false;
 
-    bool operator==(const Receiver* rhs) const
+  // handlers may take the event as const, but they're found by the type that's published
+  template<typename EventType>
+  HandlerList& GetHandlers()
+  {
+    const auto id = EventTypeId::Get<std::remove_cvref_t<EventType>>();
+    if (id >= m_Subscriptions.size())
     {
-      return m_Receiver == rhs;
+      m_Subscriptions.resize(id + 1);
     }
+    return m_Subscriptions[id];
+  }
 
-  private:
-    Receiver* m_Receiver;
-    HandlerFn m_HandlerFn;
-    PredicateFn m_PredicateFn;
-  };
+  template<typename Receiver, typename EventType>
+  static Delegate MakeDelegate(Receiver* receiver, void(Receiver::* handlerFn)(EventType&))
+  {
+    using HandlerFn = void(Receiver::*)(EventType&);
+    static_assert(sizeof(HandlerFn) <= sizeof(Delegate::handlerFn), "member function pointer doesn't fit in a delegate");
+
+    Delegate delegate{ .receiver = receiver, .invoke = &Invoke<Receiver, EventType> };
+    std::memcpy(delegate.handlerFn.data(), &handlerFn, sizeof(HandlerFn));
+    return delegate;
+  }
+
+  template<typename Receiver, typename EventType>
+  static auto GetHandlerFn(const Delegate& delegate)
+  {
+    void(Receiver::* handlerFn)(EventType&);
+    std::memcpy(&handlerFn, delegate.handlerFn.data(), sizeof(handlerFn));
+    return handlerFn;
+  }
+
+  template<typename Receiver, typename EventType>
+  static void Invoke(const Delegate& delegate, void* e)
+  {
+    (static_cast<Receiver*>(delegate.receiver)->*GetHandlerFn<Receiver, EventType>(delegate))(*static_cast<EventType*>(e));
+  }
+
+  template<typename Predicate, typename EventType>
+  static bool InvokePredicate(const Delegate& delegate, const void* e)
+  {
+    const auto& predicate = *std::launder(reinterpret_cast<const Predicate*>(delegate.predicateFn.data()));
+    return predicate(*static_cast<const EventType*>(e));
+  }
 };
\ No newline at end of file
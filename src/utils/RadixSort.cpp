@@ -0,0 +1,84 @@
+#include "utils/RadixSort.h"
+#include "GAssert.h"
+#include <algorithm>
+#include <execution>
+#include <thread>
+#include <utility>
+
+namespace
+{
+  // smaller inputs aren't worth splitting across threads
+  constexpr size_t MIN_CHUNK_SIZE = 16384;
+}
+
+void RadixSorter::Sort(std::span<uint64_t> keys, uint32_t firstBit, uint32_t lastBit)
+{
+  G_ASSERT(firstBit <= lastBit && lastBit <= 64);
+
+  const size_t count = keys.size();
+  if (count < 2 || firstBit == lastBit)
+  {
+    return;
+  }
+
+  const size_t maxChunks = std::max(1u, std::thread::hardware_concurrency());
+  const size_t numChunks = std::clamp<size_t>(count / MIN_CHUNK_SIZE, 1, maxChunks);
+  const size_t chunkSize = (count + numChunks - 1) / numChunks;
+  _chunks.resize(numChunks);
+  for (size_t i = 0; i < numChunks; i++)
+  {
+    _chunks[i].begin = std::min(count, i * chunkSize);
+    _chunks[i].end = std::min(count, (i + 1) * chunkSize);
+  }
+  _scratch.resize(count);
+
+  uint64_t* src = keys.data();
+  uint64_t* dst = _scratch.data();
+  for (uint32_t shift = firstBit; shift < lastBit; shift += RADIX_BITS)
+  {
+    const uint64_t mask = (uint64_t(1) << std::min(RADIX_BITS, lastBit - shift)) - 1;
+
+    std::for_each(std::execution::par, _chunks.begin(), _chunks.end(), [&](Chunk& chunk)
+      {
+        chunk.offsets.fill(0);
+        for (size_t i = chunk.begin; i < chunk.end; i++)
+        {
+          chunk.offsets[(src[i] >> shift) & mask]++;
+        }
+      });
+
+    // each digit's keys go after every smaller digit's, and each chunk's after the previous chunk's, which keeps the sort stable
+    size_t offset = 0;
+    bool allSameDigit = false;
+    for (uint32_t digit = 0; digit < RADIX; digit++)
+    {
+      const size_t digitBegin = offset;
+      for (auto& chunk : _chunks)
+      {
+        offset += std::exchange(chunk.offsets[digit], offset);
+      }
+      allSameDigit |= offset - digitBegin == count;
+    }
+
+    // this pass wouldn't move anything
+    if (allSameDigit)
+    {
+      continue;
+    }
+
+    std::for_each(std::execution::par, _chunks.begin(), _chunks.end(), [&](Chunk& chunk)
+      {
+        for (size_t i = chunk.begin; i < chunk.end; i++)
+        {
+          dst[chunk.offsets[(src[i] >> shift) & mask]++] = src[i];
+        }
+      });
+
+    std::swap(src, dst);
+  }
+
+  if (src != keys.data())
+  {
+    std::copy(std::execution::par_unseq, src, src + count, keys.data());
+  }
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Stable LSD radix sort of 64-bit keys, one byte per pass. Each pass histograms and scatters chunks of the keys in parallel.
+// Pack whatever is sorted on into the high bits of a key and a payload (e.g. an index) into the low bits,
+// then only sort on the high bits. Scratch memory is kept between sorts.
+class RadixSorter
+{
+public:
+  // Only bits [firstBit, lastBit) of the keys are compared. Keys that are equal in those bits keep their order
+  void Sort(std::span<uint64_t> keys, uint32_t firstBit = 0, uint32_t lastBit = 64);
+
+private:
+  static constexpr uint32_t RADIX_BITS = 8;
+  static constexpr uint32_t RADIX = 1 << RADIX_BITS;
+
+  struct Chunk
+  {
+    size_t begin;
+    size_t end;
+    std::array<size_t, RADIX> offsets; // a histogram of digits, then where each digit is scattered to
+  };
+
+  std::vector<uint64_t> _scratch;
+  std::vector<Chunk> _chunks;
+};
\ No newline at end of file
@@ -0,0 +1,113 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Hierarchical timing wheel. Values are bucketed by deadline into slots of increasingly coarse levels and are only
+// touched when their slot comes due, either to expire or to move down a level, so advancing costs O(slots passed)
+// rather than O(values). Deadlines are in arbitrary units, and each slot of the finest level spans 2^resolutionBits
+// of them. A value never expires before its deadline, but may expire up to one slot after it.
+template<typename T>
+class TimingWheel
+{
+public:
+  explicit TimingWheel(uint32_t resolutionBits = 0)
+    : _resolutionBits(resolutionBits)
+  {
+  }
+
+  void Insert(uint64_t deadline, T value)
+  {
+    // slots up to the current one were already expired
+    const auto slotTime = std::max(deadline >> _resolutionBits, _slotNow + 1);
+    Place(slotTime, Entry{ deadline, std::move(value) });
+    _size++;
+  }
+
+  // Moves time forward to now and appends every value whose deadline is at or before it to expired
+  void Advance(uint64_t now, std::vector<T>& expired)
+  {
+    if (now <= _now)
+    {
+      return;
+    }
+    _now = now;
+
+    const auto target = now >> _resolutionBits;
+    while (_slotNow < target)
+    {
+      const auto t = ++_slotNow;
+
+      // coarse slots that start at t are spread over the finer levels, coarsest first
+      for (uint32_t level = LEVELS - 1; level > 0; level--)
+      {
+        const auto shift = SLOT_BITS * level;
+        if ((t & ((uint64_t(1) << shift) - 1)) == 0)
+        {
+          auto entries = std::exchange(_slots[level][(t >> shift) & SLOT_MASK], {});
+          for (auto& entry : entries)
+          {
+            Place(std::max(entry.deadline >> _resolutionBits, t), std::move(entry));
+          }
+        }
+      }
+
+      auto entries = std::exchange(_slots[0][t & SLOT_MASK], {});
+      for (auto& entry : entries)
+      {
+        if (entry.deadline <= now)
+        {
+          expired.push_back(std::move(entry.value));
+          _size--;
+        }
+        else
+        {
+          // only possible in the last slot, for deadlines later in it than now
+          Place(t + 1, std::move(entry));
+        }
+      }
+    }
+  }
+
+  [[nodiscard]] size_t Size() const { return _size; }
+  [[nodiscard]] uint64_t Now() const { return _now; }
+
+private:
+  static constexpr uint32_t SLOT_BITS = 6;
+  static constexpr uint64_t SLOT_MASK = (1 << SLOT_BITS) - 1;
+  static constexpr uint32_t LEVELS = 6;
+
+  struct Entry
+  {
+    uint64_t deadline;
+    T value;
+  };
+
+  // slotTime must not be before the current slot
+  void Place(uint64_t slotTime, Entry&& entry)
+  {
+    // the finest level where the slot is in the current revolution of the next level
+    for (uint32_t level = 0; level < LEVELS; level++)
+    {
+      const auto nextShift = SLOT_BITS * (level + 1);
+      if ((slotTime >> nextShift) == (_slotNow >> nextShift))
+      {
+        _slots[level][(slotTime >> (SLOT_BITS * level)) & SLOT_MASK].push_back(std::move(entry));
+        return;
+      }
+    }
+
+    // too far out for the wheel, so park it in the last slot of the coarsest level. It's placed again from there
+    const auto topShift = SLOT_BITS * (LEVELS - 1);
+    _slots[LEVELS - 1][((_slotNow >> topShift) - 1) & SLOT_MASK].push_back(std::move(entry));
+  }
+
+  uint32_t _resolutionBits;
+  uint64_t _now = 0;
+  uint64_t _slotNow = 0; // the last slot that was expired
+  size_t _size = 0;
+  std::array<std::array<std::vector<Entry>, SLOT_MASK + 1>, LEVELS> _slots;
+};
\ No newline at end of file